@@ -0,0 +1,134 @@
+// _sapphin_asyncload.cpp
+// This loads a model on a worker thread and feeds it to the GPU a slice per frame.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+
+#include <iostream>
+#include <string>
+#include <algorithm>
+
+// Headers
+#include "headers/_sapphin_asyncload.h"
+#include "headers/_sapphin_modeling.h"
+#include "headers/_sapphin_render.h"
+#include "headers/_sapphin_profiler.h"
+#include "headers/_sapphin_types.h"
+
+AsyncMeshLoader::~AsyncMeshLoader() {
+    // A model that is still loading when the window closes is cancelled; the parse stops within a few
+    // thousand lines and the processing stages are skipped
+    cancelJob(true);
+}
+
+void AsyncMeshLoader::cancelJob(bool wait) {
+    if (job) {
+        job->cancel = true;
+    }
+    if (worker.joinable()) {
+        if (wait) {
+            worker.join();
+        }
+        else {
+            worker.detach();  // It only touches its own job, which it keeps alive
+        }
+    }
+    job.reset();
+}
+
+void AsyncMeshLoader::cancel() {
+    cancelJob(false);
+    staging.destroy();
+    upload = MeshUpload();
+    loadedPicker.clear();
+    pickerReady = false;
+    state = IDLE;
+}
+
+void AsyncMeshLoader::start(const std::string& file, uint32_t processingFlags, bool packed) {
+    // A model still loading or uploading is dropped for the new one
+    cancel();
+
+    filename = file;
+    state = LOADING;
+    startTime = std::chrono::steady_clock::now();
+    job = std::make_shared<Job>();
+    job->filename = file;
+    std::shared_ptr<Job> work = job;
+    worker = std::thread([work, processingFlags, packed]() {
+        {
+            ProfileZone loadZone("Load model");
+            work->mesh = loadMeshCached(work->filename, processingFlags, &work->stage, &work->cancel);
+            if (!work->mesh.indices.empty() && !work->cancel) {
+                work->upload = prepareMeshUpload(work->mesh, packed);
+                ProfileZone pickZone("Build pick BVH");
+                work->picker.build(work->mesh);
+            }
+        }
+        work->done.store(true, std::memory_order_release);
+    });
+}
+
+bool AsyncMeshLoader::update(Mesh& mesh, GpuMesh& gpuMesh, size_t maxBytes) {
+    if (state == LOADING) {
+        if (!job->done.load(std::memory_order_acquire)) {
+            return false;
+        }
+        worker.join();
+        std::shared_ptr<Job> finished = std::move(job);
+        if (finished->mesh.indices.empty()) {
+            std::cerr << "Could not load " << filename << std::endl;
+            state = FAILED;
+            return true;
+        }
+        // The upload reads the mesh's own vertices and indices, which keep their storage when moved
+        mesh = std::move(finished->mesh);
+        upload = std::move(finished->upload);
+        std::swap(loadedPicker, finished->picker);
+        pickerReady = true;
+        beginMeshUpload(upload, gpuMesh);
+        staging.create(maxBytes);
+        state = UPLOADING;
+    }
+
+    if (state == UPLOADING) {
+        ProfileZone uploadZone("Upload slice");
+        if (continueMeshUpload(upload, mesh, gpuMesh, maxBytes, &staging)) {
+            StreamStats streamStats = staging.takeStats();
+            std::cout << "Uploaded " << filename << " (" << streamStats.bytesUploaded / 1024 << " KB in " << streamStats.frames
+                << " frames, " << streamStats.waitMilliseconds << " ms waiting, " << (staging.isPersistent() ? "persistent" : "orphaned")
+                << " staging), on screen " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count()
+                << " ms after the request" << std::endl;
+            staging.destroy();
+            upload = MeshUpload();
+            state = DONE;
+        }
+    }
+    return state == DONE || state == FAILED || state == IDLE;
+}
+
+bool AsyncMeshLoader::takePickBvh(PickBvh& picker) {
+    if (!pickerReady) {
+        return false;
+    }
+    std::swap(picker, loadedPicker);
+    loadedPicker.clear();
+    pickerReady = false;
+    return true;
+}
+
+size_t AsyncMeshLoader::drawableIndices() const {
+    return state == UPLOADING ? uploadedTriangleIndices(upload) : 0;
+}
+
+std::string AsyncMeshLoader::status() const {
+    if (state == LOADING) {
+        int current = job->stage.load();
+        // After loadMeshCached returns, the worker still converts the mesh to the GPU layout and builds the pick BVH
+        return std::string(current == LOAD_FINISHED ? "Preparing" : meshLoadStageName(current)) + " " + filename;
+    }
+    if (state == UPLOADING) {
+        size_t total = upload.vertexBytes + upload.indexBytes;
+        size_t done = upload.uploadedVertexBytes + upload.uploadedIndexBytes;
+        return "Uploading " + filename + " " + std::to_string(total > 0 ? 100 * done / total : 100) + "%";
+    }
+    return state == FAILED ? "Could not load " + filename : filename;
+}
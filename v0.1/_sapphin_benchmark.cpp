@@ -0,0 +1,680 @@
+// _sapphin_benchmark.cpp
+// This renders a model offscreen along a fixed camera path and reports how long the frames took.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <random>
+
+// Headers
+#include "headers/_sapphin_benchmark.h"
+#include "headers/_sapphin_utils.h"
+#include "headers/_sapphin_camera.h"
+#include "headers/_sapphin_render.h"
+#include "headers/_sapphin_modeling.h"
+#include "headers/_sapphin_scene.h"
+#include "headers/_sapphin_glstate.h"
+#include "headers/_sapphin_profiler.h"
+#include "headers/_sapphin_softraster.h"
+#include "headers/_sapphin_culling.h"
+#include "headers/_sapphin_picking.h"
+#include "headers/_sapphin_occlusion.h"
+#include "headers/_sapphin_types.h"
+#include "lib/GLEW.win32/GLEW-lib/include/GL/glew.h"
+#include "lib/GLFW.win32/GLFW-lib/include/GLFW/glfw3.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+#include "lib/GLM.win32/GLM-lib/glm/gtc/matrix_transform.hpp"
+
+bool loadCameraPath(const std::string& filename, std::vector<CameraKeyframe>& path) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open camera path: " << filename << std::endl;
+        return false;
+    }
+
+    path.clear();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream stream(line);
+        CameraKeyframe keyframe;
+        if (!(stream >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z >> keyframe.yaw >> keyframe.pitch >> keyframe.zoom)) {
+            std::cerr << filename << ":" << lineNumber << ": expected 'x y z yaw pitch zoom'" << std::endl;
+            return false;
+        }
+        path.push_back(keyframe);
+    }
+
+    if (path.empty()) {
+        std::cerr << "Camera path has no keyframes: " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool saveCameraPath(const std::string& filename, const std::vector<CameraKeyframe>& path) {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Failed to write camera path: " << filename << std::endl;
+        return false;
+    }
+
+    file << "# x y z yaw pitch zoom\n";
+    for (const CameraKeyframe& keyframe : path) {
+        file << keyframe.position.x << " " << keyframe.position.y << " " << keyframe.position.z << " "
+            << keyframe.yaw << " " << keyframe.pitch << " " << keyframe.zoom << "\n";
+    }
+    return file.good();
+}
+
+CameraKeyframe cameraKeyframe(const Camera& camera) {
+    return { camera.position, camera.yaw, camera.pitch, camera.zoom };
+}
+
+std::vector<CameraKeyframe> orbitCameraPath(const glm::vec3& boundsMin, const glm::vec3& boundsMax, size_t keyframes) {
+    const float fovy = 45.0f;
+    glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    float radius = std::max(glm::length(boundsMax - boundsMin) * 0.5f, 1e-3f);
+    float fitDistance = radius / std::sin(glm::radians(fovy * 0.5f));
+
+    std::vector<CameraKeyframe> path;
+    for (size_t i = 0; i <= keyframes; i++) {
+        float angle = glm::radians(360.0f) * static_cast<float>(i) / static_cast<float>(keyframes);
+        // Twice per orbit from close up (mostly outside the view, full detail) to far away (whole model, coarse)
+        float distance = fitDistance * (1.3f - 0.8f * std::cos(2.0f * angle));
+        glm::vec3 position = center + glm::vec3(std::sin(angle) * distance, radius * 0.35f, std::cos(angle) * distance);
+
+        glm::vec3 direction = glm::normalize(center - position);
+        CameraKeyframe keyframe;
+        keyframe.position = position;
+        keyframe.yaw = glm::degrees(std::atan2(direction.z, direction.x));
+        keyframe.pitch = glm::degrees(std::asin(direction.y));
+        keyframe.zoom = fovy;
+        path.push_back(keyframe);
+    }
+    return path;
+}
+
+CameraKeyframe sampleCameraPath(const std::vector<CameraKeyframe>& path, float t) {
+    if (path.size() == 1) {
+        return path[0];
+    }
+    float position = std::min(std::max(t, 0.0f), 1.0f) * static_cast<float>(path.size() - 1);
+    size_t first = std::min(static_cast<size_t>(position), path.size() - 2);
+    float blend = position - static_cast<float>(first);
+
+    const CameraKeyframe& a = path[first];
+    const CameraKeyframe& b = path[first + 1];
+    CameraKeyframe keyframe;
+    keyframe.position = glm::mix(a.position, b.position, blend);
+    // Turn the short way round when the yaw wraps between keyframes
+    float yawDelta = std::remainder(b.yaw - a.yaw, 360.0f);
+    keyframe.yaw = a.yaw + yawDelta * blend;
+    keyframe.pitch = a.pitch + (b.pitch - a.pitch) * blend;
+    keyframe.zoom = a.zoom + (b.zoom - a.zoom) * blend;
+    return keyframe;
+}
+
+// Nearest-rank percentile of sorted values
+static double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(sorted.size())));
+    return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Summary of the sorted frame times as a JSON object
+static std::string frameTimesJson(const std::vector<double>& sorted) {
+    double totalMilliseconds = 0.0;
+    for (double milliseconds : sorted) {
+        totalMilliseconds += milliseconds;
+    }
+    std::ostringstream json;
+    json << "{\n"
+        << "    \"mean\": " << totalMilliseconds / static_cast<double>(sorted.size()) << ",\n"
+        << "    \"min\": " << sorted.front() << ",\n"
+        << "    \"p50\": " << percentile(sorted, 50.0) << ",\n"
+        << "    \"p95\": " << percentile(sorted, 95.0) << ",\n"
+        << "    \"p99\": " << percentile(sorted, 99.0) << ",\n"
+        << "    \"max\": " << sorted.back() << "\n"
+        << "  }";
+    return json.str();
+}
+
+// Build the model's pick BVH and cast options.pickCount rays through random pixels of the first camera pose,
+// like clicks in the window. Returns the "picking" report entry, or nothing when no picks were asked for.
+static std::string pickingJson(const EngineOptions& options, const Mesh& mesh, const std::vector<CameraKeyframe>& path) {
+    if (options.pickCount == 0) {
+        return "";
+    }
+    PickBvh picker;
+    picker.build(mesh, options.threadCount);
+
+    Camera camera;
+    camera.setPose(path[0].position, path[0].yaw, path[0].pitch);
+    camera.zoom = path[0].zoom;
+    glm::mat4 view = camera.getViewMatrix();
+    glm::mat4 projection;
+    updateCameraProjection(projection, camera);
+
+    std::mt19937 random(1);  // The same pixels every run
+    std::uniform_real_distribution<double> pixelX(0.0, BENCHMARK_WIDTH), pixelY(0.0, BENCHMARK_HEIGHT);
+    std::vector<double> microseconds;
+    size_t hits = 0;
+    size_t nodesVisited = 0;
+    size_t trianglesTested = 0;
+    for (size_t pick = 0; pick < options.pickCount; pick++) {
+        double x = pixelX(random), y = pixelY(random);
+        auto pickStart = std::chrono::steady_clock::now();
+        glm::vec3 origin, direction;
+        RayHit hit;
+        if (cursorRay(view, projection, x, y, BENCHMARK_WIDTH, BENCHMARK_HEIGHT, origin, direction)) {
+            hit = picker.intersect(origin, direction);
+        }
+        microseconds.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - pickStart).count());
+        hits += hit.hit ? 1 : 0;
+        nodesVisited += hit.nodesVisited;
+        trianglesTested += hit.trianglesTested;
+    }
+    std::sort(microseconds.begin(), microseconds.end());
+    double picks = static_cast<double>(microseconds.size());
+    std::cout << "Picking: " << options.pickCount << " picks, " << hits << " hits, p50 " << percentile(microseconds, 50.0)
+        << " us, max " << microseconds.back() << " us" << std::endl;
+
+    std::ostringstream json;
+    json << "  \"picking\": {\n"
+        << "    \"picks\": " << microseconds.size() << ",\n"
+        << "    \"hits\": " << hits << ",\n"
+        << "    \"buildMilliseconds\": " << picker.buildMilliseconds() << ",\n"
+        << "    \"nodes\": " << picker.nodeCount() << ",\n"
+        << "    \"nodesVisitedPerPick\": " << nodesVisited / picks << ",\n"
+        << "    \"trianglesTestedPerPick\": " << trianglesTested / picks << ",\n"
+        << "    \"microseconds\": " << frameTimesJson(microseconds) << "\n"
+        << "  },\n";
+    return json.str();
+}
+
+// The "occlusion" report entry for the timed frames, or nothing when occlusion culling is off
+static std::string occlusionJson(const EngineOptions& options, const OcclusionStats& stats) {
+    if (!options.occlusion) {
+        return "";
+    }
+    double frames = static_cast<double>(std::max<size_t>(stats.frames, 1));
+    std::cout << "Occlusion: " << stats.occludedBoxes / frames << " of " << stats.testedBoxes / frames << " boxes hidden and "
+        << stats.occludedTriangles / frames << " triangles saved per frame, " << stats.rasterMilliseconds / frames
+        << " ms rasterizing and " << stats.testMilliseconds / frames << " ms testing per frame" << std::endl;
+    if (stats.simplifiedOccluders > 0 || stats.skippedOccluders > 0) {
+        std::cout << "Occlusion: " << stats.simplifiedOccluders / frames << " occluders simplified and " << stats.skippedOccluders / frames
+            << " skipped per frame to stay within " << OCCLUSION_MAX_OCCLUDER_TRIANGLES << " triangles" << std::endl;
+    }
+
+    std::ostringstream json;
+    json << "  \"occlusion\": {\n"
+        << "    \"occluderTrianglesPerFrame\": " << stats.occluderTriangles / frames << ",\n"
+        << "    \"simplifiedOccludersPerFrame\": " << stats.simplifiedOccluders / frames << ",\n"
+        << "    \"skippedOccludersPerFrame\": " << stats.skippedOccluders / frames << ",\n"
+        << "    \"rasterMillisecondsPerFrame\": " << stats.rasterMilliseconds / frames << ",\n"
+        << "    \"testMillisecondsPerFrame\": " << stats.testMilliseconds / frames << ",\n"
+        << "    \"testedBoxesPerFrame\": " << stats.testedBoxes / frames << ",\n"
+        << "    \"occludedBoxesPerFrame\": " << stats.occludedBoxes / frames << ",\n"
+        << "    \"occludedTrianglesPerFrame\": " << stats.occludedTriangles / frames << "\n"
+        << "  },\n";
+    return json.str();
+}
+
+// Triangles the software rasterizer draws for mesh (levels of detail are appended after the full-detail ones)
+static size_t fullDetailTriangles(const Mesh& mesh) {
+    return (mesh.lods.empty() ? mesh.indices.size() : mesh.lods[0].indexCount) / 3;
+}
+
+// The benchmark without OpenGL: the same frames drawn by the CPU rasterizer on options.threadCount threads
+static int runSoftwareBenchmark(const EngineOptions& options, const Mesh& mesh, const Scene& scene, const Mesh& occluderMesh,
+    const std::vector<CameraKeyframe>& path, double loadMilliseconds, const std::string& picking) {
+    const bool sceneMode = !scene.instances.empty();
+    SoftwareRasterizer rasterizer;
+    if (!rasterizer.create(BENCHMARK_WIDTH, BENCHMARK_HEIGHT, options.threadCount)) {
+        return 1;
+    }
+    std::string renderer = std::string("Sapphin software rasterizer (") + SoftwareRasterizer::kernelName() + ", " +
+        std::to_string(rasterizer.threads()) + " threads)";
+    std::cout << "Benchmark renderer: " << renderer << std::endl;
+    OcclusionCuller occlusion;
+    if (options.occlusion) {
+        occlusion.create(options.threadCount);
+    }
+
+    // Instances are culled by their bounding spheres (and occluders, with --occlusion) and drawn at full detail
+    glm::vec3 meshCenter = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+    float meshRadius = glm::length(mesh.boundsMax - mesh.boundsMin) * 0.5f;
+
+    Camera camera;
+    std::vector<double> frameMilliseconds;
+    size_t totalTriangles = 0;
+    size_t totalDrawCalls = 0;
+    size_t frameCount = std::max<size_t>(options.benchmarkFrames, 1);
+    for (size_t frame = 0; frame < BENCHMARK_WARMUP_FRAMES + frameCount; frame++) {
+        bool timed = frame >= BENCHMARK_WARMUP_FRAMES;
+        size_t step = timed ? frame - BENCHMARK_WARMUP_FRAMES : 0;
+        CameraKeyframe keyframe = sampleCameraPath(path, frameCount > 1 ? static_cast<float>(step) / (frameCount - 1) : 0.0f);
+        camera.setPose(keyframe.position, keyframe.yaw, keyframe.pitch);
+        camera.zoom = keyframe.zoom;
+        if (frame == BENCHMARK_WARMUP_FRAMES) {
+            rasterizer.takeStats();  // Only count timed frames
+            occlusion.takeStats();
+        }
+
+        auto frameStart = std::chrono::steady_clock::now();
+        size_t triangles = 0;
+        size_t drawCalls = 0;
+        glm::mat4 view = camera.getViewMatrix();
+        glm::mat4 projection;
+        updateCameraProjection(projection, camera);
+        OcclusionCuller* frameOcclusion = nullptr;
+        if (options.occlusion) {
+            ProfileZone occlusionZone("Occlusion");
+            prepareOcclusion(occlusion, scene, occluderMesh, view, projection, BENCHMARK_WIDTH, BENCHMARK_HEIGHT);
+            frameOcclusion = &occlusion;
+        }
+        {
+            ProfileZone geometryZone("Geometry");
+            rasterizer.clear(glm::vec4(0.2f, 0.3f, 0.3f, 1.0f));
+            rasterizer.setCamera(view, projection);
+            if (sceneMode) {
+                Frustum frustum = extractFrustum(projection * view);
+                for (const SceneInstance& instance : scene.instances) {
+                    glm::mat4 model = instanceTransform(instance);
+                    glm::vec3 center = glm::vec3(model * glm::vec4(meshCenter, 1.0f));
+                    if (!sphereInFrustum(frustum, center, meshRadius * instance.scale)) {
+                        continue;
+                    }
+                    const Mesh& instanceMesh = scene.meshes[instance.mesh];
+                    if (frameOcclusion && !frameOcclusion->boxVisible(projection * view * model, instanceMesh.boundsMin,
+                        instanceMesh.boundsMax, fullDetailTriangles(instanceMesh))) {
+                        continue;
+                    }
+                    triangles += rasterizer.draw(instanceMesh, model);
+                    drawCalls++;
+                }
+            }
+            else if (!frameOcclusion || frameOcclusion->boxVisible(projection * view, mesh.boundsMin, mesh.boundsMax,
+                fullDetailTriangles(mesh))) {
+                triangles = rasterizer.draw(mesh, glm::mat4(1.0f));
+                drawCalls = 1;
+            }
+        }
+        {
+            ProfileZone rasterZone("Raster");
+            rasterizer.finish();
+        }
+        double milliseconds = millisecondsSince(frameStart);
+
+        if (timed) {
+            frameMilliseconds.push_back(milliseconds);
+            totalTriangles += triangles;
+            totalDrawCalls += drawCalls;
+        }
+    }
+    SoftwareRasterStats rasterStats = rasterizer.takeStats();
+    std::string occlusionEntry = occlusionJson(options, occlusion.takeStats());
+
+    if (!options.profilePath.empty()) {
+        profiler().writeChromeTrace(options.profilePath);
+    }
+    if (!options.imagePath.empty()) {
+        std::vector<uint8_t> pixels;
+        rasterizer.readPixels(pixels);
+        if (writeImagePPM(options.imagePath, BENCHMARK_WIDTH, BENCHMARK_HEIGHT, pixels)) {
+            std::cout << "Last frame saved to " << options.imagePath << std::endl;
+        }
+    }
+
+    // Report
+    std::vector<double> sorted = frameMilliseconds;
+    std::sort(sorted.begin(), sorted.end());
+    double totalMilliseconds = 0.0;
+    for (double milliseconds : sorted) {
+        totalMilliseconds += milliseconds;
+    }
+    double frames = static_cast<double>(sorted.size());
+    double trianglesPerSecond = totalMilliseconds > 0.0 ? totalTriangles / (totalMilliseconds / 1000.0) : 0.0;
+
+    std::string outputPath = options.benchmarkOutput.empty() ? "benchmark.json" : options.benchmarkOutput;
+    std::ofstream output(outputPath);
+    if (!output.is_open()) {
+        std::cerr << "Benchmark: failed to write " << outputPath << std::endl;
+        return 1;
+    }
+    output << "{\n"
+        << "  \"model\": " << jsonString(options.benchmarkModel) << ",\n"
+        << "  \"renderer\": " << jsonString(renderer) << ",\n"
+        << "  \"cameraPath\": " << jsonString(options.cameraPathFile.empty() ? "orbit" : options.cameraPathFile) << ",\n"
+        << "  \"width\": " << BENCHMARK_WIDTH << ",\n"
+        << "  \"height\": " << BENCHMARK_HEIGHT << ",\n"
+        << "  \"instances\": " << (sceneMode ? scene.instances.size() : 1) << ",\n"
+        << "  \"threads\": " << rasterizer.threads() << ",\n"
+        << "  \"kernel\": " << jsonString(SoftwareRasterizer::kernelName()) << ",\n"
+        << "  \"processingFlags\": " << meshProcessingFlags(options) << ",\n"
+        << "  \"meshTriangles\": " << (mesh.lods.empty() ? mesh.indices.size() : mesh.lods[0].indexCount) / 3 << ",\n"
+        << "  \"loadMilliseconds\": " << loadMilliseconds << ",\n"
+        << picking
+        << "  \"frames\": " << sorted.size() << ",\n"
+        << "  \"warmupFrames\": " << BENCHMARK_WARMUP_FRAMES << ",\n"
+        << "  \"frameMilliseconds\": " << frameTimesJson(sorted) << ",\n"
+        << "  \"geometryMillisecondsPerFrame\": " << rasterStats.geometryMilliseconds / frames << ",\n"
+        << "  \"rasterMillisecondsPerFrame\": " << rasterStats.rasterMilliseconds / frames << ",\n"
+        << "  \"trianglesPerFrame\": " << totalTriangles / frames << ",\n"
+        << occlusionEntry
+        << "  \"trianglesBinnedPerFrame\": " << rasterStats.trianglesBinned / frames << ",\n"
+        << "  \"tileReferencesPerFrame\": " << rasterStats.tileReferences / frames << ",\n"
+        << "  \"pixelsShadedPerFrame\": " << rasterStats.pixelsShaded / frames << ",\n"
+        << "  \"trianglesPerSecond\": " << trianglesPerSecond << ",\n"
+        << "  \"drawCallsPerFrame\": " << totalDrawCalls / frames << "\n"
+        << "}\n";
+
+    std::cout << "Benchmark: " << sorted.size() << " frames, p50 " << percentile(sorted, 50.0) << " ms, p95 "
+        << percentile(sorted, 95.0) << " ms, p99 " << percentile(sorted, 99.0) << " ms, "
+        << trianglesPerSecond / 1e6 << " M triangles/s (written to " << outputPath << ")" << std::endl;
+    return 0;
+}
+
+int runBenchmark(const EngineOptions& options) {
+    // Load (from the mesh cache when it is current, like interactive runs)
+    auto loadStart = std::chrono::steady_clock::now();
+    Mesh mesh = loadMeshCached(options.benchmarkModel, meshProcessingFlags(options));
+    double loadMilliseconds = millisecondsSince(loadStart);
+    if (mesh.indices.empty()) {
+        std::cerr << "Benchmark: could not load " << options.benchmarkModel << std::endl;
+        return 1;
+    }
+
+    Scene scene;
+    glm::vec3 boundsMin = mesh.boundsMin;
+    glm::vec3 boundsMax = mesh.boundsMax;
+    if (options.instanceCount > 1) {
+        scene.meshes.push_back(mesh);
+        scene.meshNames.push_back(options.benchmarkModel);
+        addGridInstances(scene, 0, options.instanceCount);
+        float radius = glm::length(mesh.boundsMax - mesh.boundsMin) * 0.5f;
+        for (const SceneInstance& instance : scene.instances) {
+            boundsMin = glm::min(boundsMin, instance.position - glm::vec3(radius));
+            boundsMax = glm::max(boundsMax, instance.position + glm::vec3(radius));
+        }
+    }
+    const bool sceneMode = !scene.instances.empty();
+
+    std::vector<CameraKeyframe> path;
+    if (!options.cameraPathFile.empty()) {
+        if (!loadCameraPath(options.cameraPathFile, path)) {
+            return 1;
+        }
+    }
+    else {
+        path = orbitCameraPath(boundsMin, boundsMax);
+    }
+    // Picks go against the model itself; instances aren't part of the BVH
+    std::string picking = sceneMode ? "" : pickingJson(options, mesh, path);
+    if (sceneMode && options.pickCount > 0) {
+        std::cout << "Picking: skipped, --picks works on a single instance" << std::endl;
+    }
+
+    // Extra occluder geometry, in world space, for --occlusion
+    Mesh occluderMesh;
+    if (!options.occluderPath.empty()) {
+        occluderMesh = loadMeshCached(options.occluderPath, MESH_LODS);
+        if (occluderMesh.indices.empty()) {
+            std::cerr << "Benchmark: could not load the occluders " << options.occluderPath << std::endl;
+            return 1;
+        }
+    }
+    else if (options.occlusion && !sceneMode) {
+        std::cout << "Occlusion: a single model needs --occluders <file.obj>; nothing will be hidden" << std::endl;
+    }
+
+    if (options.softwareRasterizer) {
+        return runSoftwareBenchmark(options, mesh, scene, occluderMesh, path, loadMilliseconds, picking);
+    }
+
+    GLFWwindow* window = initHeadlessOpenGL(BENCHMARK_WIDTH, BENCHMARK_HEIGHT);
+    if (!window) {
+        return 1;
+    }
+    std::string renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    std::cout << "Benchmark renderer: " << renderer << std::endl;
+
+    // Offscreen color and depth targets
+    GLuint framebuffer = 0;
+    GLuint renderbuffers[2] = { 0, 0 };
+    glGenFramebuffers(1, &framebuffer);
+    glGenRenderbuffers(2, renderbuffers);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, BENCHMARK_WIDTH, BENCHMARK_HEIGHT);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, BENCHMARK_WIDTH, BENCHMARK_HEIGHT);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Benchmark: offscreen framebuffer is incomplete" << std::endl;
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(2, renderbuffers);
+        glfwTerminate();
+        return 1;
+    }
+
+    std::string vertexShaderSource;
+    if (sceneMode) {
+        vertexShaderSource = options.packedVertices ? getPackedInstancedVertexShader() : getInstancedVertexShader();
+    }
+    else {
+        vertexShaderSource = options.packedVertices ? getPackedVertexShader() : getDefaultVertexShader();
+    }
+    GLuint shaderProgram = createShaderProgram(vertexShaderSource, getDefaultFragmentShader());
+
+    auto uploadStart = std::chrono::steady_clock::now();
+    GpuMesh gpuMesh;
+    GpuScene gpuScene;
+    if (sceneMode) {
+        gpuScene = uploadScene(scene, options.packedVertices);
+    }
+    else {
+        gpuMesh = options.packedVertices ? uploadPackedMesh(mesh) : uploadMesh(mesh);
+    }
+    glFinish();
+    double uploadMilliseconds = millisecondsSince(uploadStart);
+
+    Camera camera;
+    std::vector<IndexRange> visibleRanges;
+    std::vector<double> frameMilliseconds;
+    size_t totalTriangles = 0;
+    size_t totalDrawCalls = 0;
+    GlCallStats callStats;
+    OcclusionCuller occlusion;
+    if (options.occlusion) {
+        occlusion.create(options.threadCount);
+    }
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+
+    size_t frameCount = std::max<size_t>(options.benchmarkFrames, 1);
+    for (size_t frame = 0; frame < BENCHMARK_WARMUP_FRAMES + frameCount; frame++) {
+        bool timed = frame >= BENCHMARK_WARMUP_FRAMES;
+        size_t step = timed ? frame - BENCHMARK_WARMUP_FRAMES : 0;
+        CameraKeyframe keyframe = sampleCameraPath(path, frameCount > 1 ? static_cast<float>(step) / (frameCount - 1) : 0.0f);
+        camera.setPose(keyframe.position, keyframe.yaw, keyframe.pitch);
+        camera.zoom = keyframe.zoom;
+        glState().resetStats();
+        if (frame == BENCHMARK_WARMUP_FRAMES) {
+            occlusion.takeStats();  // Only count timed frames
+            if (sceneMode) {
+                gpuScene.instanceRing.takeStats();
+            }
+        }
+        profiler().beginFrame();
+
+        auto frameStart = std::chrono::steady_clock::now();
+        size_t triangles = 0;
+        size_t drawCalls = 0;
+        {
+            ProfileZone drawZone("Draw");
+            GpuProfileZone gpuDrawZone("Draw");
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            glm::mat4 view = camera.getViewMatrix();
+            glm::mat4 projection;
+            updateCameraProjection(projection, camera);
+            glm::mat4 model = glm::mat4(1.0f);
+
+            OcclusionCuller* frameOcclusion = nullptr;
+            if (options.occlusion) {
+                ProfileZone occlusionZone("Occlusion");
+                prepareOcclusion(occlusion, scene, occluderMesh, view, projection, BENCHMARK_WIDTH, BENCHMARK_HEIGHT);
+                frameOcclusion = &occlusion;
+            }
+
+            GlStateCache& state = glState();
+            state.useProgram(shaderProgram);
+            const ProgramUniforms& uniforms = state.uniforms(shaderProgram);
+            state.updateCameraBlock(view, projection);
+            state.uniformMatrix4(uniforms.model, model);
+            if (gpuMesh.packed) {
+                state.uniform3(uniforms.positionScale, gpuMesh.positionScale);
+                state.uniform3(uniforms.positionOffset, gpuMesh.positionOffset);
+            }
+
+            if (sceneMode) {
+                SceneDrawStats sceneStats = drawScene(gpuScene, scene, extractFrustum(projection * view), camera.position,
+                    camera.zoom, BENCHMARK_HEIGHT, shaderProgram, frameOcclusion);
+                triangles = sceneStats.triangles;
+                drawCalls = sceneStats.drawCalls;
+            }
+            else {
+                // The model matrix is the identity, so the camera is already in model space
+                MeshDrawStats drawStats = drawMeshView(mesh, gpuMesh, projection * view * model, camera.position, camera.zoom,
+                    BENCHMARK_HEIGHT, visibleRanges, frameOcclusion);
+                triangles = drawStats.triangles;
+                drawCalls = drawStats.drawCalls;
+            }
+        }
+
+        // Nothing is presented, so wait for the GPU to finish the frame before stopping the clock
+        {
+            ProfileZone finishZone("Finish");
+            glFinish();
+        }
+        double milliseconds = millisecondsSince(frameStart);
+
+        if (timed) {
+            frameMilliseconds.push_back(milliseconds);
+            totalTriangles += triangles;
+            totalDrawCalls += drawCalls;
+            callStats.issued += glState().stats().issued;
+            callStats.elided += glState().stats().elided;
+        }
+    }
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        std::cerr << "Benchmark: OpenGL error " << error << " while rendering" << std::endl;
+    }
+
+    if (!options.imagePath.empty()) {
+        std::vector<uint8_t> pixels(static_cast<size_t>(BENCHMARK_WIDTH) * BENCHMARK_HEIGHT * 4);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, BENCHMARK_WIDTH, BENCHMARK_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        if (writeImagePPM(options.imagePath, BENCHMARK_WIDTH, BENCHMARK_HEIGHT, pixels)) {
+            std::cout << "Last frame saved to " << options.imagePath << std::endl;
+        }
+    }
+
+    std::string occlusionEntry = occlusionJson(options, occlusion.takeStats());
+    StreamStats streamStats;
+    bool streamPersistent = false;
+    if (sceneMode) {
+        streamStats = gpuScene.instanceRing.takeStats();
+        streamPersistent = gpuScene.instanceRing.isPersistent();
+    }
+
+    profiler().releaseGpu();
+    if (!options.profilePath.empty()) {
+        profiler().writeChromeTrace(options.profilePath);
+    }
+
+    // Cleanup
+    if (sceneMode) {
+        destroyScene(gpuScene);
+    }
+    else {
+        destroyMesh(gpuMesh);
+    }
+    glState().forgetProgram(shaderProgram);
+    glDeleteProgram(shaderProgram);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(2, renderbuffers);
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    glState().reset();
+
+    // Report
+    std::vector<double> sorted = frameMilliseconds;
+    std::sort(sorted.begin(), sorted.end());
+    double totalMilliseconds = 0.0;
+    for (double milliseconds : sorted) {
+        totalMilliseconds += milliseconds;
+    }
+    double frames = static_cast<double>(sorted.size());
+    double trianglesPerSecond = totalMilliseconds > 0.0 ? totalTriangles / (totalMilliseconds / 1000.0) : 0.0;
+
+    std::string outputPath = options.benchmarkOutput.empty() ? "benchmark.json" : options.benchmarkOutput;
+    std::ofstream output(outputPath);
+    if (!output.is_open()) {
+        std::cerr << "Benchmark: failed to write " << outputPath << std::endl;
+        return 1;
+    }
+    output << "{\n"
+        << "  \"model\": " << jsonString(options.benchmarkModel) << ",\n"
+        << "  \"renderer\": " << jsonString(renderer) << ",\n"
+        << "  \"cameraPath\": " << jsonString(options.cameraPathFile.empty() ? "orbit" : options.cameraPathFile) << ",\n"
+        << "  \"width\": " << BENCHMARK_WIDTH << ",\n"
+        << "  \"height\": " << BENCHMARK_HEIGHT << ",\n"
+        << "  \"instances\": " << (sceneMode ? scene.instances.size() : 1) << ",\n"
+        << "  \"packedVertices\": " << (options.packedVertices ? "true" : "false") << ",\n"
+        << "  \"processingFlags\": " << meshProcessingFlags(options) << ",\n"
+        << "  \"meshTriangles\": " << (mesh.lods.empty() ? mesh.indices.size() : mesh.lods[0].indexCount) / 3 << ",\n"
+        << "  \"loadMilliseconds\": " << loadMilliseconds << ",\n"
+        << picking
+        << "  \"uploadMilliseconds\": " << uploadMilliseconds << ",\n"
+        << "  \"frames\": " << sorted.size() << ",\n"
+        << "  \"warmupFrames\": " << BENCHMARK_WARMUP_FRAMES << ",\n"
+        << "  \"frameMilliseconds\": " << frameTimesJson(sorted) << ",\n"
+        << "  \"trianglesPerFrame\": " << totalTriangles / frames << ",\n"
+        << occlusionEntry
+        << "  \"trianglesPerSecond\": " << trianglesPerSecond << ",\n"
+        << "  \"drawCallsPerFrame\": " << totalDrawCalls / frames << ",\n"
+        << "  \"glCallsIssuedPerFrame\": " << callStats.issued / frames << ",\n"
+        << "  \"glCallsElidedPerFrame\": " << callStats.elided / frames << ",\n"
+        << "  \"streaming\": " << jsonString(!sceneMode ? "none" : streamPersistent ? "persistent" : "orphaned") << ",\n"
+        << "  \"streamedBytesPerFrame\": " << streamStats.bytesUploaded / frames << ",\n"
+        << "  \"streamWaitMillisecondsPerFrame\": " << streamStats.waitMilliseconds / frames << "\n"
+        << "}\n";
+
+    std::cout << "Benchmark: " << sorted.size() << " frames, p50 " << percentile(sorted, 50.0) << " ms, p95 "
+        << percentile(sorted, 95.0) << " ms, p99 " << percentile(sorted, 99.0) << " ms, "
+        << trianglesPerSecond / 1e6 << " M triangles/s (written to " << outputPath << ")" << std::endl;
+    return 0;
+}
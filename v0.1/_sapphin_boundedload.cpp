@@ -0,0 +1,337 @@
+// _sapphin_boundedload.cpp
+// This loads .obj files in a few streaming passes, accounting for every buffer it allocates.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+
+// Headers
+#include "headers/_sapphin_boundedload.h"
+#include "headers/_sapphin_objparser.h"
+#include "headers/_sapphin_modeling.h"
+#include "headers/_sapphin_utils.h"
+#include "headers/_sapphin_types.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+
+// Bytes held by all bounded loads running at once, and the most they held together
+static std::atomic<size_t> allLoadsHeldBytes{ 0 };
+static std::atomic<size_t> allLoadsPeakBytes{ 0 };
+
+static void addAllLoadsBytes(size_t bytes) {
+    size_t held = allLoadsHeldBytes += bytes;
+    size_t peak = allLoadsPeakBytes;
+    while (held > peak && !allLoadsPeakBytes.compare_exchange_weak(peak, held)) {
+    }
+}
+
+size_t boundedLoadPeakBytes() {
+    return allLoadsPeakBytes;
+}
+
+void resetBoundedLoadPeak() {
+    allLoadsPeakBytes = allLoadsHeldBytes.load();
+}
+
+// Bytes held by the loader's buffers, and the most held at once in every stage.
+// Buffers only change size through reserve() and release(), so the count is exact.
+class LoadMemoryTracker {
+public:
+    explicit LoadMemoryTracker(LoadMemoryStats& stats) : stats(stats) {}
+
+    // Whatever is still held (the mesh, or buffers of a load that stopped early) leaves the loader's hands here
+    ~LoadMemoryTracker() {
+        allLoadsHeldBytes -= heldBytes;
+    }
+
+    void beginStage(const char* name) {
+        endStage();
+        LoadStageMemory stage;
+        stage.name = name;
+        stage.peakBytes = heldBytes;
+        stats.stages.push_back(stage);
+        stageStart = std::chrono::steady_clock::now();
+        inStage = true;
+    }
+
+    void endStage() {
+        if (inStage) {
+            stats.stages.back().milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - stageStart).count();
+            inStage = false;
+        }
+    }
+
+    // Grow values to hold count elements. While the elements move, the old and the new block both exist;
+    // returns false (and allocates nothing) if that would go over the budget.
+    template <typename T>
+    bool reserve(std::vector<T>& values, size_t count) {
+        if (count <= values.capacity()) {
+            return true;
+        }
+        size_t oldBytes = values.capacity() * sizeof(T);
+        size_t newBytes = count * sizeof(T);
+        if (stats.budgetBytes > 0 && heldBytes + newBytes > stats.budgetBytes) {
+            return false;
+        }
+        values.reserve(count);
+        heldBytes += newBytes;
+        addAllLoadsBytes(newBytes);
+        notePeak();
+        heldBytes -= oldBytes;
+        allLoadsHeldBytes -= oldBytes;
+        return true;
+    }
+
+    template <typename T>
+    void release(std::vector<T>& values) {
+        heldBytes -= values.capacity() * sizeof(T);
+        allLoadsHeldBytes -= values.capacity() * sizeof(T);
+        std::vector<T>().swap(values);
+    }
+
+private:
+    void notePeak() {
+        stats.peakBytes = std::max(stats.peakBytes, heldBytes);
+        if (inStage) {
+            stats.stages.back().peakBytes = std::max(stats.stages.back().peakBytes, heldBytes);
+        }
+    }
+
+    LoadMemoryStats& stats;
+    size_t heldBytes = 0;
+    bool inStage = false;
+    std::chrono::steady_clock::time_point stageStart;
+};
+
+static double megabytes(size_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+static void printLoadMemory(const LoadMemoryStats& stats) {
+    std::cout << "Load memory: " << megabytes(stats.peakBytes) << " MB peak (planned " << megabytes(stats.plannedBytes) << " MB";
+    if (stats.budgetBytes > 0) {
+        std::cout << ", budget " << megabytes(stats.budgetBytes) << " MB";
+    }
+    std::cout << ", plus " << megabytes(stats.mappedBytes) << " MB mapped file)";
+    for (size_t i = 0; i < stats.stages.size(); i++) {
+        std::cout << (i ? ", " : "; ") << stats.stages[i].name << " " << megabytes(stats.stages[i].peakBytes) << " MB in "
+            << stats.stages[i].milliseconds << " ms";
+    }
+    std::cout << std::endl;
+}
+
+Mesh loadMeshBounded(const std::string& filename, size_t budgetBytes, LoadMemoryStats* statsOut, unsigned threadCount,
+    const std::atomic<bool>* cancel) {
+    Mesh mesh;
+    LoadMemoryStats localStats;
+    LoadMemoryStats& stats = statsOut ? *statsOut : localStats;
+    stats = LoadMemoryStats();
+    stats.budgetBytes = budgetBytes;
+    LoadMemoryTracker tracker(stats);
+
+    MappedFile file;
+    if (!file.open(filename)) {
+        std::cerr << "Could not open the file: " << filename << std::endl;
+        return mesh;
+    }
+    stats.mappedBytes = file.size();
+    const char* begin = file.data();
+    const char* end = file.data() + file.size();
+
+    // Count every kind of record, then work out what the passes below will hold at their peak
+    tracker.beginStage("counting");
+    ObjCounts counts = countObjRecords(begin, end, threadCount);
+    const bool textured = counts.texcoords > 0;
+    const bool colored = counts.coloredPositions > 0;
+    // One vertex per position without texture coordinates; with them, seams add a few percent (more are grown into)
+    size_t expectedVertices = counts.positions;
+    if (textured) {
+        expectedVertices = std::max(counts.positions, counts.texcoords);
+        expectedVertices += expectedVertices / 32;
+    }
+    stats.plannedBytes = counts.positions * (sizeof(glm::vec3) + sizeof(int) + (colored ? sizeof(glm::vec4) : 0))
+        + counts.texcoords * sizeof(glm::vec2)
+        + expectedVertices * (sizeof(Vertex) + (textured ? 2 * sizeof(int) : 0))
+        + counts.faces * 3 * sizeof(uint32_t)
+        + std::min(counts.faces, BOUNDED_FACE_BLOCK) * sizeof(ObjFace);
+    if (budgetBytes > 0 && stats.plannedBytes > budgetBytes) {
+        tracker.endStage();
+        stats.overBudget = true;
+        std::cerr << filename << " needs about " << megabytes(stats.plannedBytes) << " MB to load, more than the budget of "
+            << megabytes(budgetBytes) << " MB" << std::endl;
+        return mesh;
+    }
+
+    // Positions, colors (only if the file has any) and texture coordinates, parsed into exactly sized buffers
+    tracker.beginStage("attributes");
+    ObjData data;
+    tracker.reserve(data.positions, counts.positions);
+    tracker.reserve(data.texcoords, counts.texcoords);
+    if (colored) {
+        tracker.reserve(data.colors, counts.positions);
+    }
+    parseObjAttributes(begin, end, data);
+    const int positionCount = static_cast<int>(data.positions.size());
+    const int texcoordCount = static_cast<int>(data.texcoords.size());
+
+    // Faces, one block at a time. Vertices are unique (position, texcoord) pairs in order of first use, like
+    // loadMesh. The first vertex of every position sums the position's face normals, in file order.
+    tracker.beginStage("faces");
+    std::vector<int> firstVertexOfPosition;
+    std::vector<int> nextVertexOfPosition;  // Other vertices of the same position; only needed with texcoords
+    std::vector<int> vertexTexIndex;
+    std::vector<ObjFace> block;
+    bool fits = tracker.reserve(firstVertexOfPosition, counts.positions)
+        && tracker.reserve(mesh.vertices, expectedVertices)
+        && tracker.reserve(mesh.indices, counts.faces * 3)
+        && tracker.reserve(block, std::min(counts.faces, BOUNDED_FACE_BLOCK));
+    if (textured) {
+        fits = fits && tracker.reserve(nextVertexOfPosition, expectedVertices) && tracker.reserve(vertexTexIndex, expectedVertices);
+    }
+    if (fits) {
+        firstVertexOfPosition.resize(positionCount, -1);
+    }
+
+    ObjFaceStream stream;
+    stream.cursor = begin;
+    stream.end = end;
+    size_t skippedFaces = 0;
+    while (fits && readObjFaces(stream, block, BOUNDED_FACE_BLOCK)) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) {
+            return Mesh();
+        }
+        for (const ObjFace& face : block) {
+            bool valid = true;
+            for (int i = 0; i < 3; i++) {
+                valid = valid && face.posIndices[i] >= 0 && face.posIndices[i] < positionCount;
+            }
+            if (!valid) {
+                skippedFaces++;
+                continue;
+            }
+
+            for (int i = 0; i < 3 && fits; i++) {
+                int posIdx = face.posIndices[i];
+                int texIdx = (face.texIndices[i] >= 0 && face.texIndices[i] < texcoordCount) ? face.texIndices[i] : -1;
+
+                int vertexIdx = firstVertexOfPosition[posIdx];
+                while (textured && vertexIdx >= 0 && vertexTexIndex[vertexIdx] != texIdx) {
+                    vertexIdx = nextVertexOfPosition[vertexIdx];
+                }
+                if (vertexIdx < 0) {
+                    // Past the estimate: grow by a quarter rather than doubling
+                    size_t needed = mesh.vertices.size() + 1;
+                    if (needed > mesh.vertices.capacity()) {
+                        size_t grown = needed + needed / 4;
+                        fits = tracker.reserve(mesh.vertices, grown);
+                        fits = fits && (!textured || (tracker.reserve(nextVertexOfPosition, grown) && tracker.reserve(vertexTexIndex, grown)));
+                        if (!fits) {
+                            break;
+                        }
+                    }
+
+                    vertexIdx = static_cast<int>(mesh.vertices.size());
+                    const glm::vec3& position = data.positions[posIdx];
+                    const glm::vec4& color = data.colors.empty() ? OBJ_DEFAULT_COLOR : data.colors[posIdx];
+                    Vertex vertex;
+                    vertex.x = position.x;
+                    vertex.y = position.y;
+                    vertex.z = position.z;
+                    vertex.nx = vertex.ny = vertex.nz = 0.0f;
+                    vertex.u = texIdx >= 0 ? data.texcoords[texIdx].x : 0.0f;
+                    vertex.v = texIdx >= 0 ? data.texcoords[texIdx].y : 0.0f;
+                    vertex.r = color.r;
+                    vertex.g = color.g;
+                    vertex.b = color.b;
+                    vertex.a = color.a;
+                    mesh.vertices.push_back(vertex);
+
+                    // The first vertex of a position stays first; later ones are linked in behind it
+                    int& first = firstVertexOfPosition[posIdx];
+                    if (textured) {
+                        vertexTexIndex.push_back(texIdx);
+                        nextVertexOfPosition.push_back(first >= 0 ? nextVertexOfPosition[first] : -1);
+                        if (first >= 0) {
+                            nextVertexOfPosition[first] = vertexIdx;
+                        }
+                    }
+                    if (first < 0) {
+                        first = vertexIdx;
+                    }
+                }
+                mesh.indices.push_back(static_cast<uint32_t>(vertexIdx));
+            }
+            if (!fits) {
+                break;
+            }
+
+            // Unit face normal, with the same operations (and order) as computeVertexNormals
+            const glm::vec3& p0 = data.positions[face.posIndices[0]];
+            const glm::vec3& p1 = data.positions[face.posIndices[1]];
+            const glm::vec3& p2 = data.positions[face.posIndices[2]];
+            float e1x = p1.x - p0.x, e1y = p1.y - p0.y, e1z = p1.z - p0.z;
+            float e2x = p2.x - p0.x, e2y = p2.y - p0.y, e2z = p2.z - p0.z;
+            float cx = e1y * e2z - e2y * e1z;
+            float cy = e1z * e2x - e2z * e1x;
+            float cz = e1x * e2y - e2x * e1y;
+            float inverseLength = 1.0f / std::sqrt(cx * cx + cy * cy + cz * cz);
+            for (int i = 0; i < 3; i++) {
+                Vertex& sum = mesh.vertices[firstVertexOfPosition[face.posIndices[i]]];
+                sum.nx += cx * inverseLength;
+                sum.ny += cy * inverseLength;
+                sum.nz += cz * inverseLength;
+            }
+        }
+    }
+    if (!fits) {
+        tracker.endStage();
+        stats.overBudget = true;
+        std::cerr << filename << " has more unique vertices than expected and no longer fits in the budget of "
+            << megabytes(budgetBytes) << " MB" << std::endl;
+        printLoadMemory(stats);
+        return Mesh();
+    }
+    if (skippedFaces > 0) {
+        std::cerr << "Skipped " << skippedFaces << " faces with invalid vertex indices." << std::endl;
+    }
+    tracker.release(block);
+    tracker.release(data.positions);
+    tracker.release(data.colors);
+    tracker.release(data.texcoords);
+
+    // Normalize the sums and hand them to the other vertices of each position
+    tracker.beginStage("normals");
+    for (int posIdx = 0; posIdx < positionCount; posIdx++) {
+        int first = firstVertexOfPosition[posIdx];
+        if (first < 0) {
+            continue;
+        }
+        Vertex& vertex = mesh.vertices[first];
+        glm::vec3 normal(vertex.nx, vertex.ny, vertex.nz);
+        if (glm::length(normal) > 0.0f) {
+            normal = glm::normalize(normal);
+        }
+        for (int v = first; v >= 0; v = textured ? nextVertexOfPosition[v] : -1) {
+            mesh.vertices[v].nx = normal.x;
+            mesh.vertices[v].ny = normal.y;
+            mesh.vertices[v].nz = normal.z;
+        }
+    }
+    tracker.release(firstVertexOfPosition);
+    tracker.release(nextVertexOfPosition);
+    tracker.release(vertexTexIndex);
+    computeMeshBounds(mesh);
+    tracker.endStage();
+
+    std::cout << "Model loading statistics:" << std::endl;
+    std::cout << "Unique vertices: " << mesh.vertices.size() << " (" << mesh.indices.size() << " indices)" << std::endl;
+    std::cout << "UV coords loaded: " << counts.texcoords << std::endl;
+    printLoadMemory(stats);
+    return mesh;
+}
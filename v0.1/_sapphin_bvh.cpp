@@ -0,0 +1,164 @@
+// _sapphin_bvh.cpp
+// This builds a bounding volume hierarchy over the chunks of a mesh, so whole regions can be culled at once.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+// Headers
+#include "headers/_sapphin_bvh.h"
+#include "headers/_sapphin_meshopt.h"
+#include "headers/_sapphin_types.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+
+// Chunk the hierarchy is built over: one triangle, or one meshlet
+struct BvhItem {
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    glm::vec3 centroid;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+};
+
+struct BvhBuilder {
+    const std::vector<BvhItem>& items;
+    std::vector<uint32_t>& order;  // Item order; every node covers order[begin, end)
+    std::vector<BvhNode>& nodes;
+    unsigned leafSize;
+
+    // Builds the node for order[begin, end) and returns its position in nodes.
+    // firstMeshlet/meshletCount temporarily hold the item range until buildMeshBvh renumbers the indices.
+    uint32_t build(size_t begin, size_t end) {
+        uint32_t nodeIndex = static_cast<uint32_t>(nodes.size());
+        nodes.push_back(BvhNode());
+
+        glm::vec3 boundsMin(INFINITY), boundsMax(-INFINITY);
+        glm::vec3 centroidMin(INFINITY), centroidMax(-INFINITY);
+        for (size_t i = begin; i < end; i++) {
+            const BvhItem& item = items[order[i]];
+            boundsMin = glm::min(boundsMin, item.boundsMin);
+            boundsMax = glm::max(boundsMax, item.boundsMax);
+            centroidMin = glm::min(centroidMin, item.centroid);
+            centroidMax = glm::max(centroidMax, item.centroid);
+        }
+
+        BvhNode node = {};
+        node.boundsMin = boundsMin;
+        node.boundsMax = boundsMax;
+        node.firstMeshlet = static_cast<uint32_t>(begin);
+        node.meshletCount = static_cast<uint32_t>(end - begin);
+
+        if (end - begin <= leafSize) {
+            // Keep the previous order inside the leaf
+            std::sort(order.begin() + begin, order.begin() + end);
+        }
+        else {
+            // Median split along the axis where the centroids spread the most
+            glm::vec3 extent = centroidMax - centroidMin;
+            int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+            size_t middle = begin + (end - begin) / 2;
+            std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+                [&](uint32_t a, uint32_t b) { return items[a].centroid[axis] < items[b].centroid[axis]; });
+
+            build(begin, middle);
+            node.rightChild = build(middle, end);
+        }
+        nodes[nodeIndex] = node;
+        return nodeIndex;
+    }
+};
+
+void buildMeshBvh(Mesh& mesh) {
+    auto start = std::chrono::steady_clock::now();
+    mesh.bvh.clear();
+    if (mesh.indices.empty()) {
+        return;
+    }
+
+    auto position = [&](uint32_t index) {
+        const Vertex& vertex = mesh.vertices[index];
+        return glm::vec3(vertex.x, vertex.y, vertex.z);
+    };
+
+    // Chunks: the meshlets if there are any, single triangles otherwise
+    const bool useMeshlets = !mesh.meshlets.empty();
+    std::vector<BvhItem> items;
+    if (useMeshlets) {
+        items.resize(mesh.meshlets.size());
+        for (size_t m = 0; m < mesh.meshlets.size(); m++) {
+            const Meshlet& meshlet = mesh.meshlets[m];
+            BvhItem& item = items[m];
+            item.boundsMin = glm::vec3(INFINITY);
+            item.boundsMax = glm::vec3(-INFINITY);
+            for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+                glm::vec3 p = position(mesh.indices[meshlet.firstIndex + i]);
+                item.boundsMin = glm::min(item.boundsMin, p);
+                item.boundsMax = glm::max(item.boundsMax, p);
+            }
+            item.centroid = (item.boundsMin + item.boundsMax) * 0.5f;
+            item.firstIndex = meshlet.firstIndex;
+            item.indexCount = meshlet.indexCount;
+        }
+    }
+    else {
+        items.resize(mesh.indices.size() / 3);
+        for (size_t t = 0; t < items.size(); t++) {
+            glm::vec3 p0 = position(mesh.indices[t * 3]), p1 = position(mesh.indices[t * 3 + 1]), p2 = position(mesh.indices[t * 3 + 2]);
+            BvhItem& item = items[t];
+            item.boundsMin = glm::min(p0, glm::min(p1, p2));
+            item.boundsMax = glm::max(p0, glm::max(p1, p2));
+            item.centroid = (p0 + p1 + p2) / 3.0f;
+            item.firstIndex = static_cast<uint32_t>(t * 3);
+            item.indexCount = 3;
+        }
+    }
+
+    std::vector<uint32_t> order(items.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = static_cast<uint32_t>(i);
+    }
+    BvhBuilder builder{ items, order, mesh.bvh, useMeshlets ? BVH_LEAF_MESHLETS : BVH_LEAF_TRIANGLES };
+    builder.build(0, items.size());
+
+    // Rewrite the index buffer (and meshlets) in leaf order and record where every item starts
+    std::vector<uint32_t> indices;
+    indices.reserve(mesh.indices.size());
+    std::vector<uint32_t> itemStart(items.size() + 1);
+    std::vector<Meshlet> meshlets;
+    meshlets.reserve(mesh.meshlets.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        const BvhItem& item = items[order[i]];
+        itemStart[i] = static_cast<uint32_t>(indices.size());
+        if (useMeshlets) {
+            meshlets.push_back(mesh.meshlets[order[i]]);
+            meshlets.back().firstIndex = itemStart[i];
+        }
+        indices.insert(indices.end(), mesh.indices.begin() + item.firstIndex, mesh.indices.begin() + item.firstIndex + item.indexCount);
+    }
+    itemStart[order.size()] = static_cast<uint32_t>(indices.size());
+    mesh.indices.swap(indices);
+    mesh.meshlets.swap(meshlets);
+
+    for (BvhNode& node : mesh.bvh) {
+        uint32_t firstItem = node.firstMeshlet;
+        uint32_t itemCount = node.meshletCount;
+        node.firstIndex = itemStart[firstItem];
+        node.indexCount = itemStart[firstItem + itemCount] - itemStart[firstItem];
+        if (!useMeshlets) {
+            node.firstMeshlet = 0;
+            node.meshletCount = 0;
+        }
+    }
+
+    // Vertices follow the new triangle order again
+    optimizeVertexFetch(mesh);
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Built a BVH with " << mesh.bvh.size() << " nodes over " << items.size()
+        << (useMeshlets ? " meshlets" : " triangles") << " in " << elapsed.count() << " ms" << std::endl;
+}
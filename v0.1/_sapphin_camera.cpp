@@ -46,6 +46,14 @@ Camera::Camera(glm::vec3 position, glm::vec3 up, float yaw, float pitch)
     updateCameraVectors();
 }
 
+// Place the camera directly (used when replaying recorded camera paths)
+void Camera::setPose(const glm::vec3& position, float yaw, float pitch) {
+    this->position = position;
+    this->yaw = yaw;
+    this->pitch = pitch;
+    updateCameraVectors();
+}
+
 // Get view matrix
 glm::mat4 Camera::getViewMatrix() {
     return glm::lookAt(position, position + front, up);
@@ -162,15 +170,75 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
 	}
 }
 
+static bool modelSwitchRequested = false;
+
+bool takeModelSwitchRequest() {
+    bool requested = modelSwitchRequested;
+    modelSwitchRequested = false;
+    return requested;
+}
+
+static PickRequest pickRequested = PICK_NONE;
+
+static std::string droppedFile;
+
+void drop_callback(GLFWwindow* window, int count, const char** paths) {
+    if (count > 0) {
+        droppedFile = paths[count - 1];
+    }
+}
+
+bool takeDroppedFile(std::string& path) {
+    if (droppedFile.empty()) {
+        return false;
+    }
+    path.swap(droppedFile);
+    droppedFile.clear();
+    return true;
+}
+
+PickRequest takePickRequest() {
+    PickRequest requested = pickRequested;
+    pickRequested = PICK_NONE;
+    return requested;
+}
+
+bool cameraKeysHeld(GLFWwindow* window) {
+    const int keys[] = { GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_UP, GLFW_KEY_DOWN };
+    for (int key : keys) {
+        if (glfwGetKey(window, key) == GLFW_PRESS) {
+            return true;
+        }
+    }
+    return false;
+}
+
 // Process all input with this function
 void processInput(GLFWwindow* window, Camera& camera, float deltaTime) {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
-    if (glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS) {
-        glfwSetWindowUserPointer(window, reinterpret_cast<void*>(1));
-        glfwSetWindowShouldClose(window, true);
+    // N asks for another model once per key press; the render loop takes it with takeModelSwitchRequest()
+    static bool switchKeyDown = false;
+    bool switchKeyPressed = glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS;
+    if (switchKeyPressed && !switchKeyDown) {
+        modelSwitchRequested = true;
+    }
+    switchKeyDown = switchKeyPressed;
+
+    // Clicks pick under the cursor, once per press; the render loop takes them with takePickRequest()
+    static bool selectButtonDown = false;
+    static bool measureButtonDown = false;
+    bool selectButtonPressed = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+    bool measureButtonPressed = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
+    if (selectButtonPressed && !selectButtonDown) {
+        pickRequested = PICK_SELECT;
+    }
+    else if (measureButtonPressed && !measureButtonDown) {
+        pickRequested = PICK_MEASURE;
     }
+    selectButtonDown = selectButtonPressed;
+    measureButtonDown = measureButtonPressed;
 
     // Sprint handling
     if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS) {
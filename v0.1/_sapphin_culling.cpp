@@ -0,0 +1,157 @@
+// _sapphin_culling.cpp
+// This decides on the CPU which parts of a mesh can be skipped for the current view.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+
+#include <vector>
+#include <cmath>
+#include <chrono>
+
+// Headers
+#include "headers/_sapphin_culling.h"
+#include "headers/_sapphin_occlusion.h"
+#include "headers/_sapphin_types.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+
+// Gribb and Hartmann: every plane is the fourth row of the matrix plus or minus one of the others
+Frustum extractFrustum(const glm::mat4& viewProjection) {
+    Frustum frustum;
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++) {
+        row[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+    frustum.planes[0] = row[3] + row[0];  // Left
+    frustum.planes[1] = row[3] - row[0];  // Right
+    frustum.planes[2] = row[3] + row[1];  // Bottom
+    frustum.planes[3] = row[3] - row[1];  // Top
+    frustum.planes[4] = row[3] + row[2];  // Near
+    frustum.planes[5] = row[3] - row[2];  // Far
+
+    for (glm::vec4& plane : frustum.planes) {
+        float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f) plane /= length;
+    }
+    return frustum;
+}
+
+bool sphereInFrustum(const Frustum& frustum, const glm::vec3& center, float radius) {
+    for (const glm::vec4& plane : frustum.planes) {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+FrustumTest boxInFrustum(const Frustum& frustum, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    FrustumTest result = FRUSTUM_INSIDE;
+    for (const glm::vec4& plane : frustum.planes) {
+        // Corners furthest along and against the plane normal
+        glm::vec3 positive(plane.x >= 0.0f ? boundsMax.x : boundsMin.x, plane.y >= 0.0f ? boundsMax.y : boundsMin.y,
+            plane.z >= 0.0f ? boundsMax.z : boundsMin.z);
+        glm::vec3 negative(plane.x >= 0.0f ? boundsMin.x : boundsMax.x, plane.y >= 0.0f ? boundsMin.y : boundsMax.y,
+            plane.z >= 0.0f ? boundsMin.z : boundsMax.z);
+        if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f) {
+            return FRUSTUM_OUTSIDE;
+        }
+        if (glm::dot(glm::vec3(plane), negative) + plane.w < 0.0f) {
+            result = FRUSTUM_INTERSECTS;
+        }
+    }
+    return result;
+}
+
+static inline bool meshletFacesAway(const Meshlet& meshlet, const glm::vec3& cameraPosition) {
+    glm::vec3 toApex = meshlet.coneApex - cameraPosition;
+    float distance = glm::length(toApex);
+    return distance > 0.0f && glm::dot(toApex, meshlet.coneAxis) >= meshlet.coneCutoff * distance;
+}
+
+static inline void appendRange(std::vector<IndexRange>& ranges, uint32_t firstIndex, uint32_t indexCount) {
+    if (!ranges.empty() && ranges.back().firstIndex + ranges.back().indexCount == firstIndex) {
+        ranges.back().indexCount += indexCount;
+    }
+    else {
+        ranges.push_back({ firstIndex, indexCount });
+    }
+}
+
+MeshletCullStats cullMeshlets(const std::vector<Meshlet>& meshlets, const Frustum& frustum, const glm::vec3& cameraPosition,
+    std::vector<IndexRange>& ranges) {
+    MeshletCullStats stats;
+    ranges.clear();
+
+    for (const Meshlet& meshlet : meshlets) {
+        if (!sphereInFrustum(frustum, meshlet.center, meshlet.radius)) {
+            stats.frustumCulled++;
+            continue;
+        }
+
+        // Every triangle faces away when the camera lies inside the negated normal cone
+        if (meshletFacesAway(meshlet, cameraPosition)) {
+            stats.backfaceCulled++;
+            continue;
+        }
+
+        stats.visible++;
+        appendRange(ranges, meshlet.firstIndex, meshlet.indexCount);
+    }
+    return stats;
+}
+
+BvhCullStats cullMeshBvh(const Mesh& mesh, const Frustum& frustum, const glm::vec3& cameraPosition, std::vector<IndexRange>& ranges,
+    OcclusionCuller* occlusion, const glm::mat4& modelViewProjection) {
+    auto start = std::chrono::steady_clock::now();
+    BvhCullStats stats;
+    ranges.clear();
+    if (mesh.bvh.empty()) {
+        return stats;
+    }
+
+    // Children are visited left first, so ranges come out in index buffer order and merge.
+    // Median splits keep the tree depth under 32, so the stack cannot overflow.
+    uint32_t stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        const BvhNode& node = mesh.bvh[stack[--stackSize]];
+        stats.visitedNodes++;
+
+        FrustumTest test = boxInFrustum(frustum, node.boundsMin, node.boundsMax);
+        if (test == FRUSTUM_OUTSIDE) {
+            stats.culledTriangles += node.indexCount / 3;
+            continue;
+        }
+        if (occlusion && occlusion->ready() && !occlusion->boxVisible(modelViewProjection, node.boundsMin, node.boundsMax, node.indexCount / 3)) {
+            stats.occludedTriangles += node.indexCount / 3;
+            continue;
+        }
+
+        if (node.meshletCount > 0 && (test == FRUSTUM_INSIDE || node.rightChild == 0)) {
+            // Meshlets still get their own cone test (and sphere test, unless the node is fully inside)
+            for (uint32_t m = node.firstMeshlet; m < node.firstMeshlet + node.meshletCount; m++) {
+                const Meshlet& meshlet = mesh.meshlets[m];
+                if ((test != FRUSTUM_INSIDE && !sphereInFrustum(frustum, meshlet.center, meshlet.radius)) ||
+                    meshletFacesAway(meshlet, cameraPosition)) {
+                    stats.culledTriangles += meshlet.indexCount / 3;
+                    continue;
+                }
+                appendRange(ranges, meshlet.firstIndex, meshlet.indexCount);
+                stats.drawnTriangles += meshlet.indexCount / 3;
+            }
+        }
+        else if (test == FRUSTUM_INSIDE || node.rightChild == 0) {
+            appendRange(ranges, node.firstIndex, node.indexCount);
+            stats.drawnTriangles += node.indexCount / 3;
+        }
+        else {
+            stack[stackSize++] = node.rightChild;
+            stack[stackSize++] = static_cast<uint32_t>(&node - mesh.bvh.data()) + 1;
+        }
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    stats.cullMilliseconds = elapsed.count();
+    return stats;
+}
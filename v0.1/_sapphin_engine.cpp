@@ -11,12 +11,25 @@
 #include <sstream>
 #include <chrono>
 #include <thread>
+#include <algorithm>
 
 // Headers
 #include "headers/_sapphin_utils.h"
 #include "headers/_sapphin_camera.h"
 #include "headers/_sapphin_render.h"
 #include "headers/_sapphin_modeling.h"
+#include "headers/_sapphin_culling.h"
+#include "headers/_sapphin_lod.h"
+#include "headers/_sapphin_scene.h"
+#include "headers/_sapphin_glstate.h"
+#include "headers/_sapphin_benchmark.h"
+#include "headers/_sapphin_profiler.h"
+#include "headers/_sapphin_asyncload.h"
+#include "headers/_sapphin_preprocess.h"
+#include "headers/_sapphin_microbench.h"
+#include "headers/_sapphin_picking.h"
+#include "headers/_sapphin_occlusion.h"
+#include "headers/_sapphin_pacing.h"
 #include "headers/_sapphin_types.h"
 #include "lib/GLEW.win32/GLEW-lib/include/GL/glew.h"
 #include "lib/GLFW.win32/GLFW-lib/include/GLFW/glfw3.h"
@@ -26,165 +39,511 @@
 #include "lib/GLM.win32/GLM-lib/glm/gtc/matrix_transform.hpp"
 #include "lib/GLM.win32/GLM-lib/glm/gtc/type_ptr.hpp"
 
-int main() {
-    bool continueRendering = true;
+// Shown when there is no model to load
+static Mesh defaultTriangleMesh() {
+    Mesh mesh;
+    mesh.vertices = {
+        Vertex{-0.5f, -0.5f, 0.0f,  0.0f, 0.0f, 1.0f,  0.0f, 0.0f},
+        Vertex{ 0.5f, -0.5f, 0.0f,  0.0f, 0.0f, 1.0f,  1.0f, 0.0f},
+        Vertex{ 0.0f,  0.5f, 0.0f,  0.0f, 0.0f, 1.0f,  0.5f, 1.0f}
+    };
+    mesh.indices = { 0, 1, 2 };
+    computeMeshBounds(mesh);
+    return mesh;
+}
 
-    // Main loop
-    while (continueRendering) {
-        // Welcome and instructions
-        continueRendering = false;
-        typewriterEffect("Welcome to Sapphin 3D Renderer.", CYAN, 50);
-        typewriterEffect("The app where you can render your creations and show them to your friends.", CYAN, 50);
-        typewriterEffect("If you don't have a file to display, you can render a default triangle.\nWrite 'triangle' without quotes.", BLUE, 30);
-        typewriterEffect("Enter the name of the file to load it (without the .obj extension):", GREEN, 30);
+// Whether the camera moved, turned or zoomed between two poses
+static bool samePose(const CameraKeyframe& a, const CameraKeyframe& b) {
+    return a.position == b.position && a.yaw == b.yaw && a.pitch == b.pitch && a.zoom == b.zoom;
+}
+
+// Ask on the console for the model to show; keeps asking until something was entered
+static std::string promptModelFilename() {
+    typewriterEffect("If you don't have a file to display, you can render a default triangle.\nWrite 'triangle' without quotes.", BLUE, 30);
+    typewriterEffect("Enter the name of the file to load it (without the .obj extension):", GREEN, 30);
 
-        // Get filename from user
-        std::string filename;
+    // Get filename from user
+    std::string filename;
+    std::getline(std::cin, filename);
+    filename += ".obj";
+
+    // Validate filename input
+    while (filename == ".obj") {
+        typewriterEffect("Please input a filename to simulate a .obj file.", BLUE, 30);
+        typewriterEffect("Enter the name of the file to load it (without the .obj extension):", GREEN, 30);
+        filename.clear();
         std::getline(std::cin, filename);
+        if (filename.substr(filename.length() - 4) != ".obj") {
+            typewriterEffect("Please pick a valid file format (.obj).", RED, 50);
+        }
         filename += ".obj";
+    }
+    return filename;
+}
+
+int main(int argc, char** argv) {
+    EngineOptions options;
+    if (!parseCommandLine(argc, argv, options)) {
+        return 0;
+    }
+
+    profiler().setEnabled(!options.profilePath.empty());
+    setLoadMemoryBudget(options.memoryBudgetBytes);
+
+    // Headless benchmark: no window, no prompts
+    if (!options.benchmarkModel.empty()) {
+        return runBenchmark(options);
+    }
+
+    // Offline preprocessing: no window, no prompts
+    if (!options.preprocessPaths.empty()) {
+        return runPreprocess(options);
+    }
+
+    // Loader microbenchmarks on generated files: no window, no prompts
+    if (options.microbenchFaces > 0) {
+        return runMicrobench(options);
+    }
+
+    // Welcome and instructions
+    typewriterEffect("Welcome to Sapphin 3D Renderer.", CYAN, 50);
+    typewriterEffect("The app where you can render your creations and show them to your friends.", CYAN, 50);
+
+    // Optional processing stages, also part of the mesh cache key
+    uint32_t processingFlags = meshProcessingFlags(options);
+
+    // A scene given on the command line replaces the single model
+    Scene scene;
+    if (!options.scenePath.empty()) {
+        typewriterEffect("Loading scene from " + options.scenePath + "...", BLUE, 30);
+        if (!loadScene(options.scenePath, scene, processingFlags) || scene.instances.empty()) {
+            std::cerr << "Failed to load the scene!" << std::endl;
+            return -1;
+        }
+    }
+
+    std::string filename;
+    if (options.scenePath.empty()) {
+        filename = promptModelFilename();
+    }
+
+    // Load model as an indexed mesh. A single model loads in the background once the window is up.
+    Mesh mesh;
+    bool backgroundLoad = false;
+    if (!options.scenePath.empty()) {
+        // Meshes are in the scene
+    }
+    else if (fileExists(filename) && options.instanceCount <= 1) {
+        typewriterEffect("Loading model from " + filename + " in the background...", BLUE, 30);
+        backgroundLoad = true;
+    }
+    else if (fileExists(filename)) {
+        typewriterEffect("Loading model from " + filename + "...", BLUE, 30);
+        mesh = loadMeshCached(filename, processingFlags);
+    }
+    else if (filename == "triangle.obj") {
+        typewriterEffect("Loading default triangle...", RED, 30);
+        mesh = defaultTriangleMesh();
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_BACK);
 
-        // Validate filename input
-        while (filename == ".obj") {
-            typewriterEffect("Please input a filename to simulate a .obj file.", BLUE, 30);
-            typewriterEffect("Enter the name of the file to load it (without the .obj extension):", GREEN, 30);
-            filename.clear();
-            std::getline(std::cin, filename);
-            if (filename.substr(filename.length() - 4) != ".obj") {
-                typewriterEffect("Please pick a valid file format (.obj).", RED, 50);
+        glDisable(GL_CULL_FACE);
+
+    }
+    else {
+        typewriterEffect("File not found. Falling back to default triangle.\n(Make sure your input doesn't have any spaces if your file doesn't have any either.)", RED, 30);
+        mesh = defaultTriangleMesh();
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_BACK);
+
+        glDisable(GL_CULL_FACE);
+
+    }
+
+    // Several copies of a single model become a scene of that one mesh
+    if (options.scenePath.empty() && options.instanceCount > 1) {
+        scene.meshes.push_back(mesh);
+        scene.meshNames.push_back(filename);
+        addGridInstances(scene, 0, options.instanceCount);
+    }
+    const bool sceneMode = !scene.instances.empty();
+
+    // Clicks are answered from a triangle BVH of the model; background loads build theirs on the worker
+    PickBvh picker;
+    if (!sceneMode && !backgroundLoad) {
+        picker.build(mesh);
+    }
+    glm::vec3 measureStart(0.0f);
+    bool measureStarted = false;
+
+    // Occlusion culling: the scene's occluder instances and any extra occluder geometry are rasterized every frame
+    OcclusionCuller occlusion;
+    Mesh occluderMesh;
+    if (options.occlusion) {
+        occlusion.create(options.threadCount);
+        if (!options.occluderPath.empty()) {
+            occluderMesh = loadMeshCached(options.occluderPath, MESH_LODS);
+            if (occluderMesh.indices.empty()) {
+                std::cerr << "Could not load the occluders " << options.occluderPath << std::endl;
             }
-            filename += ".obj";
         }
+        if (!sceneMode && occluderMesh.indices.empty()) {
+            std::cout << "Occlusion culling of a single model needs --occluders <file.obj>; nothing will be hidden." << std::endl;
+        }
+    }
+
+    // Initialize GLFW and create window
+    GLFWwindow* window = initOpenGL();
+    glfwWindowHint(GLFW_SAMPLES, 4);  // 4x MSAA
+    glEnable(GL_MULTISAMPLE);
+
+    if (!window) {
+        std::cerr << "Failed to initialize OpenGL!" << std::endl;
+        return -1;
+    }
+
+    // Add this check
+    std::cout << "OpenGL Context Created Successfully" << std::endl;
+    std::cout << "OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
 
-        // Load model vertices
-        std::vector<Vertex> vertices;
-        if (fileExists(filename)) {
-            typewriterEffect("Loading model from " + filename + "...", BLUE, 30);
-            vertices = loadModel(filename);
+    // Store the camera in the window user pointer (for callbacks)
+    Camera camera(glm::vec3(0.0f, 0.0f, 3.0f)); // new Camera()
+    glfwSetWindowUserPointer(window, &camera);
+
+    // Prepare shaders
+    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    std::string vertexShaderSource;
+    if (sceneMode) {
+        vertexShaderSource = options.packedVertices ? getPackedInstancedVertexShader() : getInstancedVertexShader();
+    }
+    else {
+        vertexShaderSource = options.packedVertices ? getPackedVertexShader() : getDefaultVertexShader();
+    }
+    std::string fragmentShaderSource = getDefaultFragmentShader();
+    const char* vShaderCode = vertexShaderSource.c_str();
+    const char* fShaderCode = fragmentShaderSource.c_str();
+    glShaderSource(vertexShader, 1, &vShaderCode, nullptr);
+    glShaderSource(fragmentShader, 1, &fShaderCode, nullptr);
+
+    // Debug print shader sources
+    std::cout << "Vertex Shader Source:\n" << vertexShaderSource << std::endl;
+    std::cout << "Fragment Shader Source:\n" << fragmentShaderSource << std::endl;
+
+    // Create shader program with the prepared sources
+    GLuint shaderProgram = createShaderProgram(vertexShaderSource, fragmentShaderSource);
+
+    // Add error checking
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR) {
+        std::cerr << "OpenGL error after shader program creation: " << err << std::endl;
+    }
+
+    // Add debug check for color attribute
+    GLint colorAttribLocation = glGetAttribLocation(shaderProgram, "aColor");
+    std::cout << "Color attribute location: " << colorAttribLocation << std::endl;
+
+    // Upload the mesh into a VAO with vertex and index buffers (or every scene mesh plus an instance buffer)
+    GpuMesh gpuMesh;
+    GpuScene gpuScene;
+    if (sceneMode) {
+        gpuScene = uploadScene(scene, options.packedVertices);
+    }
+    else if (!backgroundLoad) {
+        gpuMesh = options.packedVertices ? uploadPackedMesh(mesh) : uploadMesh(mesh);
+    }
+
+    // The worker parses while the window already shows frames; the model appears as it is uploaded
+    AsyncMeshLoader loader;
+    std::string windowTitle = "Sapphin 3D Renderer";
+    if (backgroundLoad) {
+        loader.start(filename, processingFlags, options.packedVertices);
+    }
+
+    // Set up callbacks
+    glfwSetScrollCallback(window, scroll_callback);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetWindowRefreshCallback(window, window_refresh_callback);
+    glfwSetDropCallback(window, drop_callback);
+
+    // Model names asked for with N are read from the console without stopping the render loop
+    ConsoleLineReader console;
+    bool awaitingFilename = false;
+
+    // Frame pacing: the swap interval, an optional cap, and with --on-demand no frames at all while nothing changes.
+    // Without --vsync the swap interval is left to the driver (and the user's settings for it).
+    if (options.vsync) {
+        glfwSwapInterval(1);
+    }
+    FramePacer pacer;
+    pacer.setRate(options.fpsCap);
+    if (options.onDemand || pacer.active()) {
+        std::cout << "Frames: " << (options.onDemand ? "on demand" : "continuous")
+            << (pacer.active() ? ", at most " + std::to_string(options.fpsCap) + " per second" : "")
+            << (options.vsync ? ", vsync" : "") << std::endl;
+    }
+
+    // Print control instructions
+    typewriterEffect("Controls:\n"
+        "W/A/S/D: Move camera\n"
+        "Mouse: Look around\n"
+        "Scroll/Arrow keys: Zoom\n"
+        "Left Shift: Speed up\n"
+        "ESC: Exit\n"
+        "N: Load another model (or drop an .obj file on the window)\n"
+        "Left click: Select the triangle under the cursor\n"
+        "Right click: Measure between two points\n", CYAN, 30);
+
+    // Timing variables
+    float lastFrame = 0.0f;
+
+    // Index ranges that survive culling, rebuilt every frame
+    std::vector<IndexRange> visibleRanges;
+    float lastStatsReport = 0.0f;
+    size_t lodLevel = 0;
+    std::vector<CameraKeyframe> recordedPath;
+
+    // Set while all of the model is in gpuMesh; a model that is being replaced can't be drawn
+    bool meshReady = !backgroundLoad;
+
+    // What the last frame showed, for --on-demand
+    bool redraw = true;
+    CameraKeyframe drawnPose = cameraKeyframe(camera);
+    int drawnWidth = 0, drawnHeight = 0;
+    size_t drawnFrames = 0;
+    size_t idleWaits = 0;
+
+    // Render loop
+    while (!glfwWindowShouldClose(window)) {
+        // Calculate delta time
+        float currentFrame = glfwGetTime();
+        float deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+
+        profiler().beginFrame();
+        ProfileZone frameZone("Frame");
+
+        // Process input
+        {
+            ProfileZone inputZone("Input");
+            processInput(window, camera, deltaTime);
         }
-        else if (filename == "triangle.obj") {
-            typewriterEffect("Loading default triangle...", RED, 30);
-            // Default triangle vertices
-            vertices = {
-                Vertex{-0.5f, -0.5f, 0.0f,  0.0f, 0.0f, 1.0f,  0.0f, 0.0f},
-                Vertex{ 0.5f, -0.5f, 0.0f,  0.0f, 0.0f, 1.0f,  1.0f, 0.0f},
-                Vertex{ 0.0f,  0.5f, 0.0f,  0.0f, 0.0f, 1.0f,  0.5f, 1.0f}
-            };
-            glEnable(GL_CULL_FACE);
-            glCullFace(GL_BACK);
-
-            glDisable(GL_CULL_FACE);
 
+        // Another model: N asks for a name on the console (read on its own thread, so frames go on meanwhile),
+        // or a file is dropped on the window
+        if (takeModelSwitchRequest()) {
+            if (sceneMode) {
+                std::cout << "Scenes can't switch models; start again with another --scene." << std::endl;
+            }
+            else {
+                std::cout << "Type the name of the model to load (without the .obj extension, 'triangle' for the default "
+                    "triangle) and press Enter, or drop an .obj file on the window." << std::endl;
+                console.start();
+                std::string typedEarlier;
+                while (console.takeLine(typedEarlier)) {
+                    // Lines typed while nobody asked aren't answers to this prompt
+                }
+                awaitingFilename = true;
+            }
+        }
+        std::string nextModel;
+        bool switchModel = false;
+        if (takeDroppedFile(nextModel)) {
+            switchModel = !sceneMode;
+            if (sceneMode) {
+                std::cout << "Scenes can't switch models; start again with another --scene." << std::endl;
+            }
+        }
+        else if (awaitingFilename && console.takeLine(nextModel)) {
+            if (nextModel.empty()) {
+                std::cout << "Please type a file name, or 'triangle'." << std::endl;
+            }
+            else {
+                if (nextModel.size() < 4 || nextModel.substr(nextModel.size() - 4) != ".obj") {
+                    nextModel += ".obj";
+                }
+                switchModel = true;
+            }
         }
-        else {
-            typewriterEffect("File not found. Falling back to default triangle.\n(Make sure your input doesn't have any spaces if your file doesn't have any either.)", RED, 30);
-            vertices = {
-                Vertex{-0.5f, -0.5f, 0.0f,  0.0f, 0.0f, 1.0f,  0.0f, 0.0f},
-                Vertex{ 0.5f, -0.5f, 0.0f,  0.0f, 0.0f, 1.0f,  1.0f, 0.0f},
-                Vertex{ 0.0f,  0.5f, 0.0f,  0.0f, 0.0f, 1.0f,  0.5f, 1.0f}
-            };
-            glEnable(GL_CULL_FACE);
-            glCullFace(GL_BACK);
-
-            glDisable(GL_CULL_FACE);
 
+        // The window, context and programs stay, only the contents of the buffers change
+        if (switchModel) {
+            awaitingFilename = false;
+            filename = nextModel;
+            if (fileExists(filename)) {
+                std::cout << "Loading model from " << filename << " in the background..." << std::endl;
+                loader.start(filename, processingFlags, options.packedVertices);
+                backgroundLoad = true;
+                picker.clear();
+            }
+            else {
+                std::cout << (filename == "triangle.obj" ? "Loading default triangle..." : "File not found: " + filename + ". Falling back to default triangle.") << std::endl;
+                loader.cancel();
+                if (windowTitle != "Sapphin 3D Renderer") {
+                    windowTitle = "Sapphin 3D Renderer";
+                    glfwSetWindowTitle(window, windowTitle.c_str());
+                }
+                backgroundLoad = false;
+                mesh = defaultTriangleMesh();
+                MeshUpload upload = prepareMeshUpload(mesh, options.packedVertices);
+                beginMeshUpload(upload, gpuMesh);
+                continueMeshUpload(upload, mesh, gpuMesh, upload.vertexBytes + upload.indexBytes);
+                meshReady = true;
+                picker.build(mesh);
+            }
+            lodLevel = 0;
+            measureStarted = false;
+            redraw = true;
         }
 
-        // Initialize GLFW and create window
-        GLFWwindow* window = initOpenGL();
-        glfwWindowHint(GLFW_SAMPLES, 4);  // 4x MSAA
-        glEnable(GL_MULTISAMPLE);
+        // Background loading: take the model when the worker is done and upload the next slice of it
+        if (backgroundLoad) {
+            redraw = true;
+            backgroundLoad = !loader.update(mesh, gpuMesh);
+            if (loader.isUploading()) {
+                meshReady = false;
+            }
+            else if (loader.failed() && gpuMesh.VAO != 0) {
+                // Nothing was replaced yet
+                std::cerr << "Keeping the current model." << std::endl;
+            }
+            else if (loader.failed()) {
+                std::cerr << "Falling back to default triangle." << std::endl;
+                mesh = defaultTriangleMesh();
+                gpuMesh = options.packedVertices ? uploadPackedMesh(mesh) : uploadMesh(mesh);
+                meshReady = true;
+                picker.build(mesh);
+            }
+            else if (!backgroundLoad) {
+                meshReady = true;
+            }
+            loader.takePickBvh(picker);
+            std::string title = backgroundLoad ? "Sapphin 3D Renderer - " + loader.status() : "Sapphin 3D Renderer";
+            if (title != windowTitle) {
+                glfwSetWindowTitle(window, title.c_str());
+                windowTitle = title;
+            }
+        }
 
-        if (!window) {
-            std::cerr << "Failed to initialize OpenGL!" << std::endl;
-            return -1;
+        // Clicks: a ray from the camera through the cursor, against the model (its model matrix is the identity)
+        PickRequest pickRequest = takePickRequest();
+        if (pickRequest != PICK_NONE && (sceneMode || !meshReady || picker.empty())) {
+            std::cout << (sceneMode ? "Picking works on single models, not scenes." : "Nothing to pick until the model has loaded.") << std::endl;
         }
+        else if (pickRequest != PICK_NONE) {
+            double cursorX, cursorY;
+            int windowWidth, windowHeight;
+            glfwGetCursorPos(window, &cursorX, &cursorY);
+            glfwGetWindowSize(window, &windowWidth, &windowHeight);
+            glm::mat4 projection;
+            updateCameraProjection(projection, camera);
+
+            auto pickStart = std::chrono::steady_clock::now();
+            glm::vec3 rayOrigin, rayDirection;
+            RayHit hit;
+            if (cursorRay(camera.getViewMatrix(), projection, cursorX, cursorY, windowWidth, windowHeight, rayOrigin, rayDirection)) {
+                hit = picker.intersect(rayOrigin, rayDirection);
+            }
+            double pickMicroseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - pickStart).count();
+            std::string pickCost = " (" + std::to_string(hit.nodesVisited) + " nodes, " + std::to_string(hit.trianglesTested)
+                + " triangles tested in " + std::to_string(pickMicroseconds) + " us)";
 
-        // Add this check
-        std::cout << "OpenGL Context Created Successfully" << std::endl;
-        std::cout << "OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
-
-        // Store the camera in the window user pointer (for callbacks)
-        Camera camera(glm::vec3(0.0f, 0.0f, 3.0f)); // new Camera()
-        glfwSetWindowUserPointer(window, &camera);
-
-        // Prepare shaders
-        GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-        GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-        std::string vertexShaderSource = getDefaultVertexShader();
-        std::string fragmentShaderSource = getDefaultFragmentShader();
-        const char* vShaderCode = vertexShaderSource.c_str();
-        const char* fShaderCode = fragmentShaderSource.c_str();
-        glShaderSource(vertexShader, 1, &vShaderCode, nullptr);
-        glShaderSource(fragmentShader, 1, &fShaderCode, nullptr);
-
-        // Debug print shader sources
-        std::cout << "Vertex Shader Source:\n" << vertexShaderSource << std::endl;
-        std::cout << "Fragment Shader Source:\n" << fragmentShaderSource << std::endl;
-
-        // Create shader program with the prepared sources
-        GLuint shaderProgram = createShaderProgram(vertexShaderSource, fragmentShaderSource);
-
-        // Add error checking
-        GLenum err = glGetError();
-        if (err != GL_NO_ERROR) {
-            std::cerr << "OpenGL error after shader program creation: " << err << std::endl;
+            if (!hit.hit) {
+                std::cout << "Nothing under the cursor" << pickCost << std::endl;
+            }
+            else if (pickRequest == PICK_SELECT) {
+                std::cout << "Triangle " << hit.triangle << " at (" << hit.position.x << ", " << hit.position.y << ", " << hit.position.z
+                    << "), " << hit.distance << " from the camera" << pickCost << std::endl;
+            }
+            else if (!measureStarted) {
+                measureStart = hit.position;
+                measureStarted = true;
+                std::cout << "Measuring from (" << hit.position.x << ", " << hit.position.y << ", " << hit.position.z
+                    << "); right click the second point" << pickCost << std::endl;
+            }
+            else {
+                measureStarted = false;
+                std::cout << "Distance to (" << hit.position.x << ", " << hit.position.y << ", " << hit.position.z << "): "
+                    << glm::length(hit.position - measureStart) << pickCost << std::endl;
+            }
         }
 
-        // Add debug check for color attribute
-        GLint colorAttribLocation = glGetAttribLocation(shaderProgram, "aColor");
-        std::cout << "Color attribute location: " << colorAttribLocation << std::endl;
-
-        // Create and bind VAO and VBO
-        GLuint VAO, VBO;
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
-
-        // Set up vertex attributes
-        // Position attribute
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, x));
-        glEnableVertexAttribArray(0);
-
-        // Normal attribute (location = 1)
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, nx));
-        glEnableVertexAttribArray(1);
-
-        // Texture coordinate attribute (location = 2)
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, u));
-        glEnableVertexAttribArray(2);
-
-        // Color attribute (location = 3)
-        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, r));
-        glEnableVertexAttribArray(3);
-
-        // Set up callbacks
-        glfwSetScrollCallback(window, scroll_callback);
-        glfwSetCursorPosCallback(window, mouse_callback);
-
-        // Print control instructions
-        typewriterEffect("Controls:\n"
-            "W/A/S/D: Move camera\n"
-            "Mouse: Look around\n"
-            "Scroll/Arrow keys: Zoom\n"
-            "Left Shift: Speed up\n"
-            "ESC: Exit\n"
-            "N: Choose another file\n", CYAN, 30);
-
-        // Timing variables
-        float lastFrame = 0.0f;
-
-        // Render loop
-        while (!glfwWindowShouldClose(window)) {
-            // Calculate delta time
-            float currentFrame = glfwGetTime();
-            float deltaTime = currentFrame - lastFrame;
-            lastFrame = currentFrame;
-
-            // Process input
-            processInput(window, camera, deltaTime);
+        // On demand: the frame is only drawn when the camera, the window or the model changed. Otherwise sleep
+        // until an event (or the timeout) and look again; time spent waiting is not a frame.
+        if (options.onDemand) {
+            int framebufferWidth, framebufferHeight;
+            glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+            CameraKeyframe pose = cameraKeyframe(camera);
+            redraw = redraw || takeRedrawRequest() || cameraKeysHeld(window) || !samePose(pose, drawnPose)
+                || framebufferWidth != drawnWidth || framebufferHeight != drawnHeight;
+            if (!redraw) {
+                ProfileZone idleZone("Idle");
+                glfwWaitEventsTimeout(ON_DEMAND_WAIT_SECONDS);
+                idleWaits++;
+                pacer.reset();
+                lastFrame = static_cast<float>(glfwGetTime());
+                continue;
+            }
+            redraw = false;
+            drawnPose = pose;
+            drawnWidth = framebufferWidth;
+            drawnHeight = framebufferHeight;
+        }
+        drawnFrames++;
+
+        // One keyframe per drawn frame, so on-demand idle waits don't stretch the recorded path
+        if (!options.recordPathFile.empty()) {
+            recordedPath.push_back(cameraKeyframe(camera));
+        }
+
+        // Statistics are printed about once per second
+        bool reportStats = currentFrame - lastStatsReport >= 1.0f;
+        if (reportStats) {
+            if (options.onDemand || pacer.active()) {
+                FramePacingStats pacingStats = pacer.takeStats();
+                std::cout << "Frames: " << drawnFrames << " drawn in " << currentFrame - lastStatsReport << " s";
+                if (options.onDemand) {
+                    std::cout << ", " << idleWaits << " idle waits";
+                }
+                if (pacer.active()) {
+                    std::cout << ", " << pacingStats.lateFrames << " late, " << pacingStats.sleepMilliseconds << " ms asleep, "
+                        << pacingStats.spinMilliseconds << " ms yielding, deadlines missed by " << pacingStats.maxErrorMilliseconds
+                        << " ms at most";
+                }
+                std::cout << std::endl;
+            }
+            drawnFrames = 0;
+            idleWaits = 0;
+            lastStatsReport = currentFrame;
+            GlCallStats callStats = glState().stats();
+            std::cout << "GL calls: " << callStats.issued << " issued, " << callStats.elided << " elided" << std::endl;
+            glState().resetStats();
+            if (sceneMode) {
+                StreamStats streamStats = gpuScene.instanceRing.takeStats();
+                size_t frames = std::max<size_t>(streamStats.frames, 1);
+                std::cout << "Streaming (" << (gpuScene.instanceRing.isPersistent() ? "persistent" : "orphaned") << "): "
+                    << streamStats.bytesUploaded / frames / 1024 << " KB and " << streamStats.waitMilliseconds / frames
+                    << " ms waiting per frame, " << streamStats.stalls << " stalls" << std::endl;
+            }
+            if (options.occlusion) {
+                OcclusionStats occlusionStats = occlusion.takeStats();
+                double frames = static_cast<double>(std::max<size_t>(occlusionStats.frames, 1));
+                std::cout << "Occlusion: " << occlusionStats.occludedBoxes / frames << " of " << occlusionStats.testedBoxes / frames
+                    << " boxes hidden and " << occlusionStats.occludedTriangles / frames << " triangles saved per frame, "
+                    << occlusionStats.rasterMilliseconds / frames << " ms rasterizing " << occlusionStats.occluderTriangles / frames
+                    << " occluder triangles and " << occlusionStats.testMilliseconds / frames << " ms testing per frame" << std::endl;
+                if (occlusionStats.simplifiedOccluders > 0 || occlusionStats.skippedOccluders > 0) {
+                    std::cout << "Occlusion: " << occlusionStats.simplifiedOccluders / frames << " occluders simplified and "
+                        << occlusionStats.skippedOccluders / frames << " skipped per frame to stay within "
+                        << OCCLUSION_MAX_OCCLUDER_TRIANGLES << " triangles" << std::endl;
+                }
+            }
+        }
+
+        // Everything between here and the swap is GPU work of this frame
+        {
+            ProfileZone drawZone("Draw");
+            GpuProfileZone gpuDrawZone("Draw");
 
             // Clear screen
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -195,66 +554,122 @@ int main() {
             glm::mat4 projection;
             updateCameraProjection(projection, camera);
 
-            // Use shader program
-            glUseProgram(shaderProgram);
+            // Use shader program (the state cache skips everything that is already set)
+            GlStateCache& state = glState();
+            state.useProgram(shaderProgram);
 
             // Ensure we're rendering filled triangles, not wireframe
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+            state.polygonMode(GL_FILL);
 
             // Model matrix (identity for now)
             glm::mat4 model = glm::mat4(1.0f);
 
-            // Get uniform locations
-            GLint modelLoc = glGetUniformLocation(shaderProgram, "model");
-            GLint viewLoc = glGetUniformLocation(shaderProgram, "view");
-            GLint projLoc = glGetUniformLocation(shaderProgram, "projection");
-
-            // Set uniforms
-            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-            glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-            glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
+            // Camera matrices go to the shared uniform block, the rest to uniforms looked up once per program
+            const ProgramUniforms& uniforms = state.uniforms(shaderProgram);
+            state.updateCameraBlock(view, projection);
+            state.uniformMatrix4(uniforms.model, model);
 
-            // Draw the model
-            glBindVertexArray(VAO);
-            glDrawArrays(GL_TRIANGLES, 0, vertices.size());
+            // Dequantization of packed positions
+            if (gpuMesh.packed) {
+                state.uniform3(uniforms.positionScale, gpuMesh.positionScale);
+                state.uniform3(uniforms.positionOffset, gpuMesh.positionOffset);
+            }
 
-            // Swap buffers and poll events
-            glfwSwapBuffers(window);
-            glfwPollEvents();
-        }
+            int framebufferWidth, framebufferHeight;
+            glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
 
-        // Cleanup
-        glDeleteVertexArrays(1, &VAO);
-        glDeleteBuffers(1, &VBO);
-        glDeleteProgram(shaderProgram);
+            // Occluder depth of this view, which instances and chunks are then tested against
+            OcclusionCuller* frameOcclusion = nullptr;
+            if (options.occlusion) {
+                ProfileZone occlusionZone("Occlusion");
+                prepareOcclusion(occlusion, scene, occluderMesh, view, projection, framebufferWidth, framebufferHeight);
+                frameOcclusion = &occlusion;
+            }
 
-        // Check if restart was requested
-        void* userPtr = glfwGetWindowUserPointer(window);
-        if (userPtr == reinterpret_cast<void*>(1)) {
-            continueRendering = true;
-        }
-        else {
-            // Just in case we need to check for keyboard input one last time
-            if (glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS) {
-                continueRendering = true;
+            // Scenes: instances are culled, bucketed by mesh and level of detail, and drawn instanced
+            if (sceneMode) {
+                SceneDrawStats sceneStats = drawScene(gpuScene, scene, extractFrustum(projection * view), camera.position,
+                    camera.zoom, framebufferHeight, shaderProgram, frameOcclusion);
+                if (reportStats) {
+                    std::cout << "Scene: " << sceneStats.visibleInstances << " instances drawn, " << sceneStats.culledInstances
+                        << " culled, " << sceneStats.occludedInstances << " occluded, " << sceneStats.drawCalls << " draw calls, " << sceneStats.triangles << " triangles" << std::endl;
+                }
+            }
+            else if (backgroundLoad && loader.isUploading()) {
+                // Whatever part of the full-detail triangles has been uploaded so far
+                size_t fullIndices = mesh.lods.empty() ? mesh.indices.size() : mesh.lods[0].indexCount;
+                size_t drawable = std::min(loader.drawableIndices(), fullIndices);
+                if (drawable > 0) {
+                    visibleRanges.assign(1, IndexRange{ 0, static_cast<uint32_t>(drawable) });
+                    drawMeshRanges(gpuMesh, visibleRanges);
+                }
+            }
+            else if (meshReady) {
+                // Draw the level of detail the model needs, or what survives culling
+                glm::vec3 cameraInModel = glm::vec3(glm::inverse(model) * glm::vec4(camera.position, 1.0f));
+                MeshDrawStats drawStats = drawMeshView(mesh, gpuMesh, projection * view * model, cameraInModel, camera.zoom,
+                    framebufferHeight, visibleRanges, frameOcclusion);
+                if (drawStats.lodLevel != lodLevel) {
+                    lodLevel = drawStats.lodLevel;
+                    std::cout << "LOD " << lodLevel << " (" << mesh.lods[lodLevel].indexCount / 3 << " triangles"
+                        << (lodLevel > 0 && (!mesh.bvh.empty() || !mesh.meshlets.empty()) ? ", culled as a whole instead of by chunks" : "")
+                        << ")" << std::endl;
+                }
+                if (reportStats && drawStats.bvhCulled) {
+                    const BvhCullStats& cullStats = drawStats.bvh;
+                    std::cout << "BVH: " << cullStats.visitedNodes << " nodes visited, " << cullStats.drawnTriangles << " triangles drawn, "
+                        << cullStats.culledTriangles << " culled, " << cullStats.occludedTriangles << " occluded in " << cullStats.cullMilliseconds << " ms (" << visibleRanges.size()
+                        << " ranges)" << std::endl;
+                }
+                if (reportStats && drawStats.meshletsCulled) {
+                    const MeshletCullStats& cullStats = drawStats.meshlets;
+                    std::cout << "Meshlets: " << cullStats.visible << " drawn, " << cullStats.frustumCulled << " outside the view, "
+                        << cullStats.backfaceCulled << " facing away (" << visibleRanges.size() << " ranges)" << std::endl;
+                }
             }
         }
-        
-        // Delete new Camera()
-        Camera* cam = static_cast<Camera*>(glfwGetWindowUserPointer(window));
-        delete cam;
-
-        // Clean up GLFW
-        glfwTerminate();
 
-        if (continueRendering) {
-            typewriterEffect("Restarting application...", GREEN, 30);
+        // Swap buffers, wait for the next frame under --fps-cap and poll events
+        {
+            ProfileZone swapZone("Swap");
+            glfwSwapBuffers(window);
         }
-        else {
-            typewriterEffect("Exiting application...", GREEN, 30);
-            std::this_thread::sleep_for(std::chrono::seconds(2));
+        if (pacer.active()) {
+            ProfileZone pacingZone("Pacing");
+            pacer.wait();
         }
+        {
+            ProfileZone eventsZone("Events");
+            glfwPollEvents();
+        }
+    }
+
+    if (!options.recordPathFile.empty() && saveCameraPath(options.recordPathFile, recordedPath)) {
+        std::cout << "Camera path (" << recordedPath.size() << " frames) saved to " << options.recordPathFile << std::endl;
     }
 
+    // Queries belong to this context
+    profiler().releaseGpu();
+    if (!options.profilePath.empty()) {
+        profiler().writeChromeTrace(options.profilePath);
+    }
+
+    // Cleanup
+    if (sceneMode) {
+        destroyScene(gpuScene);
+    }
+    else {
+        destroyMesh(gpuMesh);
+    }
+    glState().forgetProgram(shaderProgram);
+    glDeleteProgram(shaderProgram);
+
+    // Clean up GLFW; the state cache would otherwise describe a context that no longer exists
+    glfwTerminate();
+    glState().reset();
+
+    typewriterEffect("Exiting application...", GREEN, 30);
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+
     return 0;
 }
@@ -0,0 +1,163 @@
+// _sapphin_glstate.cpp
+// This keeps a copy of the GL state so calls that would not change anything never reach the driver.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+
+#include <map>
+#include <cstring>
+#include <iterator>
+
+// Headers
+#include "headers/_sapphin_glstate.h"
+#include "lib/GLEW.win32/GLEW-lib/include/GL/glew.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+#include "lib/GLM.win32/GLM-lib/glm/gtc/type_ptr.hpp"
+
+GlStateCache& glState() {
+    static GlStateCache cache;
+    return cache;
+}
+
+void GlStateCache::useProgram(GLuint program) {
+    if (program == currentProgram) {
+        callStats.elided++;
+        return;
+    }
+    glUseProgram(program);
+    currentProgram = program;
+    callStats.issued++;
+}
+
+void GlStateCache::bindVertexArray(GLuint vertexArray) {
+    if (vertexArray == currentVertexArray) {
+        callStats.elided++;
+        return;
+    }
+    glBindVertexArray(vertexArray);
+    currentVertexArray = vertexArray;
+    callStats.issued++;
+}
+
+void GlStateCache::bindBuffer(GLenum target, GLuint buffer) {
+    GLuint* current = nullptr;
+    if (target == GL_ARRAY_BUFFER) current = &currentArrayBuffer;
+    else if (target == GL_UNIFORM_BUFFER) current = &currentUniformBuffer;
+
+    if (current && *current == buffer) {
+        callStats.elided++;
+        return;
+    }
+    glBindBuffer(target, buffer);
+    if (current) *current = buffer;
+    callStats.issued++;
+}
+
+void GlStateCache::polygonMode(GLenum mode) {
+    if (polygonModeKnown && mode == currentPolygonMode) {
+        callStats.elided++;
+        return;
+    }
+    glPolygonMode(GL_FRONT_AND_BACK, mode);
+    currentPolygonMode = mode;
+    polygonModeKnown = true;
+    callStats.issued++;
+}
+
+const ProgramUniforms& GlStateCache::uniforms(GLuint program) {
+    auto found = programUniforms.find(program);
+    if (found != programUniforms.end()) {
+        return found->second;
+    }
+
+    ProgramUniforms locations;
+    locations.model = glGetUniformLocation(program, "model");
+    locations.positionScale = glGetUniformLocation(program, "positionScale");
+    locations.positionOffset = glGetUniformLocation(program, "positionOffset");
+    callStats.issued += 3;
+    return programUniforms[program] = locations;
+}
+
+void GlStateCache::uniformMatrix4(GLint location, const glm::mat4& value) {
+    if (location < 0) {
+        return;
+    }
+    auto key = std::make_pair(currentProgram, location);
+    auto found = matrixValues.find(key);
+    if (found != matrixValues.end() && memcmp(&found->second, &value, sizeof(value)) == 0) {
+        callStats.elided++;
+        return;
+    }
+    glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+    matrixValues[key] = value;
+    callStats.issued++;
+}
+
+void GlStateCache::uniform3(GLint location, const glm::vec3& value) {
+    if (location < 0) {
+        return;
+    }
+    auto key = std::make_pair(currentProgram, location);
+    auto found = vectorValues.find(key);
+    if (found != vectorValues.end() && memcmp(&found->second, &value, sizeof(value)) == 0) {
+        callStats.elided++;
+        return;
+    }
+    glUniform3fv(location, 1, glm::value_ptr(value));
+    vectorValues[key] = value;
+    callStats.issued++;
+}
+
+void GlStateCache::updateCameraBlock(const glm::mat4& view, const glm::mat4& projection) {
+    if (cameraBuffer == 0) {
+        glGenBuffers(1, &cameraBuffer);
+        bindBuffer(GL_UNIFORM_BUFFER, cameraBuffer);
+        glBufferData(GL_UNIFORM_BUFFER, 2 * sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, cameraBuffer);
+        callStats.issued += 3;
+    }
+    if (cameraValid && memcmp(&view, &cameraView, sizeof(view)) == 0 && memcmp(&projection, &cameraProjection, sizeof(projection)) == 0) {
+        callStats.elided++;
+        return;
+    }
+
+    // std140 lays out two mat4 back to back, exactly like glm
+    glm::mat4 block[2] = { view, projection };
+    bindBuffer(GL_UNIFORM_BUFFER, cameraBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), block);
+    callStats.issued++;
+    cameraView = view;
+    cameraProjection = projection;
+    cameraValid = true;
+}
+
+void GlStateCache::forgetVertexArray(GLuint vertexArray) {
+    // Deleting the bound vertex array binds 0
+    if (vertexArray == currentVertexArray) currentVertexArray = 0;
+}
+
+void GlStateCache::forgetBuffer(GLuint buffer) {
+    if (buffer == currentArrayBuffer) currentArrayBuffer = 0;
+    if (buffer == currentUniformBuffer) currentUniformBuffer = 0;
+}
+
+void GlStateCache::forgetProgram(GLuint program) {
+    programUniforms.erase(program);
+    for (auto it = matrixValues.begin(); it != matrixValues.end();) {
+        it = (it->first.first == program) ? matrixValues.erase(it) : std::next(it);
+    }
+    for (auto it = vectorValues.begin(); it != vectorValues.end();) {
+        it = (it->first.first == program) ? vectorValues.erase(it) : std::next(it);
+    }
+    // A deleted program stays in use until another one is, but its name may come back for a new program
+    if (program == currentProgram) {
+        glUseProgram(0);
+        currentProgram = 0;
+    }
+}
+
+void GlStateCache::reset() {
+    GlCallStats stats = callStats;
+    *this = GlStateCache();
+    callStats = stats;
+}
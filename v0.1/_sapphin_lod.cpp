@@ -0,0 +1,343 @@
+// _sapphin_lod.cpp
+// This generates simplified levels of detail with quadric error edge collapses and picks one per frame.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <tuple>
+#include <algorithm>
+
+// Headers
+#include "headers/_sapphin_lod.h"
+#include "headers/_sapphin_types.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+
+// Sum of squared distances to a set of planes (Garland and Heckbert), as the upper triangle of a 4x4 matrix
+struct Quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0;
+    double b2 = 0, bc = 0, bd = 0;
+    double c2 = 0, cd = 0;
+    double d2 = 0;
+
+    void addPlane(double a, double b, double c, double d) {
+        a2 += a * a; ab += a * b; ac += a * c; ad += a * d;
+        b2 += b * b; bc += b * c; bd += b * d;
+        c2 += c * c; cd += c * d;
+        d2 += d * d;
+    }
+
+    void add(const Quadric& other) {
+        a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+        b2 += other.b2; bc += other.bc; bd += other.bd;
+        c2 += other.c2; cd += other.cd;
+        d2 += other.d2;
+    }
+
+    double evaluate(const glm::vec3& p) const {
+        double x = p.x, y = p.y, z = p.z;
+        double result = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+            + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+            + c2 * z * z + 2 * cd * z + d2;
+        return result > 0.0 ? result : 0.0;
+    }
+};
+
+// Candidate half-edge collapse: vertex 'from' moves onto vertex 'to'
+struct Collapse {
+    double cost;
+    uint32_t from;
+    uint32_t to;
+};
+
+static inline glm::vec3 vertexPosition(const Mesh& mesh, uint32_t index) {
+    const Vertex& vertex = mesh.vertices[index];
+    return glm::vec3(vertex.x, vertex.y, vertex.z);
+}
+
+// Vertices sharing a position get the same id (the smallest vertex index among them)
+static std::vector<uint32_t> buildPositionIds(const Mesh& mesh, std::vector<uint32_t>& groupSize) {
+    size_t vertexCount = mesh.vertices.size();
+    std::vector<uint32_t> order(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        order[v] = static_cast<uint32_t>(v);
+    }
+    auto key = [&](uint32_t v) {
+        const Vertex& vertex = mesh.vertices[v];
+        uint32_t bits[3];
+        memcpy(&bits[0], &vertex.x, 4);
+        memcpy(&bits[1], &vertex.y, 4);
+        memcpy(&bits[2], &vertex.z, 4);
+        return std::make_tuple(bits[0], bits[1], bits[2]);
+    };
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        auto keyA = key(a), keyB = key(b);
+        return keyA != keyB ? keyA < keyB : a < b;
+    });
+
+    std::vector<uint32_t> positionId(vertexCount);
+    groupSize.assign(vertexCount, 0);
+    for (size_t i = 0; i < vertexCount;) {
+        size_t end = i + 1;
+        while (end < vertexCount && key(order[end]) == key(order[i])) end++;
+        for (size_t k = i; k < end; k++) {
+            positionId[order[k]] = order[i];
+        }
+        groupSize[order[i]] = static_cast<uint32_t>(end - i);
+        i = end;
+    }
+    return positionId;
+}
+
+std::vector<uint32_t> simplifyMesh(const Mesh& mesh, const std::vector<uint32_t>& indices, size_t targetIndexCount,
+    float maxError, float& error) {
+    error = 0.0f;
+    std::vector<uint32_t> result(indices);
+    size_t vertexCount = mesh.vertices.size();
+    if (result.size() <= targetIndexCount || vertexCount == 0) {
+        return result;
+    }
+
+    std::vector<uint32_t> groupSize;
+    std::vector<uint32_t> positionId = buildPositionIds(mesh, groupSize);
+
+    // Vertices on texture seams, open borders or non-manifold edges stay where they are
+    std::vector<bool> locked(vertexCount, false);
+    for (size_t v = 0; v < vertexCount; v++) {
+        if (groupSize[positionId[v]] > 1) locked[v] = true;
+    }
+    {
+        std::vector<uint64_t> edges;
+        edges.reserve(result.size());
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int corner = 0; corner < 3; corner++) {
+                uint64_t a = positionId[result[i + corner]];
+                uint64_t b = positionId[result[i + (corner + 1) % 3]];
+                edges.push_back(a < b ? (a << 32) | b : (b << 32) | a);
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        for (size_t i = 0; i < edges.size();) {
+            size_t end = i + 1;
+            while (end < edges.size() && edges[end] == edges[i]) end++;
+            if (end - i != 2) {
+                locked[static_cast<uint32_t>(edges[i] >> 32)] = true;
+                locked[static_cast<uint32_t>(edges[i] & 0xFFFFFFFFu)] = true;
+            }
+            i = end;
+        }
+        for (size_t v = 0; v < vertexCount; v++) {
+            if (locked[positionId[v]]) locked[v] = true;
+        }
+    }
+
+    // Plane quadrics of the faces around every position
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < result.size(); i += 3) {
+        glm::vec3 p0 = vertexPosition(mesh, result[i]);
+        glm::vec3 normal = glm::cross(vertexPosition(mesh, result[i + 1]) - p0, vertexPosition(mesh, result[i + 2]) - p0);
+        float length = glm::length(normal);
+        if (length <= 0.0f) continue;
+        normal /= length;
+        Quadric plane;
+        plane.addPlane(normal.x, normal.y, normal.z, -glm::dot(normal, p0));
+        for (int corner = 0; corner < 3; corner++) {
+            quadrics[positionId[result[i + corner]]].add(plane);
+        }
+    }
+
+    const double maxCost = static_cast<double>(maxError) * maxError;
+    double appliedCost = 0.0;
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<bool> dirty(vertexCount);
+    std::vector<uint32_t> rowStart(vertexCount + 1);
+    std::vector<uint32_t> adjacent;
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> neighbours, toNeighbours;
+
+    // Distinct positions sharing a triangle with a position
+    auto collectNeighbours = [&](uint32_t id, std::vector<uint32_t>& out) {
+        out.clear();
+        for (uint32_t k = rowStart[id]; k < rowStart[id + 1]; k++) {
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t other = positionId[result[adjacent[k] * 3 + corner]];
+                if (other != id) out.push_back(other);
+            }
+        }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    };
+
+    // Collapse in passes; every pass only touches vertices whose neighbourhood no earlier collapse in it changed
+    while (result.size() > targetIndexCount) {
+        size_t triangleCount = result.size() / 3;
+
+        // Triangles around every position
+        std::fill(rowStart.begin(), rowStart.end(), 0);
+        for (uint32_t index : result) {
+            rowStart[positionId[index] + 1]++;
+        }
+        for (size_t v = 0; v < vertexCount; v++) {
+            rowStart[v + 1] += rowStart[v];
+        }
+        adjacent.resize(result.size());
+        {
+            std::vector<uint32_t> cursor(rowStart.begin(), rowStart.end() - 1);
+            for (size_t i = 0; i < result.size(); i++) {
+                adjacent[cursor[positionId[result[i]]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t from = result[i + corner];
+                uint32_t to = result[i + (corner + 1) % 3];
+                if (locked[from]) continue;
+                Quadric combined = quadrics[from];
+                combined.add(quadrics[positionId[to]]);
+                collapses.push_back({ combined.evaluate(vertexPosition(mesh, to)), from, to });
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+            return a.cost < b.cost;
+        });
+
+        for (size_t v = 0; v < vertexCount; v++) {
+            remap[v] = static_cast<uint32_t>(v);
+        }
+        std::fill(dirty.begin(), dirty.end(), false);
+
+        // Every interior collapse removes two triangles
+        size_t wanted = (triangleCount - targetIndexCount / 3 + 1) / 2;
+        size_t applied = 0;
+        for (const Collapse& collapse : collapses) {
+            if (applied >= wanted || collapse.cost > maxCost) break;
+            uint32_t from = collapse.from;
+            uint32_t to = collapse.to;
+            uint32_t toId = positionId[to];
+            if (dirty[from] || dirty[toId]) continue;
+
+            // Topology: the edge must have exactly the two opposite vertices as common neighbours,
+            // otherwise the collapse would pinch the surface
+            collectNeighbours(from, neighbours);
+            collectNeighbours(toId, toNeighbours);
+            size_t common = 0;
+            for (uint32_t id : toNeighbours) {
+                if (id != from && std::binary_search(neighbours.begin(), neighbours.end(), id)) common++;
+            }
+            if (common != 2) continue;
+
+            // Geometry: no remaining triangle around 'from' may flip over
+            glm::vec3 target = vertexPosition(mesh, to);
+            bool flips = false;
+            for (uint32_t k = rowStart[from]; k < rowStart[from + 1] && !flips; k++) {
+                const uint32_t* triangle = &result[adjacent[k] * 3];
+                glm::vec3 p[3], moved[3];
+                bool containsTo = false;
+                for (int corner = 0; corner < 3; corner++) {
+                    p[corner] = vertexPosition(mesh, triangle[corner]);
+                    moved[corner] = (triangle[corner] == from) ? target : p[corner];
+                    if (positionId[triangle[corner]] == toId) containsTo = true;
+                }
+                if (containsTo) continue;  // Becomes degenerate and is removed
+                glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                // Reject flips and also large turns, which fold the surface over a few passes
+                if (glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after)) flips = true;
+            }
+            if (flips) continue;
+
+            remap[from] = to;
+            quadrics[toId].add(quadrics[from]);
+            appliedCost = std::max(appliedCost, collapse.cost);
+            applied++;
+            dirty[from] = true;
+            dirty[toId] = true;
+            for (uint32_t k = rowStart[from]; k < rowStart[from + 1]; k++) {
+                for (int corner = 0; corner < 3; corner++) {
+                    dirty[positionId[result[adjacent[k] * 3 + corner]]] = true;
+                }
+            }
+        }
+        if (applied == 0) {
+            break;  // Nothing left to collapse within maxError
+        }
+
+        // Move collapsed corners and drop the triangles that became degenerate
+        size_t written = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            uint32_t a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+            if (positionId[a] == positionId[b] || positionId[b] == positionId[c] || positionId[a] == positionId[c]) continue;
+            result[written++] = a;
+            result[written++] = b;
+            result[written++] = c;
+        }
+        result.resize(written);
+    }
+
+    error = static_cast<float>(std::sqrt(appliedCost));
+    return result;
+}
+
+void buildMeshLods(Mesh& mesh) {
+    auto start = std::chrono::steady_clock::now();
+    mesh.lods.clear();
+    if (mesh.indices.empty()) {
+        return;
+    }
+
+    mesh.lods.push_back({ 0, static_cast<uint32_t>(mesh.indices.size()), 0.0f });
+    std::vector<uint32_t> current(mesh.indices);
+    float error = 0.0f;
+    for (unsigned level = 1; level <= MESH_LOD_LEVELS; level++) {
+        size_t target = (current.size() / 3 / 2) * 3;
+        if (target / 3 < MESH_LOD_MIN_TRIANGLES) break;
+
+        float levelError;
+        std::vector<uint32_t> simplified = simplifyMesh(mesh, current, target, INFINITY, levelError);
+        if (simplified.empty() || simplified.size() * 10 > current.size() * 9) {
+            break;  // Barely simplified further (mostly seams and borders left)
+        }
+
+        // Each level is simplified from the previous one, so errors add up
+        error += levelError;
+        mesh.lods.push_back({ static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(simplified.size()), error });
+        mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+        current.swap(simplified);
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Built " << mesh.lods.size() - 1 << " LOD levels in " << elapsed.count() << " ms:";
+    for (const MeshLod& lod : mesh.lods) {
+        std::cout << " " << lod.indexCount / 3;
+    }
+    std::cout << " triangles" << std::endl;
+}
+
+size_t selectMeshLod(const Mesh& mesh, const glm::vec3& cameraPosition, float fovyDegrees, int viewportHeight) {
+    if (mesh.lods.size() < 2 || viewportHeight <= 0) {
+        return 0;
+    }
+
+    // Distance to the nearest point of the bounding sphere
+    glm::vec3 center = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+    float radius = glm::length(mesh.boundsMax - mesh.boundsMin) * 0.5f;
+    float distance = glm::length(cameraPosition - center) - radius;
+    if (distance <= 0.0f) {
+        return 0;
+    }
+
+    float fovy = std::clamp(std::fabs(fovyDegrees), 1.0f, 179.0f);
+    float pixelsPerUnit = viewportHeight / (2.0f * std::tan(glm::radians(fovy) * 0.5f) * distance);
+    for (size_t level = mesh.lods.size() - 1; level > 0; level--) {
+        if (mesh.lods[level].error * pixelsPerUnit <= MESH_LOD_PIXEL_ERROR) {
+            return level;
+        }
+    }
+    return 0;
+}
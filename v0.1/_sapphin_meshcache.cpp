@@ -0,0 +1,231 @@
+// _sapphin_meshcache.cpp
+// This stores processed meshes in a binary file next to the model, so reopening it skips the .obj parse.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <cstddef>
+#include <filesystem>
+#include <system_error>
+
+// Headers
+#include "headers/_sapphin_utils.h"
+#include "headers/_sapphin_meshcache.h"
+#include "headers/_sapphin_types.h"
+
+static const char MESH_CACHE_MAGIC[8] = { 'S', 'A', 'P', 'M', 'E', 'S', 'H', '\0' };
+
+std::string meshCachePath(const std::string& objFilename) {
+    std::filesystem::path path(objFilename);
+    path.replace_extension(".sapmesh");
+    return path.string();
+}
+
+// Size and last write time of the source .obj
+struct SourceInfo {
+    uint64_t size = 0;
+    int64_t time = 0;
+};
+
+static bool getSourceInfo(const std::string& objFilename, SourceInfo& info) {
+    std::error_code error;
+    info.size = std::filesystem::file_size(objFilename, error);
+    if (error) return false;
+    auto writeTime = std::filesystem::last_write_time(objFilename, error);
+    if (error) return false;
+    info.time = static_cast<int64_t>(writeTime.time_since_epoch().count());
+    return true;
+}
+
+static bool hashSource(const std::string& objFilename, uint64_t& hash) {
+    MappedFile source;
+    if (!source.open(objFilename)) return false;
+    hash = hashBytes(source.data(), source.size());
+    return true;
+}
+
+// Store a new source write time in the header of an existing cache, so the next read needn't hash the source
+static void updateSourceTime(const std::string& cachePath, int64_t time) {
+    std::fstream file(cachePath, std::ios::binary | std::ios::in | std::ios::out);
+    if (file.is_open()) {
+        file.seekp(offsetof(MeshCacheHeader, sourceTime));
+        file.write(reinterpret_cast<const char*>(&time), sizeof(time));
+    }
+}
+
+// One array stored after the header
+struct PayloadBlock {
+    const void* data;
+    size_t size;
+};
+
+// Hashes of the payload blocks, each chained into the next
+static uint64_t hashPayload(const PayloadBlock* blocks, size_t blockCount) {
+    uint64_t hash = 0;
+    for (size_t i = 0; i < blockCount; i++) {
+        hash = hashBytes(blocks[i].data, blocks[i].size, hash);
+    }
+    return hash;
+}
+
+bool readMeshCache(const std::string& objFilename, uint32_t flags, Mesh& mesh) {
+    MappedFile cache;
+    if (!cache.open(meshCachePath(objFilename))) {
+        return false;  // No cache yet
+    }
+
+    MeshCacheHeader header;
+    if (cache.size() < sizeof(header)) {
+        std::cout << "Mesh cache is corrupt, re-parsing the model." << std::endl;
+        return false;
+    }
+    memcpy(&header, cache.data(), sizeof(header));
+    if (memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0 ||
+        header.version != MESH_CACHE_VERSION || header.vertexSize != sizeof(Vertex)) {
+        std::cout << "Mesh cache has an unknown format, re-parsing the model." << std::endl;
+        return false;
+    }
+    if (header.flags != flags) {
+        std::cout << "Mesh cache was built with other options, re-parsing the model." << std::endl;
+        return false;
+    }
+
+    // A source of another size has changed
+    SourceInfo source;
+    if (!getSourceInfo(objFilename, source) || source.size != header.sourceSize) {
+        std::cout << "Mesh cache is stale, re-parsing the model." << std::endl;
+        return false;
+    }
+
+    // Every array must fit in what is left of the file (checked before multiplying, so no count can wrap around)
+    size_t remaining = cache.size() - sizeof(header);
+    bool sizesValid = true;
+    auto blockBytes = [&](uint64_t count, size_t elementSize) -> size_t {
+        if (!sizesValid || count > remaining / elementSize) {
+            sizesValid = false;
+            return 0;
+        }
+        size_t bytes = static_cast<size_t>(count) * elementSize;
+        remaining -= bytes;
+        return bytes;
+    };
+    size_t vertexBytes = blockBytes(header.vertexCount, sizeof(Vertex));
+    size_t indexBytes = blockBytes(header.indexCount, sizeof(uint32_t));
+    size_t meshletBytes = blockBytes(header.meshletCount, sizeof(Meshlet));
+    size_t bvhBytes = blockBytes(header.bvhNodeCount, sizeof(BvhNode));
+    size_t lodBytes = blockBytes(header.lodCount, sizeof(MeshLod));
+    if (!sizesValid || remaining != 0) {
+        std::cout << "Mesh cache is corrupt, re-parsing the model." << std::endl;
+        return false;
+    }
+
+    // Same size and write time: the source is taken as unchanged without reading it. Only a source that was
+    // touched (or copied) is hashed, and if its contents are the same, the cache takes its new write time.
+    bool touched = source.time != header.sourceTime;
+    if (touched) {
+        uint64_t sourceHash;
+        if (!hashSource(objFilename, sourceHash) || sourceHash != header.sourceHash) {
+            std::cout << "Mesh cache is stale, re-parsing the model." << std::endl;
+            return false;
+        }
+    }
+
+    // Make sure the payload wasn't damaged
+    const char* payload = cache.data() + sizeof(header);
+    const PayloadBlock blocks[] = {
+        { payload, vertexBytes },
+        { payload + vertexBytes, indexBytes },
+        { payload + vertexBytes + indexBytes, meshletBytes },
+        { payload + vertexBytes + indexBytes + meshletBytes, bvhBytes },
+        { payload + vertexBytes + indexBytes + meshletBytes + bvhBytes, lodBytes },
+    };
+    if (hashPayload(blocks, 5) != header.payloadHash) {
+        std::cout << "Mesh cache is corrupt, re-parsing the model." << std::endl;
+        return false;
+    }
+
+    const Vertex* vertices = reinterpret_cast<const Vertex*>(blocks[0].data);
+    const uint32_t* indices = reinterpret_cast<const uint32_t*>(blocks[1].data);
+    const Meshlet* meshlets = reinterpret_cast<const Meshlet*>(blocks[2].data);
+    const BvhNode* bvh = reinterpret_cast<const BvhNode*>(blocks[3].data);
+    const MeshLod* lods = reinterpret_cast<const MeshLod*>(blocks[4].data);
+    mesh.vertices.assign(vertices, vertices + header.vertexCount);
+    mesh.indices.assign(indices, indices + header.indexCount);
+    mesh.meshlets.assign(meshlets, meshlets + header.meshletCount);
+    mesh.bvh.assign(bvh, bvh + header.bvhNodeCount);
+    mesh.lods.assign(lods, lods + header.lodCount);
+    mesh.boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    mesh.boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+
+    if (touched) {
+        cache.close();
+        updateSourceTime(meshCachePath(objFilename), source.time);
+    }
+    return true;
+}
+
+bool writeMeshCache(const std::string& objFilename, uint32_t flags, const Mesh& mesh) {
+    MeshCacheHeader header = {};
+    memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+    header.version = MESH_CACHE_VERSION;
+    header.vertexSize = sizeof(Vertex);
+    header.flags = flags;
+
+    SourceInfo source;
+    if (!getSourceInfo(objFilename, source) || !hashSource(objFilename, header.sourceHash)) {
+        return false;
+    }
+    header.sourceSize = source.size;
+    header.sourceTime = source.time;
+
+    const PayloadBlock blocks[] = {
+        { mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex) },
+        { mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t) },
+        { mesh.meshlets.data(), mesh.meshlets.size() * sizeof(Meshlet) },
+        { mesh.bvh.data(), mesh.bvh.size() * sizeof(BvhNode) },
+        { mesh.lods.data(), mesh.lods.size() * sizeof(MeshLod) },
+    };
+    header.vertexCount = mesh.vertices.size();
+    header.indexCount = mesh.indices.size();
+    header.meshletCount = mesh.meshlets.size();
+    header.bvhNodeCount = mesh.bvh.size();
+    header.lodCount = mesh.lods.size();
+    header.payloadHash = hashPayload(blocks, 5);
+    header.boundsMin[0] = mesh.boundsMin.x;
+    header.boundsMin[1] = mesh.boundsMin.y;
+    header.boundsMin[2] = mesh.boundsMin.z;
+    header.boundsMax[0] = mesh.boundsMax.x;
+    header.boundsMax[1] = mesh.boundsMax.y;
+    header.boundsMax[2] = mesh.boundsMax.z;
+
+    // Write to a temporary file first so a crash never leaves a half-written cache behind
+    std::string cachePath = meshCachePath(objFilename);
+    std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const PayloadBlock& block : blocks) {
+            file.write(static_cast<const char*>(block.data), block.size);
+        }
+        if (!file.good()) {
+            file.close();
+            std::error_code error;
+            std::filesystem::remove(tempPath, error);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,205 @@
+// _sapphin_meshlets.cpp
+// This splits meshes into meshlets that can be culled against the view before they are drawn.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+// Headers
+#include "headers/_sapphin_meshlets.h"
+#include "headers/_sapphin_meshopt.h"
+#include "headers/_sapphin_types.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+
+static inline glm::vec3 vertexPosition(const Mesh& mesh, uint32_t index) {
+    const Vertex& vertex = mesh.vertices[index];
+    return glm::vec3(vertex.x, vertex.y, vertex.z);
+}
+
+void computeMeshletBounds(const Mesh& mesh, Meshlet& meshlet) {
+    const uint32_t* indices = mesh.indices.data() + meshlet.firstIndex;
+
+    // Bounding sphere around the center of the box
+    glm::vec3 boxMin(INFINITY), boxMax(-INFINITY);
+    for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+        glm::vec3 p = vertexPosition(mesh, indices[i]);
+        boxMin = glm::min(boxMin, p);
+        boxMax = glm::max(boxMax, p);
+    }
+    meshlet.center = (boxMin + boxMax) * 0.5f;
+    meshlet.radius = 0.0f;
+    for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+        meshlet.radius = std::max(meshlet.radius, glm::length(vertexPosition(mesh, indices[i]) - meshlet.center));
+    }
+
+    // Normal cone: average face normal, widened until it covers every face
+    std::vector<glm::vec3> normals;
+    normals.reserve(meshlet.indexCount / 3);
+    glm::vec3 axis(0.0f);
+    for (uint32_t i = 0; i + 2 < meshlet.indexCount; i += 3) {
+        glm::vec3 p0 = vertexPosition(mesh, indices[i]);
+        glm::vec3 normal = glm::cross(vertexPosition(mesh, indices[i + 1]) - p0, vertexPosition(mesh, indices[i + 2]) - p0);
+        float length = glm::length(normal);
+        if (length <= 0.0f) continue;  // Degenerate triangles are never visible
+        normals.push_back(normal / length);
+        axis += normal / length;
+    }
+
+    meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.coneApex = meshlet.center;
+    meshlet.coneCutoff = 2.0f;
+    float axisLength = glm::length(axis);
+    if (normals.empty() || axisLength <= 0.0f) {
+        return;
+    }
+    axis /= axisLength;
+
+    float minDot = 1.0f;
+    for (const glm::vec3& normal : normals) {
+        minDot = std::min(minDot, glm::dot(normal, axis));
+    }
+
+    // Cones wider than ~84 degrees (half angle) would cull too rarely to be worth testing
+    if (minDot <= 0.1f) {
+        meshlet.coneAxis = axis;
+        return;
+    }
+
+    // Move the apex back along the axis until it is behind every triangle's plane, so the test
+    // holds for cameras anywhere, not just far away
+    float maxT = 0.0f;
+    size_t n = 0;
+    for (uint32_t i = 0; i + 2 < meshlet.indexCount; i += 3) {
+        glm::vec3 p0 = vertexPosition(mesh, indices[i]);
+        glm::vec3 normal = glm::cross(vertexPosition(mesh, indices[i + 1]) - p0, vertexPosition(mesh, indices[i + 2]) - p0);
+        if (glm::length(normal) <= 0.0f) continue;
+        const glm::vec3& unit = normals[n++];
+        float t = glm::dot(meshlet.center - p0, unit) / glm::dot(axis, unit);
+        maxT = std::max(maxT, t);
+    }
+
+    meshlet.coneAxis = axis;
+    meshlet.coneApex = meshlet.center - axis * maxT;
+    meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+void buildMeshlets(Mesh& mesh) {
+    auto start = std::chrono::steady_clock::now();
+    mesh.meshlets.clear();
+    size_t triangleCount = mesh.indices.size() / 3;
+    size_t vertexCount = mesh.vertices.size();
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // Triangles around every vertex, stored as compressed rows
+    std::vector<uint32_t> rowStart(vertexCount + 1, 0);
+    for (uint32_t index : mesh.indices) {
+        rowStart[index + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++) {
+        rowStart[v + 1] += rowStart[v];
+    }
+    std::vector<uint32_t> adjacent(mesh.indices.size());
+    {
+        std::vector<uint32_t> cursor(rowStart.begin(), rowStart.end() - 1);
+        for (size_t i = 0; i < mesh.indices.size(); i++) {
+            adjacent[cursor[mesh.indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    auto centroid = [&](uint32_t triangle) {
+        return (vertexPosition(mesh, mesh.indices[triangle * 3]) + vertexPosition(mesh, mesh.indices[triangle * 3 + 1]) +
+            vertexPosition(mesh, mesh.indices[triangle * 3 + 2])) / 3.0f;
+    };
+
+    // Which meshlet (+1) last used each vertex, so membership tests need no clearing between meshlets
+    std::vector<uint32_t> usedBy(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> result;
+    result.reserve(mesh.indices.size());
+    size_t seedCursor = 0;
+
+    while (true) {
+        // Seed with the first triangle not emitted yet, which follows the existing (possibly optimized) order
+        while (seedCursor < triangleCount && emitted[seedCursor]) seedCursor++;
+        if (seedCursor == triangleCount) break;
+
+        Meshlet meshlet = {};
+        meshlet.firstIndex = static_cast<uint32_t>(result.size());
+        uint32_t stamp = static_cast<uint32_t>(mesh.meshlets.size() + 1);
+        unsigned meshletVertices = 0;
+        unsigned meshletTriangles = 0;
+        glm::vec3 centerSum(0.0f);
+        candidates.clear();
+
+        uint32_t next = static_cast<uint32_t>(seedCursor);
+        while (true) {
+            // Add the triangle and queue its neighbours
+            emitted[next] = true;
+            meshletTriangles++;
+            centerSum += centroid(next);
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t v = mesh.indices[next * 3 + corner];
+                result.push_back(v);
+                if (usedBy[v] != stamp) {
+                    usedBy[v] = stamp;
+                    meshletVertices++;
+                }
+                for (uint32_t k = rowStart[v]; k < rowStart[v + 1]; k++) {
+                    if (!emitted[adjacent[k]]) candidates.push_back(adjacent[k]);
+                }
+            }
+            if (meshletTriangles == MESHLET_MAX_TRIANGLES) break;
+
+            // Next: the neighbour adding the fewest new vertices, then the one closest to the meshlet's center
+            glm::vec3 center = centerSum / static_cast<float>(meshletTriangles);
+            long long best = -1;
+            unsigned bestNew = 4;
+            float bestDistance = INFINITY;
+            size_t live = 0;
+            for (uint32_t triangle : candidates) {
+                if (emitted[triangle]) continue;
+                candidates[live++] = triangle;
+
+                unsigned newVertices = 0;
+                for (int corner = 0; corner < 3; corner++) {
+                    if (usedBy[mesh.indices[triangle * 3 + corner]] != stamp) newVertices++;
+                }
+                if (meshletVertices + newVertices > MESHLET_MAX_VERTICES || newVertices > bestNew) continue;
+
+                glm::vec3 offset = centroid(triangle) - center;
+                float distance = glm::dot(offset, offset);
+                if (newVertices < bestNew || distance < bestDistance) {
+                    best = triangle;
+                    bestNew = newVertices;
+                    bestDistance = distance;
+                }
+            }
+            candidates.resize(live);
+            if (best < 0) break;  // Nothing connected fits, start a new meshlet
+            next = static_cast<uint32_t>(best);
+        }
+
+        meshlet.indexCount = static_cast<uint32_t>(result.size()) - meshlet.firstIndex;
+        mesh.meshlets.push_back(meshlet);
+    }
+
+    mesh.indices.swap(result);
+
+    // Meshlets are contiguous now; renumber vertices so each one reads a compact range of the vertex buffer
+    optimizeVertexFetch(mesh);
+    for (Meshlet& meshlet : mesh.meshlets) {
+        computeMeshletBounds(mesh, meshlet);
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Built " << mesh.meshlets.size() << " meshlets (" << static_cast<float>(triangleCount) / mesh.meshlets.size()
+        << " triangles each on average) in " << elapsed.count() << " ms" << std::endl;
+}
@@ -0,0 +1,292 @@
+// _sapphin_meshopt.cpp
+// This reorders triangles and vertices so the GPU transforms fewer vertices and shades fewer hidden pixels.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+// Headers
+#include "headers/_sapphin_meshopt.h"
+#include "headers/_sapphin_types.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, unsigned cacheSize) {
+    VertexCacheStats stats;
+    if (indices.empty()) {
+        return stats;
+    }
+
+    // FIFO cache: a vertex is a hit while fewer than cacheSize misses happened since it was loaded
+    std::vector<size_t> loadedAt(vertexCount, 0);
+    std::vector<bool> referenced(vertexCount, false);
+    size_t misses = 0;
+    size_t uniqueVertices = 0;
+    for (uint32_t index : indices) {
+        if (!referenced[index]) {
+            referenced[index] = true;
+            uniqueVertices++;
+        }
+        if (loadedAt[index] == 0 || misses + 1 - loadedAt[index] > cacheSize) {
+            misses++;
+            loadedAt[index] = misses;
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+    stats.atvr = static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+    return stats;
+}
+
+// Triangles around every vertex, stored as compressed rows
+struct TriangleAdjacency {
+    std::vector<uint32_t> rowStart;
+    std::vector<uint32_t> triangles;
+};
+
+static TriangleAdjacency buildAdjacency(const std::vector<uint32_t>& indices, size_t vertexCount) {
+    TriangleAdjacency adjacency;
+    adjacency.rowStart.assign(vertexCount + 1, 0);
+    for (uint32_t index : indices) {
+        adjacency.rowStart[index + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++) {
+        adjacency.rowStart[v + 1] += adjacency.rowStart[v];
+    }
+
+    adjacency.triangles.resize(indices.size());
+    std::vector<uint32_t> cursor(adjacency.rowStart.begin(), adjacency.rowStart.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++) {
+        adjacency.triangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+    return adjacency;
+}
+
+// Tipsify (Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw").
+// Fans out around one vertex at a time and picks the next fanning vertex among those still in the cache.
+std::vector<uint32_t> optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, unsigned cacheSize) {
+    std::vector<uint32_t> clusters;
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return clusters;
+    }
+
+    TriangleAdjacency adjacency = buildAdjacency(indices, vertexCount);
+
+    // Triangles not emitted yet around every vertex
+    std::vector<uint32_t> liveTriangles(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        liveTriangles[v] = adjacency.rowStart[v + 1] - adjacency.rowStart[v];
+    }
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    uint32_t timestamp = cacheSize + 1;
+    size_t cursor = 0;
+    long long fanVertex = 0;
+
+    while (fanVertex >= 0) {
+        candidates.clear();
+
+        // Emit every remaining triangle around the fanning vertex
+        for (uint32_t k = adjacency.rowStart[fanVertex]; k < adjacency.rowStart[fanVertex + 1]; k++) {
+            uint32_t triangle = adjacency.triangles[k];
+            if (emitted[triangle]) continue;
+
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t v = indices[triangle * 3 + corner];
+                result.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                liveTriangles[v]--;
+                if (timestamp - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = timestamp++;
+                }
+            }
+            emitted[triangle] = true;
+        }
+
+        // Next fanning vertex: the candidate that stays in the cache longest once its triangles are emitted
+        long long best = -1;
+        long long bestPriority = -1;
+        for (uint32_t v : candidates) {
+            if (liveTriangles[v] == 0) continue;
+            long long priority = 0;
+            if (timestamp - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize) {
+                priority = timestamp - cacheTime[v];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                best = v;
+            }
+        }
+
+        if (best < 0) {
+            // Dead end: continue from a recently used vertex, or else the next unfinished one in order.
+            // Every such jump starts a new cluster for the overdraw pass.
+            while (!deadEnd.empty() && best < 0) {
+                uint32_t v = deadEnd.back();
+                deadEnd.pop_back();
+                if (liveTriangles[v] > 0) best = v;
+            }
+            while (best < 0 && cursor < vertexCount) {
+                if (liveTriangles[cursor] > 0) best = static_cast<long long>(cursor);
+                cursor++;
+            }
+            if (best >= 0) {
+                clusters.push_back(static_cast<uint32_t>(result.size() / 3));
+            }
+        }
+        fanVertex = best;
+    }
+
+    indices.swap(result);
+    if (clusters.empty() || clusters.front() != 0) {
+        clusters.insert(clusters.begin(), 0);
+    }
+    return clusters;
+}
+
+// Split clusters further wherever the ACMR of a cluster, simulated from a cold cache since clusters get
+// reordered, is already within threshold of the whole mesh. This gives the overdraw sort more freedom
+// without losing vertex cache efficiency.
+static std::vector<uint32_t> softClusterBoundaries(const std::vector<uint32_t>& indices, size_t vertexCount,
+    const std::vector<uint32_t>& clusters, float threshold) {
+    size_t triangleCount = indices.size() / 3;
+    float targetAcmr = analyzeVertexCache(indices, vertexCount).acmr * threshold;
+
+    std::vector<uint32_t> result;
+    std::vector<size_t> loadedAt(vertexCount, 0);
+    size_t misses = 0;
+    for (size_t c = 0; c < clusters.size(); c++) {
+        size_t start = clusters[c];
+        size_t end = (c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount;
+        result.push_back(static_cast<uint32_t>(start));
+
+        size_t clusterStart = start;
+        size_t missesAtClusterStart = misses;
+        for (size_t t = start; t < end; t++) {
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t v = indices[t * 3 + corner];
+                if (loadedAt[v] <= missesAtClusterStart || misses + 1 - loadedAt[v] > VERTEX_CACHE_SIZE) {
+                    misses++;
+                    loadedAt[v] = misses;
+                }
+            }
+
+            size_t clusterTriangles = t + 1 - clusterStart;
+            float clusterAcmr = static_cast<float>(misses - missesAtClusterStart) / clusterTriangles;
+            if (t + 1 < end && clusterAcmr <= targetAcmr) {
+                result.push_back(static_cast<uint32_t>(t + 1));
+                clusterStart = t + 1;
+                missesAtClusterStart = misses;
+            }
+        }
+    }
+    return result;
+}
+
+void optimizeOverdraw(const Mesh& mesh, std::vector<uint32_t>& indices, const std::vector<uint32_t>& hardClusters, float threshold) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || hardClusters.empty()) {
+        return;
+    }
+    std::vector<uint32_t> clusters = softClusterBoundaries(indices, mesh.vertices.size(), hardClusters, threshold);
+
+    auto position = [&](uint32_t index) {
+        const Vertex& vertex = mesh.vertices[index];
+        return glm::vec3(vertex.x, vertex.y, vertex.z);
+    };
+
+    // Area-weighted centroid of the whole mesh
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t t = 0; t < triangleCount; t++) {
+        glm::vec3 p0 = position(indices[t * 3]), p1 = position(indices[t * 3 + 1]), p2 = position(indices[t * 3 + 2]);
+        float area = glm::length(glm::cross(p1 - p0, p2 - p0));
+        meshCentroid += (p0 + p1 + p2) * (area / 3.0f);
+        meshArea += area;
+    }
+    if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+    // Clusters facing away from the center are likely in front of the rest, so they sort first
+    struct ClusterSort {
+        float key;
+        uint32_t cluster;
+    };
+    std::vector<ClusterSort> order(clusters.size());
+    for (size_t c = 0; c < clusters.size(); c++) {
+        size_t start = clusters[c];
+        size_t end = (c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount;
+
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = start; t < end; t++) {
+            glm::vec3 p0 = position(indices[t * 3]), p1 = position(indices[t * 3 + 1]), p2 = position(indices[t * 3 + 2]);
+            glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+            float faceArea = glm::length(faceNormal);
+            centroid += (p0 + p1 + p2) * (faceArea / 3.0f);
+            normal += faceNormal;
+            area += faceArea;
+        }
+        if (area > 0.0f) centroid /= area;
+        float normalLength = glm::length(normal);
+        if (normalLength > 0.0f) normal /= normalLength;
+
+        order[c].key = glm::dot(centroid - meshCentroid, normal);
+        order[c].cluster = static_cast<uint32_t>(c);
+    }
+    std::stable_sort(order.begin(), order.end(), [](const ClusterSort& a, const ClusterSort& b) {
+        return a.key > b.key;
+    });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (const ClusterSort& entry : order) {
+        size_t start = clusters[entry.cluster];
+        size_t end = (entry.cluster + 1 < clusters.size()) ? clusters[entry.cluster + 1] : triangleCount;
+        result.insert(result.end(), indices.begin() + start * 3, indices.begin() + end * 3);
+    }
+    indices.swap(result);
+}
+
+void optimizeVertexFetch(Mesh& mesh) {
+    const uint32_t UNUSED = 0xFFFFFFFFu;
+    std::vector<uint32_t> remap(mesh.vertices.size(), UNUSED);
+    std::vector<Vertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+
+    for (uint32_t& index : mesh.indices) {
+        if (remap[index] == UNUSED) {
+            remap[index] = static_cast<uint32_t>(vertices.size());
+            vertices.push_back(mesh.vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    // Vertices no triangle uses are dropped
+    mesh.vertices.swap(vertices);
+}
+
+void optimizeMesh(Mesh& mesh) {
+    auto start = std::chrono::steady_clock::now();
+    VertexCacheStats before = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+    std::vector<uint32_t> clusters = optimizeVertexCache(mesh.indices, mesh.vertices.size());
+    optimizeOverdraw(mesh, mesh.indices, clusters);
+    optimizeVertexFetch(mesh);
+
+    VertexCacheStats after = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Mesh optimization (" << elapsed.count() << " ms): ACMR " << before.acmr << " -> " << after.acmr
+        << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+}
@@ -0,0 +1,509 @@
+// _sapphin_microbench.cpp
+// This generates synthetic .obj files and times every stage of loading them, so loader changes can be compared.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <filesystem>
+#include <system_error>
+
+// Headers
+#include "headers/_sapphin_microbench.h"
+#include "headers/_sapphin_utils.h"
+#include "headers/_sapphin_modeling.h"
+#include "headers/_sapphin_objparser.h"
+#include "headers/_sapphin_normals.h"
+#include "headers/_sapphin_boundedload.h"
+#include "headers/_sapphin_types.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+
+// Every operator new of the program goes through here (new[] and the nothrow forms call it), so the stages'
+// allocations can be counted. Outside a counted stage that costs one relaxed load, so the renderer's threads
+// don't all write the same counters. Relaxed counters: only differences are read, from the thread that waited.
+static std::atomic<bool> allocationCounting(false);
+static std::atomic<uint64_t> allocationTotal(0);
+static std::atomic<uint64_t> allocatedBytesTotal(0);
+
+void* operator new(size_t size) {
+    if (allocationCounting.load(std::memory_order_relaxed)) {
+        allocationTotal.fetch_add(1, std::memory_order_relaxed);
+        allocatedBytesTotal.fetch_add(size, std::memory_order_relaxed);
+    }
+    void* pointer = std::malloc(size > 0 ? size : 1);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+void countAllocations(bool enabled) {
+    allocationCounting.store(enabled);
+}
+
+AllocationCount allocationCount() {
+    AllocationCount count;
+    count.allocations = allocationTotal.load(std::memory_order_relaxed);
+    count.bytes = allocatedBytesTotal.load(std::memory_order_relaxed);
+    return count;
+}
+
+const char* syntheticObjFormatName(int format) {
+    switch (format) {
+    case SYNTHETIC_POSITIONS: return "v";
+    case SYNTHETIC_TEXCOORDS: return "v/vt";
+    case SYNTHETIC_NORMALS: return "v//vn";
+    case SYNTHETIC_TEXCOORDS_NORMALS: return "v/vt/vn";
+    case SYNTHETIC_COLORS: return "v+color";
+    default: return "unknown";
+    }
+}
+
+// xorshift32, so the files don't depend on the standard library's engines or distributions
+static uint32_t nextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static void appendUnsigned(std::string& text, uint64_t value) {
+    char digits[20];
+    int count = 0;
+    do {
+        digits[count++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    while (count > 0) {
+        text += digits[--count];
+    }
+}
+
+// Append micros / 1000000 with six decimals
+static void appendMicros(std::string& text, int64_t micros) {
+    if (micros < 0) {
+        text += '-';
+        micros = -micros;
+    }
+    appendUnsigned(text, static_cast<uint64_t>(micros / 1000000));
+    text += '.';
+    int64_t fraction = micros % 1000000;
+    for (int64_t digit = 100000; digit > 0; digit /= 10) {
+        text += static_cast<char>('0' + (fraction / digit) % 10);
+    }
+}
+
+// Random value in [-range, range]
+static int64_t randomMicros(uint32_t& state, int64_t range) {
+    return static_cast<int64_t>(nextRandom(state) % static_cast<uint32_t>(2 * range + 1)) - range;
+}
+
+static void appendCorner(std::string& text, uint64_t index, int format) {
+    appendUnsigned(text, index);
+    if (format == SYNTHETIC_TEXCOORDS || format == SYNTHETIC_TEXCOORDS_NORMALS) {
+        text += '/';
+        appendUnsigned(text, index);
+    }
+    if (format == SYNTHETIC_NORMALS) {
+        text += "//";
+        appendUnsigned(text, index);
+    }
+    else if (format == SYNTHETIC_TEXCOORDS_NORMALS) {
+        text += '/';
+        appendUnsigned(text, index);
+    }
+}
+
+uint64_t writeSyntheticObj(const std::string& filename, size_t faceCount, int format, uint32_t seed) {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Could not create " << filename << std::endl;
+        return 0;
+    }
+
+    // A grid of quads, two triangles each, as close to square as possible
+    size_t quads = (faceCount + 1) / 2;
+    size_t columns = std::max<size_t>(1, static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(quads)))));
+    size_t rows = std::max<size_t>(1, (quads + columns - 1) / columns);
+    const size_t flushBytes = 1 << 20;
+    uint64_t written = 0;
+    std::string text;
+    text.reserve(flushBytes + 256);
+    auto flush = [&](bool force) {
+        if (force || text.size() >= flushBytes) {
+            file.write(text.data(), static_cast<std::streamsize>(text.size()));
+            written += text.size();
+            text.clear();
+        }
+    };
+
+    text += "# Sapphin synthetic model: ";
+    text += syntheticObjFormatName(format);
+    text += ", ";
+    appendUnsigned(text, faceCount);
+    text += " faces, seed ";
+    appendUnsigned(text, seed);
+    text += '\n';
+
+    // Positions on a jittered grid one unit apart with random heights; every attribute is one per position
+    uint32_t state = seed != 0 ? seed : 1;
+    for (size_t row = 0; row <= rows; row++) {
+        for (size_t column = 0; column <= columns; column++) {
+            text += "v ";
+            appendMicros(text, static_cast<int64_t>(column) * 1000000 + randomMicros(state, 250000));
+            text += ' ';
+            appendMicros(text, randomMicros(state, 500000));
+            text += ' ';
+            appendMicros(text, static_cast<int64_t>(row) * 1000000 + randomMicros(state, 250000));
+            if (format == SYNTHETIC_COLORS) {
+                for (int channel = 0; channel < 3; channel++) {
+                    text += ' ';
+                    appendMicros(text, 500000 + randomMicros(state, 500000));
+                }
+            }
+            text += '\n';
+            flush(false);
+        }
+    }
+    if (format == SYNTHETIC_TEXCOORDS || format == SYNTHETIC_TEXCOORDS_NORMALS) {
+        for (size_t row = 0; row <= rows; row++) {
+            for (size_t column = 0; column <= columns; column++) {
+                text += "vt ";
+                appendMicros(text, static_cast<int64_t>(column * 1000000 / columns));
+                text += ' ';
+                appendMicros(text, static_cast<int64_t>(row * 1000000 / rows));
+                text += '\n';
+                flush(false);
+            }
+        }
+    }
+    if (format == SYNTHETIC_NORMALS || format == SYNTHETIC_TEXCOORDS_NORMALS) {
+        // Up, tilted a little (not exactly unit length; the loaders compute their own normals)
+        for (size_t position = 0; position < (rows + 1) * (columns + 1); position++) {
+            text += "vn ";
+            appendMicros(text, randomMicros(state, 100000));
+            text += " 1.000000 ";
+            appendMicros(text, randomMicros(state, 100000));
+            text += '\n';
+            flush(false);
+        }
+    }
+
+    size_t faces = 0;
+    for (size_t quad = 0; quad < quads; quad++) {
+        uint64_t a = (quad / columns) * (columns + 1) + quad % columns + 1;
+        uint64_t b = a + columns + 1;
+        uint64_t triangles[2][3] = { { a, b, b + 1 }, { a, b + 1, a + 1 } };
+        for (int triangle = 0; triangle < 2 && faces < faceCount; triangle++, faces++) {
+            text += 'f';
+            for (int corner = 0; corner < 3; corner++) {
+                text += ' ';
+                appendCorner(text, triangles[triangle][corner], format);
+            }
+            text += '\n';
+            flush(false);
+        }
+    }
+    flush(true);
+
+    file.close();
+    if (!file) {
+        std::cerr << "Could not write " << filename << std::endl;
+        return 0;
+    }
+    return written;
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// One stage on one file
+struct MicrobenchResult {
+    std::string format;
+    size_t faces = 0;
+    uint64_t fileBytes = 0;
+    uint64_t fileHash = 0;
+    std::string stage;
+    size_t repetitions = 0;
+    double milliseconds = 0.0;        // Median repetition
+    AllocationCount allocated;        // During the first repetition
+    bool hasBaseline = false;
+    double baselineMilliseconds = 0.0;
+    uint64_t baselineAllocations = 0;
+    bool baselineInputDiffers = false;
+};
+
+// Run reset() and then work() until the work has taken MICROBENCH_MIN_MILLISECONDS in total; reset() is not
+// timed (it frees the previous repetition's output so every repetition allocates the same way)
+template <typename Reset, typename Work>
+static void timeStage(MicrobenchResult& result, Reset reset, Work work) {
+    std::vector<double> times;
+    double totalMilliseconds = 0.0;
+    do {
+        reset();
+        const bool counted = times.empty();
+        if (counted) {
+            countAllocations(true);
+        }
+        AllocationCount before = allocationCount();
+        auto start = std::chrono::steady_clock::now();
+        work();
+        double milliseconds = millisecondsSince(start);
+        if (counted) {
+            countAllocations(false);
+            AllocationCount after = allocationCount();
+            result.allocated.allocations = after.allocations - before.allocations;
+            result.allocated.bytes = after.bytes - before.bytes;
+        }
+        times.push_back(milliseconds);
+        totalMilliseconds += milliseconds;
+    } while (totalMilliseconds < MICROBENCH_MIN_MILLISECONDS);
+
+    std::sort(times.begin(), times.end());
+    result.repetitions = times.size();
+    result.milliseconds = times[times.size() / 2];
+}
+
+// Value of "key" on a line of a report written below (strings without their quotes); empty if missing
+static std::string reportField(const std::string& line, const std::string& key) {
+    std::string pattern = "\"" + key + "\": ";
+    size_t start = line.find(pattern);
+    if (start == std::string::npos) return "";
+    start += pattern.size();
+    if (start < line.size() && line[start] == '"') {
+        size_t end = line.find('"', start + 1);
+        return end == std::string::npos ? "" : line.substr(start + 1, end - start - 1);
+    }
+    size_t end = line.find_first_of(",}", start);
+    return line.substr(start, end == std::string::npos ? std::string::npos : end - start);
+}
+
+static std::string resultKey(const std::string& format, const std::string& faces, const std::string& stage) {
+    return format + " " + faces + " " + stage;
+}
+
+// Results of an earlier report, one per line, by format, size and stage
+static bool loadBaseline(const std::string& filename, std::map<std::string, MicrobenchResult>& baseline) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Microbenchmark: could not open the baseline " << filename << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        std::string stage = reportField(line, "stage");
+        if (stage.empty()) continue;
+        MicrobenchResult result;
+        result.milliseconds = std::atof(reportField(line, "milliseconds").c_str());
+        result.allocated.allocations = std::strtoull(reportField(line, "allocations").c_str(), nullptr, 10);
+        result.fileHash = std::strtoull(reportField(line, "fileHash").c_str(), nullptr, 16);
+        baseline[resultKey(reportField(line, "format"), reportField(line, "faces"), stage)] = result;
+    }
+    if (baseline.empty()) {
+        std::cerr << "Microbenchmark: " << filename << " has no results" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static std::string hexString(uint64_t value) {
+    std::ostringstream text;
+    text << std::hex << std::setw(16) << std::setfill('0') << value;
+    return text.str();
+}
+
+static void printResult(const MicrobenchResult& result) {
+    double seconds = result.milliseconds / 1000.0;
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(3)
+        << "  " << std::left << std::setw(8) << result.format << std::right << std::setw(10) << result.faces << " faces  "
+        << std::left << std::setw(14) << result.stage << std::right << std::setw(11) << result.milliseconds << " ms"
+        << std::setprecision(1) << std::setw(9) << (seconds > 0.0 ? result.fileBytes / (1024.0 * 1024.0) / seconds : 0.0) << " MB/s"
+        << std::setw(9) << (seconds > 0.0 ? result.faces / seconds / 1e6 : 0.0) << " M faces/s"
+        << std::setw(8) << result.allocated.allocations << " allocations"
+        << std::setw(9) << result.allocated.bytes / (1024.0 * 1024.0) << " MB";
+    if (result.hasBaseline) {
+        line << std::setprecision(2) << "  " << (result.baselineMilliseconds > 0.0 ? result.milliseconds / result.baselineMilliseconds : 0.0)
+            << "x baseline time, " << (static_cast<int64_t>(result.allocated.allocations) - static_cast<int64_t>(result.baselineAllocations))
+            << " allocations";
+        if (result.baselineInputDiffers) {
+            line << " (different input!)";
+        }
+    }
+    std::cout << line.str() << std::endl;
+}
+
+int runMicrobench(const EngineOptions& options) {
+    unsigned threadCount = resolveThreadCount(options.threadCount);
+    std::map<std::string, MicrobenchResult> baseline;
+    if (!options.baselinePath.empty() && !loadBaseline(options.baselinePath, baseline)) {
+        return 1;
+    }
+
+    std::vector<size_t> sizes;
+    for (size_t faces = MICROBENCH_MIN_FACES; faces <= options.microbenchFaces; faces *= 10) {
+        sizes.push_back(faces);
+    }
+    if (sizes.empty() || sizes.back() != options.microbenchFaces) {
+        sizes.push_back(options.microbenchFaces);
+    }
+
+    std::error_code error;
+    std::filesystem::path directory = std::filesystem::temp_directory_path(error);
+    if (error) {
+        directory = ".";
+    }
+
+    std::cout << "Microbenchmark: " << SYNTHETIC_FORMAT_COUNT << " formats, " << sizes.size() << " sizes up to "
+        << options.microbenchFaces << " faces, each stage repeated for at least " << MICROBENCH_MIN_MILLISECONDS
+        << " ms (median shown); MB/s is of .obj text" << std::endl;
+
+    std::vector<MicrobenchResult> results;
+    bool failed = false;
+    for (size_t faceCount : sizes) {
+        for (int format = 0; format < SYNTHETIC_FORMAT_COUNT; format++) {
+            std::string path = (directory / ("sapphin_microbench_" + std::to_string(faceCount) + "_" + std::to_string(format) + ".obj")).string();
+            auto generateStart = std::chrono::steady_clock::now();
+            uint64_t fileBytes = writeSyntheticObj(path, faceCount, format);
+            MappedFile file;
+            if (fileBytes == 0 || !file.open(path)) {
+                std::cerr << "Microbenchmark: could not generate " << path << std::endl;
+                std::filesystem::remove(path, error);
+                failed = true;
+                continue;
+            }
+            const char* begin = file.data();
+            const char* end = begin + file.size();
+
+            MicrobenchResult common;
+            common.format = syntheticObjFormatName(format);
+            common.faces = faceCount;
+            common.fileBytes = fileBytes;
+            common.fileHash = hashBytes(begin, file.size());
+            std::cout << "Generated " << common.format << " with " << faceCount << " faces (" << fileBytes / 1024 << " KB) in "
+                << millisecondsSince(generateStart) << " ms" << std::endl;
+
+            size_t firstResult = results.size();
+            auto addResult = [&](const char* stage) -> MicrobenchResult& {
+                results.push_back(common);
+                results.back().stage = stage;
+                return results.back();
+            };
+            auto nothing = []() {};
+
+            // Classifying lines without parsing any numbers (the loop around every record)
+            addResult("lineLoop");
+            ObjCounts counts;
+            timeStage(results.back(), nothing, [&]() { counts = countObjRecords(begin, end, 1); });
+
+            // Face records only: the index parsing, a block of faces at a time (as the bounded loader reads them)
+            addResult("faceIndices");
+            std::vector<ObjFace> block;
+            size_t streamedFaces = 0;
+            timeStage(results.back(), [&]() { block.reserve(BOUNDED_FACE_BLOCK); streamedFaces = 0; }, [&]() {
+                ObjFaceStream stream;
+                stream.cursor = begin;
+                stream.end = end;
+                while (readObjFaces(stream, block, BOUNDED_FACE_BLOCK)) {
+                    streamedFaces += block.size();
+                }
+            });
+            block = std::vector<ObjFace>();
+
+            // Every record into ObjData, on one thread and then (when there are several) on all of them
+            addResult("parse");
+            ObjData data;
+            timeStage(results.back(), [&]() { data = ObjData(); }, [&]() { parseObjBuffer(begin, end, data); });
+            if (threadCount > 1) {
+                addResult("parseParallel");
+                ObjData parallelData;
+                timeStage(results.back(), [&]() { parallelData = ObjData(); }, [&]() { parseObjBufferParallel(begin, end, parallelData, threadCount); });
+            }
+            if (data.faces.size() != faceCount || streamedFaces != faceCount || counts.faces != faceCount) {
+                std::cerr << "Microbenchmark: " << path << " parsed into " << data.faces.size() << " faces (" << streamedFaces
+                    << " streamed, " << counts.faces << " counted) instead of " << faceCount << std::endl;
+                failed = true;
+            }
+
+            // Averaging face normals around every position, on one thread
+            addResult("normals");
+            std::vector<glm::vec3> vertexNormals;
+            timeStage(results.back(), [&]() { vertexNormals = std::vector<glm::vec3>(); }, [&]() {
+                vertexNormals = computeVertexNormals(data.positions, data.faces, 1);
+            });
+
+            // Expanding face corners into unique vertices and indices
+            addResult("vertices");
+            Mesh mesh;
+            timeStage(results.back(), [&]() { mesh = Mesh(); }, [&]() { buildMeshVertices(data, vertexNormals, mesh); });
+
+            file.close();
+            std::filesystem::remove(path, error);
+            for (size_t i = firstResult; i < results.size(); i++) {
+                MicrobenchResult& result = results[i];
+                auto found = baseline.find(resultKey(result.format, std::to_string(result.faces), result.stage));
+                if (found != baseline.end()) {
+                    result.hasBaseline = true;
+                    result.baselineMilliseconds = found->second.milliseconds;
+                    result.baselineAllocations = found->second.allocated.allocations;
+                    result.baselineInputDiffers = found->second.fileHash != result.fileHash;
+                }
+                printResult(result);
+            }
+        }
+    }
+
+    // One result per line, so a later run can read this file back as its baseline
+    std::string outputPath = options.benchmarkOutput.empty() ? "microbench.json" : options.benchmarkOutput;
+    std::ofstream output(outputPath);
+    if (!output.is_open()) {
+        std::cerr << "Microbenchmark: failed to write " << outputPath << std::endl;
+        return 1;
+    }
+    output << "{\n"
+        << "  \"threads\": " << threadCount << ",\n"
+        << "  \"minMilliseconds\": " << MICROBENCH_MIN_MILLISECONDS << ",\n"
+        << "  \"baseline\": " << jsonString(options.baselinePath) << ",\n"
+        << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const MicrobenchResult& result = results[i];
+        double seconds = result.milliseconds / 1000.0;
+        output << "    {\"format\": " << jsonString(result.format) << ", \"faces\": " << result.faces
+            << ", \"stage\": " << jsonString(result.stage) << ", \"fileBytes\": " << result.fileBytes
+            << ", \"fileHash\": " << jsonString(hexString(result.fileHash)) << ", \"repetitions\": " << result.repetitions
+            << ", \"milliseconds\": " << result.milliseconds
+            << ", \"megabytesPerSecond\": " << (seconds > 0.0 ? result.fileBytes / (1024.0 * 1024.0) / seconds : 0.0)
+            << ", \"facesPerSecond\": " << (seconds > 0.0 ? result.faces / seconds : 0.0)
+            << ", \"allocations\": " << result.allocated.allocations << ", \"allocatedBytes\": " << result.allocated.bytes;
+        if (result.hasBaseline) {
+            output << ", \"baselineMilliseconds\": " << result.baselineMilliseconds << ", \"baselineAllocations\": " << result.baselineAllocations;
+        }
+        output << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    output << "  ]\n"
+        << "}\n";
+
+    std::cout << "Microbenchmark: " << results.size() << " results written to " << outputPath << std::endl;
+    return failed ? 1 : 0;
+}
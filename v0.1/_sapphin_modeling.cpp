@@ -7,6 +7,7 @@
 #include <string>
 #include <vector>
 #include <array>
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <chrono>
@@ -17,6 +18,13 @@
 #include "headers/_sapphin_camera.h"
 #include "headers/_sapphin_render.h"
 #include "headers/_sapphin_modeling.h"
+#include "headers/_sapphin_objparser.h"
+#include "headers/_sapphin_meshcache.h"
+#include "headers/_sapphin_normals.h"
+#include "headers/_sapphin_meshopt.h"
+#include "headers/_sapphin_meshlets.h"
+#include "headers/_sapphin_bvh.h"
+#include "headers/_sapphin_lod.h"
 #include "lib/GLEW.win32/GLEW-lib/include/GL/glew.h"
 #include "lib/GLFW.win32/GLFW-lib/include/GLFW/glfw3.h"
 
@@ -25,182 +33,261 @@
 #include "lib/GLM.win32/GLM-lib/glm/gtc/matrix_transform.hpp"
 #include "lib/GLM.win32/GLM-lib/glm/gtc/type_ptr.hpp"
 
-void parseIndices(const std::string& str, int& v, int& t, int& n) {
-    // Initialize indices to -1 (indicating not present)
-    v = t = n = -1;
-
-    // Find positions of '/' characters
-    size_t first_slash = str.find('/');
+// Parse the file and drop faces that point at positions which don't exist
+static bool loadObjData(const std::string& filename, ObjData& data, unsigned threadCount, const std::atomic<bool>* cancel = nullptr) {
+    // Parse the file in place from a memory mapping
+    if (!parseObjFile(filename, data, threadCount, cancel)) {
+        if (!(cancel && cancel->load())) {
+            std::cerr << "Could not open the file: " << filename << std::endl;
+        }
+        return false;
+    }
 
-    if (first_slash == std::string::npos) {
-        // If no slashes, just vertex index
-        v = std::stoi(str) - 1;
-        return;
+    std::vector<ObjFace>& faces = data.faces;
+    size_t faceCount = faces.size();
+    int positionCount = static_cast<int>(data.positions.size());
+    faces.erase(std::remove_if(faces.begin(), faces.end(), [&](const ObjFace& face) {
+        for (int i = 0; i < 3; i++) {
+            if (face.posIndices[i] < 0 || face.posIndices[i] >= positionCount) return true;
+        }
+        return false;
+    }), faces.end());
+    if (faces.size() != faceCount) {
+        std::cerr << "Skipped " << (faceCount - faces.size()) << " faces with invalid vertex indices." << std::endl;
     }
+    return true;
+}
 
-    // Get vertex index (always present)
-    v = std::stoi(str.substr(0, first_slash)) - 1;
+// Texture index that is actually usable, -1 otherwise
+static inline int validTexIndex(const ObjData& data, int texIdx) {
+    return (texIdx >= 0 && texIdx < (int)data.texcoords.size()) ? texIdx : -1;
+}
 
-    size_t second_slash = str.find('/', first_slash + 1);
+// Build one output vertex from a position and an (already validated) texture index
+static Vertex makeVertex(const ObjData& data, const std::vector<glm::vec3>& vertexNormals, int posIdx, int texIdx) {
+    Vertex vertex;
 
-    if (second_slash == std::string::npos) {
-        // If only one slash, we have vertex/texture
-        if (str.length() > first_slash + 1) {
-            t = std::stoi(str.substr(first_slash + 1)) - 1;
-        }
-        return;
-    }
+    // Position and color
+    vertex.x = data.positions[posIdx].x;
+    vertex.y = data.positions[posIdx].y;
+    vertex.z = data.positions[posIdx].z;
+    const glm::vec4& color = data.colors.empty() ? OBJ_DEFAULT_COLOR : data.colors[posIdx];
+    vertex.r = color.r;
+    vertex.g = color.g;
+    vertex.b = color.b;
+    vertex.a = color.a;
 
-    // We have vertex/texture/normal
-    // Check for texture coordinate
-    if (second_slash > first_slash + 1) {
-        // There's something between the slashes
-        t = std::stoi(str.substr(first_slash + 1, second_slash - first_slash - 1)) - 1;
-    }
+    // Use computed normal
+    vertex.nx = vertexNormals[posIdx].x;
+    vertex.ny = vertexNormals[posIdx].y;
+    vertex.nz = vertexNormals[posIdx].z;
 
-    // Check for normal
-    if (str.length() > second_slash + 1) {
-        n = std::stoi(str.substr(second_slash + 1)) - 1;
+    // Texture coordinates
+    if (texIdx >= 0) {
+        vertex.u = data.texcoords[texIdx].x;
+        vertex.v = data.texcoords[texIdx].y;
+    } else {
+        vertex.u = 0.0f;
+        vertex.v = 0.0f;
     }
+    return vertex;
 }
 
 std::vector<Vertex> loadModel(const std::string& filename) {
     std::vector<Vertex> vertices;
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        std::cerr << "Could not open the file: " << filename << std::endl;
+
+    ObjData data;
+    if (!loadObjData(filename, data, 0)) {
         return vertices;
     }
+    std::vector<glm::vec3> vertexNormals = computeVertexNormals(data.positions, data.faces);
 
-    // Data containers
-    std::vector<glm::vec3> positions;
-    std::vector<glm::vec3> fileNormals;
-    std::vector<glm::vec2> texcoords;
-    std::vector<glm::vec4> colors;
-    
-    // Temporary face storage
-    struct FaceData { 
-        int posIndices[3]; 
-        int texIndices[3]; 
-        int normIndices[3]; 
-    };
-    std::vector<FaceData> faces;
-
-    std::string line;
-    while (std::getline(file, line)) {
-        std::istringstream iss(line);
-        std::string type;
-        iss >> type;
-
-        if (type == "v") {
-            // Vertex position
-            glm::vec3 pos;
-            iss >> pos.x >> pos.y >> pos.z;
-            
-            // Vertex color
-            glm::vec4 color(0.7f, 0.7f, 0.7f, 1.0f);
-            float r, g, b;
-            if (iss >> r >> g >> b) {
-                color.r = r;
-                color.g = g;
-                color.b = b;
-                float a;
-                if (iss >> a) color.a = a;
-            }
-            positions.push_back(pos);
-            colors.push_back(color);
-        }
-        else if (type == "vn") {
-            // Vertex normal (from file)
-            glm::vec3 normal;
-            iss >> normal.x >> normal.y >> normal.z;
-            fileNormals.push_back(normal);
-        }
-        else if (type == "vt") {
-            // Texture coordinate
-            glm::vec2 tex;
-            iss >> tex.x >> tex.y;
-            texcoords.push_back(tex);
-        }
-        else if (type == "f") {
-            // Face definition
-            std::string v1, v2, v3;
-            iss >> v1 >> v2 >> v3;
-            
-            FaceData face;
-            parseIndices(v1, face.posIndices[0], face.texIndices[0], face.normIndices[0]);
-            parseIndices(v2, face.posIndices[1], face.texIndices[1], face.normIndices[1]);
-            parseIndices(v3, face.posIndices[2], face.texIndices[2], face.normIndices[2]);
-            
-            faces.push_back(face);
+    // Create vertices using computed normals
+    vertices.reserve(data.faces.size() * 3);
+    for (const auto& face : data.faces) {
+        for (int i = 0; i < 3; i++) {
+            vertices.push_back(makeVertex(data, vertexNormals, face.posIndices[i], validTexIndex(data, face.texIndices[i])));
         }
     }
 
-    // Compute vertex normals through averaging
-    std::vector<glm::vec3> vertexNormals(positions.size(), glm::vec3(0.0f));
-    if (!faces.empty()) {
-        for (const auto& face : faces) {
-            glm::vec3 v1 = positions[face.posIndices[0]];
-            glm::vec3 v2 = positions[face.posIndices[1]];
-            glm::vec3 v3 = positions[face.posIndices[2]];
-            
-            glm::vec3 edge1 = v2 - v1;
-            glm::vec3 edge2 = v3 - v1;
-            glm::vec3 faceNormal = glm::normalize(glm::cross(edge1, edge2));
-            
-            vertexNormals[face.posIndices[0]] += faceNormal;
-            vertexNormals[face.posIndices[1]] += faceNormal;
-            vertexNormals[face.posIndices[2]] += faceNormal;
-        }
-        
-        for (auto& normal : vertexNormals) {
-            if (glm::length(normal) > 0.0f) {
-                normal = glm::normalize(normal);
-            }
-        }
+    // Debug output
+    std::cout << "Model loading statistics:" << std::endl;
+    std::cout << "Vertices loaded: " << vertices.size() << std::endl;
+    std::cout << "Normals computed: " << vertexNormals.size() << std::endl;
+    std::cout << "UV coords loaded: " << data.texcoords.size() << std::endl;
+
+    return vertices;
+}
+
+// Bytes the GPU needs for a mesh's vertex and index buffers
+size_t meshGpuBytes(const Mesh& mesh) {
+    size_t indexSize = mesh.vertices.size() <= 0xFFFF ? sizeof(uint16_t) : sizeof(uint32_t);
+    return mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * indexSize;
+}
+
+// Compute the axis-aligned bounding box of a mesh
+void computeMeshBounds(Mesh& mesh) {
+    mesh.boundsMin = glm::vec3(0.0f);
+    mesh.boundsMax = glm::vec3(0.0f);
+    if (mesh.vertices.empty()) return;
+
+    mesh.boundsMin = mesh.boundsMax = glm::vec3(mesh.vertices[0].x, mesh.vertices[0].y, mesh.vertices[0].z);
+    for (const Vertex& vertex : mesh.vertices) {
+        glm::vec3 p(vertex.x, vertex.y, vertex.z);
+        mesh.boundsMin = glm::min(mesh.boundsMin, p);
+        mesh.boundsMax = glm::max(mesh.boundsMax, p);
     }
+}
 
-    // Create vertices using computed normals
-    for (const auto& face : faces) {
+// Output vertices are unique (position, texcoord) pairs, since the normal and color only depend on the position.
+// Vertices sharing a position are chained so that the common case (one texcoord per position) is a single compare.
+void buildMeshVertices(const ObjData& data, const std::vector<glm::vec3>& vertexNormals, Mesh& mesh) {
+    std::vector<int> firstVertexOfPosition(data.positions.size(), -1);
+    std::vector<int> nextVertexOfPosition;
+    std::vector<int> vertexTexIndex;
+    nextVertexOfPosition.reserve(data.positions.size());
+    vertexTexIndex.reserve(data.positions.size());
+    mesh.vertices.reserve(data.positions.size());
+    mesh.indices.reserve(data.faces.size() * 3);
+
+    for (const auto& face : data.faces) {
         for (int i = 0; i < 3; i++) {
-            Vertex vertex;
             int posIdx = face.posIndices[i];
-            
-            // Position and color
-            vertex.x = positions[posIdx].x;
-            vertex.y = positions[posIdx].y;
-            vertex.z = positions[posIdx].z;
-            vertex.r = colors[posIdx].r;
-            vertex.g = colors[posIdx].g;
-            vertex.b = colors[posIdx].b;
-            vertex.a = colors[posIdx].a;
-            
-            // Use computed normal
-            vertex.nx = vertexNormals[posIdx].x;
-            vertex.ny = vertexNormals[posIdx].y;
-            vertex.nz = vertexNormals[posIdx].z;
-            
-            // Texture coordinates
-            if (face.texIndices[i] >= 0 && face.texIndices[i] < texcoords.size()) {
-                vertex.u = texcoords[face.texIndices[i]].x;
-                vertex.v = texcoords[face.texIndices[i]].y;
-            } else {
-                vertex.u = 0.0f;
-                vertex.v = 0.0f;
+            int texIdx = validTexIndex(data, face.texIndices[i]);
+
+            int vertexIdx = firstVertexOfPosition[posIdx];
+            while (vertexIdx >= 0 && vertexTexIndex[vertexIdx] != texIdx) {
+                vertexIdx = nextVertexOfPosition[vertexIdx];
             }
-            
-            vertices.push_back(vertex);
+
+            if (vertexIdx < 0) {
+                vertexIdx = static_cast<int>(mesh.vertices.size());
+                mesh.vertices.push_back(makeVertex(data, vertexNormals, posIdx, texIdx));
+                vertexTexIndex.push_back(texIdx);
+                nextVertexOfPosition.push_back(firstVertexOfPosition[posIdx]);
+                firstVertexOfPosition[posIdx] = vertexIdx;
+            }
+            mesh.indices.push_back(static_cast<uint32_t>(vertexIdx));
         }
     }
+}
+
+Mesh loadMesh(const std::string& filename, unsigned threadCount, const std::atomic<bool>* cancel) {
+    Mesh mesh;
+
+    ObjData data;
+    if (!loadObjData(filename, data, threadCount, cancel)) {
+        return mesh;
+    }
+    std::vector<glm::vec3> vertexNormals = computeVertexNormals(data.positions, data.faces, threadCount);
+    if (cancel && cancel->load()) {
+        return mesh;
+    }
+
+    buildMeshVertices(data, vertexNormals, mesh);
+    computeMeshBounds(mesh);
 
     // Debug output
+    size_t soupBytes = mesh.indices.size() * sizeof(Vertex);
+    size_t indexedBytes = meshGpuBytes(mesh);
     std::cout << "Model loading statistics:" << std::endl;
-    std::cout << "Vertices loaded: " << vertices.size() << std::endl;
+    std::cout << "Unique vertices: " << mesh.vertices.size() << " (" << mesh.indices.size() << " indices)" << std::endl;
     std::cout << "Normals computed: " << vertexNormals.size() << std::endl;
-    std::cout << "UV coords loaded: " << texcoords.size() << std::endl;
+    std::cout << "UV coords loaded: " << data.texcoords.size() << std::endl;
+    if (soupBytes > 0) {
+        std::cout << "Mesh memory: " << indexedBytes / 1024 << " KB indexed vs " << soupBytes / 1024
+            << " KB as triangle soup (" << (100 * (soupBytes - std::min(soupBytes, indexedBytes)) / soupBytes) << "% saved)" << std::endl;
+    }
 
-    file.close();
-    return vertices;
+    return mesh;
+}
+
+const char* meshLoadStageName(int stage) {
+    switch (stage) {
+    case LOAD_READING_CACHE: return "Reading cache";
+    case LOAD_PARSING: return "Parsing";
+    case LOAD_OPTIMIZING: return "Optimizing";
+    case LOAD_MESHLETS: return "Building meshlets";
+    case LOAD_BVH: return "Building BVH";
+    case LOAD_LODS: return "Simplifying";
+    case LOAD_WRITING_CACHE: return "Writing cache";
+    default: return "Finished";
+    }
+}
+
+static std::atomic<size_t> memoryBudget{ 0 };
+
+void setLoadMemoryBudget(size_t bytes) {
+    memoryBudget = bytes;
+}
+
+size_t loadMemoryBudget() {
+    return memoryBudget;
+}
+
+Mesh processMesh(const std::string& filename, uint32_t processingFlags, std::atomic<int>* stage, unsigned threadCount,
+    LoadMemoryStats* memory, const std::atomic<bool>* cancel) {
+    auto enterStage = [stage](MeshLoadStage next) {
+        if (stage) stage->store(next);
+    };
+    // A cancelled load drops what it has at the next stage
+    auto proceed = [cancel](const Mesh& mesh) {
+        return !mesh.indices.empty() && !(cancel && cancel->load());
+    };
+
+    enterStage(LOAD_PARSING);
+    size_t budget = loadMemoryBudget();
+    Mesh mesh = budget > 0 ? loadMeshBounded(filename, budget, memory, threadCount, cancel) : loadMesh(filename, threadCount, cancel);
+    if ((processingFlags & MESH_OPTIMIZE) && proceed(mesh)) {
+        enterStage(LOAD_OPTIMIZING);
+        optimizeMesh(mesh);
+    }
+    if ((processingFlags & MESH_MESHLETS) && proceed(mesh)) {
+        enterStage(LOAD_MESHLETS);
+        buildMeshlets(mesh);
+    }
+    if ((processingFlags & MESH_BVH) && proceed(mesh)) {
+        enterStage(LOAD_BVH);
+        buildMeshBvh(mesh);
+    }
+    if ((processingFlags & MESH_LODS) && proceed(mesh)) {
+        enterStage(LOAD_LODS);
+        buildMeshLods(mesh);
+    }
+    if (cancel && cancel->load()) {
+        return Mesh();
+    }
+    return mesh;
+}
+
+// Load a mesh through its .sapmesh cache and run the requested processing stages.
+// The cache is (re)written whenever the .obj had to be parsed.
+Mesh loadMeshCached(const std::string& filename, uint32_t processingFlags, std::atomic<int>* stage, const std::atomic<bool>* cancel) {
+    Mesh mesh;
+    const uint32_t flags = processingFlags;
+    auto enterStage = [stage](MeshLoadStage next) {
+        if (stage) stage->store(next);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    enterStage(LOAD_READING_CACHE);
+    if (readMeshCache(filename, flags, mesh)) {
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "Loaded " << mesh.vertices.size() << " vertices and " << mesh.indices.size()
+            << " indices from " << meshCachePath(filename) << " in " << elapsed.count() << " ms" << std::endl;
+        enterStage(LOAD_FINISHED);
+        return mesh;
+    }
+
+    mesh = processMesh(filename, processingFlags, stage, 0, nullptr, cancel);
+    if (!mesh.indices.empty()) {
+        enterStage(LOAD_WRITING_CACHE);
+        if (!writeMeshCache(filename, flags, mesh)) {
+            std::cerr << "Could not write the mesh cache: " << meshCachePath(filename) << std::endl;
+        }
+    }
+    enterStage(LOAD_FINISHED);
+    return mesh;
 }
 
 // Function to render the model (basic)
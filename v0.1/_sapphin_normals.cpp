@@ -0,0 +1,244 @@
+// _sapphin_normals.cpp
+// This computes smooth vertex normals with SIMD face normals and a race-free parallel gather.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+
+#include <cmath>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SAPPHIN_NORMALS_SSE2
+#endif
+
+// Headers
+#include "headers/_sapphin_utils.h"
+#include "headers/_sapphin_normals.h"
+#include "headers/_sapphin_objparser.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+
+// Faces and positions are processed in blocks of this many elements per task
+static const size_t NORMAL_BLOCK_SIZE = 1 << 16;
+
+// Building the face adjacency costs about five serial scatters, so below this many threads a scatter is faster
+static const unsigned MIN_GATHER_THREADS = 8;
+
+// The SIMD kernels read posIndices of consecutive faces with a fixed stride
+static_assert(sizeof(ObjFace) == 9 * sizeof(int), "ObjFace must be nine tightly packed ints");
+static const int FACE_STRIDE = 9;
+
+// Positions split into one array per axis, so a SIMD lane can fetch each component with one gather
+struct PositionsSoA {
+    std::vector<float> x, y, z;
+};
+
+// Face normals of [first, last), in the same operation order as glm::normalize(glm::cross(e1, e2))
+static void faceNormalsScalar(const PositionsSoA& p, const ObjFace* faces, size_t first, size_t last, float* nx, float* ny, float* nz) {
+    for (size_t i = first; i < last; i++) {
+        const int* index = faces[i].posIndices;
+        float e1x = p.x[index[1]] - p.x[index[0]], e1y = p.y[index[1]] - p.y[index[0]], e1z = p.z[index[1]] - p.z[index[0]];
+        float e2x = p.x[index[2]] - p.x[index[0]], e2y = p.y[index[2]] - p.y[index[0]], e2z = p.z[index[2]] - p.z[index[0]];
+        float cx = e1y * e2z - e2y * e1z;
+        float cy = e1z * e2x - e2z * e1x;
+        float cz = e1x * e2y - e2x * e1y;
+        float inverseLength = 1.0f / std::sqrt(cx * cx + cy * cy + cz * cz);
+        nx[i] = cx * inverseLength;
+        ny[i] = cy * inverseLength;
+        nz[i] = cz * inverseLength;
+    }
+}
+
+#if defined(__AVX2__)
+// Eight faces per step, positions fetched with hardware gathers
+static void faceNormalsSIMD(const PositionsSoA& p, const ObjFace* faces, size_t first, size_t last, float* nx, float* ny, float* nz) {
+    const __m256i stride = _mm256_setr_epi32(0, FACE_STRIDE, 2 * FACE_STRIDE, 3 * FACE_STRIDE,
+        4 * FACE_STRIDE, 5 * FACE_STRIDE, 6 * FACE_STRIDE, 7 * FACE_STRIDE);
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    size_t i = first;
+    for (; i + 8 <= last; i += 8) {
+        const int* base = faces[i].posIndices;
+        __m256i i0 = _mm256_i32gather_epi32(base + 0, stride, 4);
+        __m256i i1 = _mm256_i32gather_epi32(base + 1, stride, 4);
+        __m256i i2 = _mm256_i32gather_epi32(base + 2, stride, 4);
+
+        __m256 x0 = _mm256_i32gather_ps(p.x.data(), i0, 4);
+        __m256 y0 = _mm256_i32gather_ps(p.y.data(), i0, 4);
+        __m256 z0 = _mm256_i32gather_ps(p.z.data(), i0, 4);
+        __m256 e1x = _mm256_sub_ps(_mm256_i32gather_ps(p.x.data(), i1, 4), x0);
+        __m256 e1y = _mm256_sub_ps(_mm256_i32gather_ps(p.y.data(), i1, 4), y0);
+        __m256 e1z = _mm256_sub_ps(_mm256_i32gather_ps(p.z.data(), i1, 4), z0);
+        __m256 e2x = _mm256_sub_ps(_mm256_i32gather_ps(p.x.data(), i2, 4), x0);
+        __m256 e2y = _mm256_sub_ps(_mm256_i32gather_ps(p.y.data(), i2, 4), y0);
+        __m256 e2z = _mm256_sub_ps(_mm256_i32gather_ps(p.z.data(), i2, 4), z0);
+
+        __m256 cx = _mm256_sub_ps(_mm256_mul_ps(e1y, e2z), _mm256_mul_ps(e2y, e1z));
+        __m256 cy = _mm256_sub_ps(_mm256_mul_ps(e1z, e2x), _mm256_mul_ps(e2z, e1x));
+        __m256 cz = _mm256_sub_ps(_mm256_mul_ps(e1x, e2y), _mm256_mul_ps(e2x, e1y));
+        __m256 lengthSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, cx), _mm256_mul_ps(cy, cy)), _mm256_mul_ps(cz, cz));
+        __m256 inverseLength = _mm256_div_ps(one, _mm256_sqrt_ps(lengthSquared));
+
+        _mm256_storeu_ps(nx + i, _mm256_mul_ps(cx, inverseLength));
+        _mm256_storeu_ps(ny + i, _mm256_mul_ps(cy, inverseLength));
+        _mm256_storeu_ps(nz + i, _mm256_mul_ps(cz, inverseLength));
+    }
+    faceNormalsScalar(p, faces, i, last, nx, ny, nz);
+}
+#elif defined(SAPPHIN_NORMALS_SSE2)
+// Four faces per step (SSE2 has no gathers, so lanes are filled with scalar loads)
+static inline __m128 gatherLanes(const std::vector<float>& values, const int* index) {
+    return _mm_setr_ps(values[index[0]], values[index[FACE_STRIDE]], values[index[2 * FACE_STRIDE]], values[index[3 * FACE_STRIDE]]);
+}
+
+static void faceNormalsSIMD(const PositionsSoA& p, const ObjFace* faces, size_t first, size_t last, float* nx, float* ny, float* nz) {
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    size_t i = first;
+    for (; i + 4 <= last; i += 4) {
+        const int* base = faces[i].posIndices;
+        __m128 x0 = gatherLanes(p.x, base), y0 = gatherLanes(p.y, base), z0 = gatherLanes(p.z, base);
+        __m128 e1x = _mm_sub_ps(gatherLanes(p.x, base + 1), x0);
+        __m128 e1y = _mm_sub_ps(gatherLanes(p.y, base + 1), y0);
+        __m128 e1z = _mm_sub_ps(gatherLanes(p.z, base + 1), z0);
+        __m128 e2x = _mm_sub_ps(gatherLanes(p.x, base + 2), x0);
+        __m128 e2y = _mm_sub_ps(gatherLanes(p.y, base + 2), y0);
+        __m128 e2z = _mm_sub_ps(gatherLanes(p.z, base + 2), z0);
+
+        __m128 cx = _mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e2y, e1z));
+        __m128 cy = _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e2z, e1x));
+        __m128 cz = _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e2x, e1y));
+        __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(cy, cy)), _mm_mul_ps(cz, cz));
+        __m128 inverseLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSquared));
+
+        _mm_storeu_ps(nx + i, _mm_mul_ps(cx, inverseLength));
+        _mm_storeu_ps(ny + i, _mm_mul_ps(cy, inverseLength));
+        _mm_storeu_ps(nz + i, _mm_mul_ps(cz, inverseLength));
+    }
+    faceNormalsScalar(p, faces, i, last, nx, ny, nz);
+}
+#else
+static void faceNormalsSIMD(const PositionsSoA& p, const ObjFace* faces, size_t first, size_t last, float* nx, float* ny, float* nz) {
+    faceNormalsScalar(p, faces, first, last, nx, ny, nz);
+}
+#endif
+
+static inline size_t blockCount(size_t count) {
+    return (count + NORMAL_BLOCK_SIZE - 1) / NORMAL_BLOCK_SIZE;
+}
+
+std::vector<glm::vec3> computeVertexNormals(const std::vector<glm::vec3>& positions, const std::vector<ObjFace>& faces, unsigned threadCount) {
+    threadCount = resolveThreadCount(threadCount);
+    const size_t vertexCount = positions.size();
+    const size_t faceCount = faces.size();
+    std::vector<glm::vec3> vertexNormals(vertexCount, glm::vec3(0.0f));
+    if (faceCount == 0) {
+        return vertexNormals;
+    }
+
+    // Split positions per axis
+    PositionsSoA soa;
+    soa.x.resize(vertexCount);
+    soa.y.resize(vertexCount);
+    soa.z.resize(vertexCount);
+    parallelFor(blockCount(vertexCount), threadCount, [&](size_t block) {
+        size_t last = std::min(vertexCount, (block + 1) * NORMAL_BLOCK_SIZE);
+        for (size_t i = block * NORMAL_BLOCK_SIZE; i < last; i++) {
+            soa.x[i] = positions[i].x;
+            soa.y[i] = positions[i].y;
+            soa.z[i] = positions[i].z;
+        }
+    });
+
+    // Unit normal of every face
+    std::vector<float> faceX(faceCount), faceY(faceCount), faceZ(faceCount);
+    parallelFor(blockCount(faceCount), threadCount, [&](size_t block) {
+        size_t first = block * NORMAL_BLOCK_SIZE;
+        size_t last = std::min(faceCount, first + NORMAL_BLOCK_SIZE);
+        faceNormalsSIMD(soa, faces.data(), first, last, faceX.data(), faceY.data(), faceZ.data());
+    });
+    soa = PositionsSoA();
+
+    if (threadCount < MIN_GATHER_THREADS) {
+        // Scatter the face normals in file order
+        for (size_t f = 0; f < faceCount; f++) {
+            glm::vec3 faceNormal(faceX[f], faceY[f], faceZ[f]);
+            vertexNormals[faces[f].posIndices[0]] += faceNormal;
+            vertexNormals[faces[f].posIndices[1]] += faceNormal;
+            vertexNormals[faces[f].posIndices[2]] += faceNormal;
+        }
+        parallelFor(blockCount(vertexCount), threadCount, [&](size_t block) {
+            size_t last = std::min(vertexCount, (block + 1) * NORMAL_BLOCK_SIZE);
+            for (size_t v = block * NORMAL_BLOCK_SIZE; v < last; v++) {
+                if (glm::length(vertexNormals[v]) > 0.0f) {
+                    vertexNormals[v] = glm::normalize(vertexNormals[v]);
+                }
+            }
+        });
+        return vertexNormals;
+    }
+
+    // Faces around every position (compressed rows). Counting is the only step that needs atomics.
+    std::unique_ptr<std::atomic<uint32_t>[]> cursors(new std::atomic<uint32_t>[vertexCount]);
+    parallelFor(blockCount(vertexCount), threadCount, [&](size_t block) {
+        size_t last = std::min(vertexCount, (block + 1) * NORMAL_BLOCK_SIZE);
+        for (size_t i = block * NORMAL_BLOCK_SIZE; i < last; i++) {
+            cursors[i].store(0, std::memory_order_relaxed);
+        }
+    });
+    parallelFor(blockCount(faceCount), threadCount, [&](size_t block) {
+        size_t last = std::min(faceCount, (block + 1) * NORMAL_BLOCK_SIZE);
+        for (size_t f = block * NORMAL_BLOCK_SIZE; f < last; f++) {
+            for (int corner = 0; corner < 3; corner++) {
+                cursors[faces[f].posIndices[corner]].fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    });
+
+    std::vector<size_t> rowStart(vertexCount + 1);
+    rowStart[0] = 0;
+    for (size_t i = 0; i < vertexCount; i++) {
+        rowStart[i + 1] = rowStart[i] + cursors[i].load(std::memory_order_relaxed);
+        cursors[i].store(0, std::memory_order_relaxed);
+    }
+
+    std::vector<uint32_t> vertexFaces(rowStart[vertexCount]);
+    parallelFor(blockCount(faceCount), threadCount, [&](size_t block) {
+        size_t last = std::min(faceCount, (block + 1) * NORMAL_BLOCK_SIZE);
+        for (size_t f = block * NORMAL_BLOCK_SIZE; f < last; f++) {
+            for (int corner = 0; corner < 3; corner++) {
+                int v = faces[f].posIndices[corner];
+                uint32_t slot = cursors[v].fetch_add(1, std::memory_order_relaxed);
+                vertexFaces[rowStart[v] + slot] = static_cast<uint32_t>(f);
+            }
+        }
+    });
+    cursors.reset();
+
+    // Gather: every position sums its own faces, so no two threads ever write the same normal.
+    // Rows are sorted first so the faces are added in file order, exactly like a serial scatter.
+    parallelFor(blockCount(vertexCount), threadCount, [&](size_t block) {
+        size_t last = std::min(vertexCount, (block + 1) * NORMAL_BLOCK_SIZE);
+        for (size_t v = block * NORMAL_BLOCK_SIZE; v < last; v++) {
+            uint32_t* rowBegin = vertexFaces.data() + rowStart[v];
+            uint32_t* rowEnd = vertexFaces.data() + rowStart[v + 1];
+            std::sort(rowBegin, rowEnd);
+
+            glm::vec3 normal(0.0f);
+            for (const uint32_t* f = rowBegin; f != rowEnd; ++f) {
+                normal += glm::vec3(faceX[*f], faceY[*f], faceZ[*f]);
+            }
+            if (glm::length(normal) > 0.0f) {
+                normal = glm::normalize(normal);
+            }
+            vertexNormals[v] = normal;
+        }
+    });
+
+    return vertexNormals;
+}
@@ -0,0 +1,428 @@
+// _sapphin_objparser.cpp
+// This parses .obj files straight out of a memory mapping, without per-line string copies.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <charconv>
+#include <algorithm>
+
+// Headers
+#include "headers/_sapphin_utils.h"
+#include "headers/_sapphin_objparser.h"
+#include "headers/_sapphin_types.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+
+// Same set of characters that std::istream treats as separators inside a line
+static inline bool isLineSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static inline void skipSpaces(const char*& p, const char* end) {
+    while (p < end && isLineSpace(*p)) ++p;
+}
+
+// Parse one float like "iss >> value" would: skip spaces, read a number, stop right after it
+static inline bool parseFloat(const char*& p, const char* end, float& value) {
+    skipSpaces(p, end);
+    const char* start = p;
+    if (start < end && *start == '+') ++start;  // from_chars does not accept a leading '+'
+    auto result = std::from_chars(start, end, value);
+    if (result.ec != std::errc()) return false;
+    p = result.ptr;
+    return true;
+}
+
+// Parse a whole-token integer like std::stoi would (leading sign allowed, trailing garbage ignored)
+static inline bool parseInt(const char* p, const char* end, int& value) {
+    if (p < end && *p == '+') ++p;
+    return std::from_chars(p, end, value).ec == std::errc();
+}
+
+// Turn a 1-based (or negative, relative) .obj index into a 0-based one. 0 or garbage gives -1.
+// Relative indices set 'relative' so a chunk parsed in parallel can be shifted to global offsets later.
+static inline int resolveIndex(int index, size_t count, bool& relative) {
+    if (index > 0) return index - 1;
+    if (index < 0) {
+        relative = true;
+        return static_cast<int>(count) + index;
+    }
+    return -1;
+}
+
+// Faces of a chunk that used relative indices. Bit (corner * 3 + attribute) marks which slots to shift.
+struct RelativeFixup {
+    size_t face;
+    uint16_t mask;
+};
+
+// Records before the one being parsed; relative indices count back from these
+struct RecordCounts {
+    size_t positions, texcoords, fileNormals;
+};
+
+// Parse a single face corner ("v", "v/t", "v//n" or "v/t/n"). Returns false if there is no vertex index.
+static bool parseFaceCorner(const char* p, const char* end, const RecordCounts& counts, int& v, int& t, int& n, unsigned& relativeMask) {
+    v = t = n = -1;
+    bool relative[3] = { false, false, false };
+
+    const char* firstSlash = static_cast<const char*>(memchr(p, '/', end - p));
+    int value;
+    if (!parseInt(p, firstSlash ? firstSlash : end, value)) return false;
+    v = resolveIndex(value, counts.positions, relative[0]);
+
+    if (firstSlash) {
+        const char* afterFirst = firstSlash + 1;
+        const char* secondSlash = static_cast<const char*>(memchr(afterFirst, '/', end - afterFirst));
+        if (!secondSlash) {
+            // Only one slash, we have vertex/texture
+            if (afterFirst < end && parseInt(afterFirst, end, value)) {
+                t = resolveIndex(value, counts.texcoords, relative[1]);
+            }
+        }
+        else {
+            // Check for texture coordinate between the slashes
+            if (secondSlash > afterFirst && parseInt(afterFirst, secondSlash, value)) {
+                t = resolveIndex(value, counts.texcoords, relative[1]);
+            }
+
+            // Check for normal
+            if (secondSlash + 1 < end && parseInt(secondSlash + 1, end, value)) {
+                n = resolveIndex(value, counts.fileNormals, relative[2]);
+            }
+        }
+    }
+
+    relativeMask = (relative[0] ? 1u : 0u) | (relative[1] ? 2u : 0u) | (relative[2] ? 4u : 0u);
+    return true;
+}
+
+static void parseVertexRecord(const char* p, const char* end, ObjData& data) {
+    // Vertex position (missing components read as 0)
+    glm::vec3 pos(0.0f);
+    parseFloat(p, end, pos.x) && parseFloat(p, end, pos.y) && parseFloat(p, end, pos.z);
+
+    // Optional vertex color, only used when all of r, g and b are present. Colors are only stored once
+    // the file has one; the positions before it get the default.
+    float r, g, b;
+    if (parseFloat(p, end, r) && parseFloat(p, end, g) && parseFloat(p, end, b)) {
+        glm::vec4 color(r, g, b, OBJ_DEFAULT_COLOR.a);
+        float a;
+        if (parseFloat(p, end, a)) color.a = a;
+        data.colors.resize(data.positions.size(), OBJ_DEFAULT_COLOR);
+        data.colors.push_back(color);
+    }
+    else if (!data.colors.empty()) {
+        data.colors.push_back(OBJ_DEFAULT_COLOR);
+    }
+    data.positions.push_back(pos);
+}
+
+// Parse the corners of an 'f' record. Returns false for a malformed one.
+static bool parseFaceCorners(const char* p, const char* end, const RecordCounts& counts, ObjFace& face, unsigned& faceMask) {
+    // Only the first three corners are used, like the original stream based loader
+    faceMask = 0;
+    for (int i = 0; i < 3; i++) {
+        skipSpaces(p, end);
+        const char* tokenStart = p;
+        while (p < end && !isLineSpace(*p)) ++p;
+        if (tokenStart == p) return false;  // Fewer than three corners
+        unsigned cornerMask;
+        if (!parseFaceCorner(tokenStart, p, counts, face.posIndices[i], face.texIndices[i], face.normIndices[i], cornerMask)) {
+            return false;
+        }
+        faceMask |= cornerMask << (i * 3);
+    }
+    return true;
+}
+
+static void parseFaceRecord(const char* p, const char* end, ObjData& data, std::vector<RelativeFixup>* fixups) {
+    ObjFace face;
+    unsigned faceMask;
+    RecordCounts counts = { data.positions.size(), data.texcoords.size(), data.fileNormals.size() };
+    if (!parseFaceCorners(p, end, counts, face, faceMask)) {
+        return;
+    }
+    if (faceMask && fixups) {
+        fixups->push_back({ data.faces.size(), static_cast<uint16_t>(faceMask) });
+    }
+    data.faces.push_back(face);
+}
+
+enum ObjRecordType {
+    RECORD_OTHER,
+    RECORD_POSITION,
+    RECORD_TEXCOORD,
+    RECORD_NORMAL,
+    RECORD_FACE,
+};
+
+// Type of the record on the line starting at p; p is left right after the type token
+static inline ObjRecordType recordType(const char*& p, const char* lineEnd) {
+    skipSpaces(p, lineEnd);
+    const char* typeStart = p;
+    while (p < lineEnd && !isLineSpace(*p)) ++p;
+    size_t typeLength = p - typeStart;
+
+    if (typeLength == 1 && typeStart[0] == 'v') return RECORD_POSITION;
+    if (typeLength == 1 && typeStart[0] == 'f') return RECORD_FACE;
+    if (typeLength == 2 && typeStart[0] == 'v' && typeStart[1] == 't') return RECORD_TEXCOORD;
+    if (typeLength == 2 && typeStart[0] == 'v' && typeStart[1] == 'n') return RECORD_NORMAL;
+    return RECORD_OTHER;
+}
+
+static inline const char* findLineEnd(const char* lineStart, const char* end) {
+    const char* lineEnd = static_cast<const char*>(memchr(lineStart, '\n', end - lineStart));
+    return lineEnd ? lineEnd : end;
+}
+
+static void parseTexcoordRecord(const char* p, const char* end, ObjData& data) {
+    glm::vec2 tex(0.0f);
+    parseFloat(p, end, tex.x) && parseFloat(p, end, tex.y);
+    data.texcoords.push_back(tex);
+}
+
+// Lines parsed between two looks at the cancel flag
+static const size_t CANCEL_CHECK_LINES = 1 << 16;
+
+static void parseObjRecords(const char* begin, const char* end, ObjData& data, std::vector<RelativeFixup>* fixups,
+    const std::atomic<bool>* cancel = nullptr) {
+    const char* lineStart = begin;
+    size_t lines = 0;
+    while (lineStart < end) {
+        if (cancel && ++lines % CANCEL_CHECK_LINES == 0 && cancel->load(std::memory_order_relaxed)) {
+            return;
+        }
+        const char* lineEnd = findLineEnd(lineStart, end);
+
+        // Record type is the first token of the line
+        const char* p = lineStart;
+        switch (recordType(p, lineEnd)) {
+        case RECORD_POSITION:
+            parseVertexRecord(p, lineEnd, data);
+            break;
+        case RECORD_NORMAL: {
+            // Vertex normal (from file)
+            glm::vec3 normal(0.0f);
+            parseFloat(p, lineEnd, normal.x) && parseFloat(p, lineEnd, normal.y) && parseFloat(p, lineEnd, normal.z);
+            data.fileNormals.push_back(normal);
+            break;
+        }
+        case RECORD_TEXCOORD:
+            parseTexcoordRecord(p, lineEnd, data);
+            break;
+        case RECORD_FACE:
+            parseFaceRecord(p, lineEnd, data, fixups);
+            break;
+        default:
+            break;
+        }
+
+        lineStart = lineEnd + 1;
+    }
+}
+
+void parseObjBuffer(const char* begin, const char* end, ObjData& data) {
+    parseObjRecords(begin, end, data, nullptr);
+}
+
+// Chunks smaller than this are not worth a thread
+static const size_t MIN_CHUNK_BYTES = 1 << 20;
+
+// Boundaries of chunkCount pieces of [begin, end) of about the same size, each starting on a new line
+static std::vector<const char*> splitLines(const char* begin, const char* end, size_t chunkCount) {
+    std::vector<const char*> bounds(chunkCount + 1);
+    bounds[0] = begin;
+    bounds[chunkCount] = end;
+    for (size_t i = 1; i < chunkCount; i++) {
+        const char* p = std::max(begin + (end - begin) * i / chunkCount, bounds[i - 1]);
+        const char* newline = static_cast<const char*>(memchr(p, '\n', end - p));
+        bounds[i] = newline ? newline + 1 : end;
+    }
+    return bounds;
+}
+
+// Copy all of src into dst starting at 'offset'
+template <typename T>
+static void copyInto(std::vector<T>& dst, size_t offset, const std::vector<T>& src) {
+    if (!src.empty()) {
+        memcpy(dst.data() + offset, src.data(), src.size() * sizeof(T));
+    }
+}
+
+void parseObjBufferParallel(const char* begin, const char* end, ObjData& data, unsigned threadCount, const std::atomic<bool>* cancel) {
+    threadCount = resolveThreadCount(threadCount);
+
+    // Oversplit a little so threads that finish early can pick up more work
+    size_t size = end - begin;
+    size_t chunkCount = std::min<size_t>(size_t(threadCount) * 4, size / MIN_CHUNK_BYTES);
+    if (threadCount == 1 || chunkCount < 2) {
+        parseObjRecords(begin, end, data, nullptr, cancel);
+        return;
+    }
+
+    // Split on line boundaries so no record is cut in half
+    std::vector<const char*> bounds = splitLines(begin, end, chunkCount);
+
+    // Parse every chunk into its own buffers
+    struct ObjChunk {
+        ObjData data;
+        std::vector<RelativeFixup> fixups;
+    };
+    std::vector<ObjChunk> chunks(chunkCount);
+    parallelFor(chunkCount, threadCount, [&](size_t i) {
+        parseObjRecords(bounds[i], bounds[i + 1], chunks[i].data, &chunks[i].fixups, cancel);
+    });
+    if (cancel && cancel->load()) {
+        return;
+    }
+
+    // Global offset of every chunk's records
+    struct ChunkOffsets {
+        size_t positions, fileNormals, texcoords, faces;
+    };
+    std::vector<ChunkOffsets> offsets(chunkCount + 1);
+    offsets[0] = { data.positions.size(), data.fileNormals.size(), data.texcoords.size(), data.faces.size() };
+    for (size_t i = 0; i < chunkCount; i++) {
+        const ObjData& chunk = chunks[i].data;
+        offsets[i + 1].positions = offsets[i].positions + chunk.positions.size();
+        offsets[i + 1].fileNormals = offsets[i].fileNormals + chunk.fileNormals.size();
+        offsets[i + 1].texcoords = offsets[i].texcoords + chunk.texcoords.size();
+        offsets[i + 1].faces = offsets[i].faces + chunk.faces.size();
+    }
+
+    // Colors are stored for every position once any chunk has one
+    bool colored = !data.colors.empty();
+    for (const ObjChunk& chunk : chunks) {
+        colored = colored || !chunk.data.colors.empty();
+    }
+
+    data.positions.resize(offsets[chunkCount].positions);
+    if (colored) {
+        data.colors.resize(offsets[chunkCount].positions, OBJ_DEFAULT_COLOR);
+    }
+    data.fileNormals.resize(offsets[chunkCount].fileNormals);
+    data.texcoords.resize(offsets[chunkCount].texcoords);
+    data.faces.resize(offsets[chunkCount].faces);
+
+    // Merge: copy each chunk into place and shift its relative indices by the records before it
+    parallelFor(chunkCount, threadCount, [&](size_t i) {
+        ObjChunk& chunk = chunks[i];
+        const ChunkOffsets& base = offsets[i];
+        copyInto(data.positions, base.positions, chunk.data.positions);
+        copyInto(data.colors, base.positions, chunk.data.colors);  // Chunks without colors keep the default
+        copyInto(data.fileNormals, base.fileNormals, chunk.data.fileNormals);
+        copyInto(data.texcoords, base.texcoords, chunk.data.texcoords);
+        copyInto(data.faces, base.faces, chunk.data.faces);
+
+        const int shift[3] = { (int)base.positions, (int)base.texcoords, (int)base.fileNormals };
+        for (const RelativeFixup& fixup : chunk.fixups) {
+            ObjFace& face = data.faces[base.faces + fixup.face];
+            for (int corner = 0; corner < 3; corner++) {
+                if (fixup.mask & (1u << (corner * 3 + 0))) face.posIndices[corner] += shift[0];
+                if (fixup.mask & (1u << (corner * 3 + 1))) face.texIndices[corner] += shift[1];
+                if (fixup.mask & (1u << (corner * 3 + 2))) face.normIndices[corner] += shift[2];
+            }
+        }
+
+        chunk = ObjChunk();  // Release the chunk's buffers as soon as they are merged
+    });
+}
+
+bool parseObjFile(const std::string& filename, ObjData& data, unsigned threadCount, const std::atomic<bool>* cancel) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        return false;
+    }
+    parseObjBufferParallel(file.data(), file.data() + file.size(), data, threadCount, cancel);
+    return !(cancel && cancel->load());
+}
+
+ObjCounts countObjRecords(const char* begin, const char* end, unsigned threadCount) {
+    threadCount = resolveThreadCount(threadCount);
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(size_t(threadCount) * 4, (end - begin) / MIN_CHUNK_BYTES));
+    std::vector<const char*> bounds = splitLines(begin, end, chunkCount);
+    std::vector<ObjCounts> chunkCounts(chunkCount);
+    parallelFor(chunkCount, threadCount, [&](size_t i) {
+        ObjCounts& counts = chunkCounts[i];
+        const char* lineStart = bounds[i];
+        while (lineStart < bounds[i + 1]) {
+            const char* lineEnd = findLineEnd(lineStart, bounds[i + 1]);
+            const char* p = lineStart;
+            switch (recordType(p, lineEnd)) {
+            case RECORD_POSITION: {
+                counts.positions++;
+                // x y z r g b: only the number of values matters here
+                int values = 0;
+                for (skipSpaces(p, lineEnd); p < lineEnd && values < 6; skipSpaces(p, lineEnd)) {
+                    while (p < lineEnd && !isLineSpace(*p)) ++p;
+                    values++;
+                }
+                counts.coloredPositions += values >= 6 ? 1 : 0;
+                break;
+            }
+            case RECORD_TEXCOORD: counts.texcoords++; break;
+            case RECORD_NORMAL: counts.fileNormals++; break;
+            case RECORD_FACE: counts.faces++; break;
+            default: break;
+            }
+            lineStart = lineEnd + 1;
+        }
+    });
+
+    ObjCounts total;
+    for (const ObjCounts& counts : chunkCounts) {
+        total.positions += counts.positions;
+        total.coloredPositions += counts.coloredPositions;
+        total.texcoords += counts.texcoords;
+        total.fileNormals += counts.fileNormals;
+        total.faces += counts.faces;
+    }
+    return total;
+}
+
+void parseObjAttributes(const char* begin, const char* end, ObjData& data) {
+    const char* lineStart = begin;
+    while (lineStart < end) {
+        const char* lineEnd = findLineEnd(lineStart, end);
+        const char* p = lineStart;
+        ObjRecordType type = recordType(p, lineEnd);
+        if (type == RECORD_POSITION) {
+            parseVertexRecord(p, lineEnd, data);
+        }
+        else if (type == RECORD_TEXCOORD) {
+            parseTexcoordRecord(p, lineEnd, data);
+        }
+        lineStart = lineEnd + 1;
+    }
+}
+
+bool readObjFaces(ObjFaceStream& stream, std::vector<ObjFace>& faces, size_t maxFaces) {
+    faces.clear();
+    while (stream.cursor < stream.end && faces.size() < maxFaces) {
+        const char* lineEnd = findLineEnd(stream.cursor, stream.end);
+        const char* p = stream.cursor;
+        switch (recordType(p, lineEnd)) {
+        case RECORD_POSITION: stream.positions++; break;
+        case RECORD_TEXCOORD: stream.texcoords++; break;
+        case RECORD_NORMAL: stream.fileNormals++; break;
+        case RECORD_FACE: {
+            ObjFace face;
+            unsigned faceMask;
+            RecordCounts counts = { stream.positions, stream.texcoords, stream.fileNormals };
+            if (parseFaceCorners(p, lineEnd, counts, face, faceMask)) {
+                faces.push_back(face);
+            }
+            break;
+        }
+        default: break;
+        }
+        stream.cursor = lineEnd + 1;
+    }
+    return !faces.empty();
+}
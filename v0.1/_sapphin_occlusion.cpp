@@ -0,0 +1,212 @@
+// _sapphin_occlusion.cpp
+// This rasterizes occluder depth on the CPU at low resolution and tests bounding boxes against its depth pyramid.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+// Headers
+#include "headers/_sapphin_occlusion.h"
+#include "headers/_sapphin_softraster.h"
+#include "headers/_sapphin_utils.h"
+#include "headers/_sapphin_types.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+
+// Boxes reaching closer to the camera plane than this (in clip w) are always visible
+static const float OCCLUSION_MIN_W = 1e-5f;
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool OcclusionCuller::create(unsigned threads) {
+    threadCount = resolveThreadCount(threads);
+    levels.clear();
+    oversizedOccluders.clear();
+    pyramidReady = false;
+    stats = OcclusionStats();
+    return true;
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4& view, const glm::mat4& projection, int framebufferWidth, int framebufferHeight) {
+    auto start = std::chrono::steady_clock::now();
+    int height = OCCLUSION_WIDTH * 3 / 4;
+    if (framebufferWidth > 0 && framebufferHeight > 0) {
+        height = static_cast<int>(std::lround(static_cast<double>(OCCLUSION_WIDTH) * framebufferHeight / framebufferWidth));
+        height = std::min(std::max(height, 16), OCCLUSION_WIDTH * 4);
+    }
+    if (rasterizer.width() != OCCLUSION_WIDTH || rasterizer.height() != height) {
+        rasterizer.create(OCCLUSION_WIDTH, height, threadCount, true);
+    }
+    rasterizer.setCamera(view, projection);
+    rasterizer.clear(glm::vec4(0.0f));
+    viewProjection = projection * view;
+    cameraPosition = glm::vec3(glm::inverse(view)[3]);
+    texelsPerRadian = projection[1][1] * height * 0.5f;
+    frameOccluderTriangles = 0;
+    pyramidReady = false;
+    stats.rasterMilliseconds += millisecondsSince(start);
+}
+
+bool OcclusionCuller::addOccluder(const Mesh& mesh, const glm::mat4& model) {
+    const size_t levelCount = std::max<size_t>(mesh.lods.size(), 1);
+    auto levelIndices = [&](size_t level) {
+        return mesh.lods.empty() ? mesh.indices.size() : static_cast<size_t>(mesh.lods[level].indexCount);
+    };
+
+    // A simplified level may close openings or stick out past the surface, hiding things that are visible.
+    // It is only used while its error stays below one depth texel where the occluder comes nearest the camera.
+    float scale = std::max({ glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])) });
+    glm::vec3 center = glm::vec3(model * glm::vec4((mesh.boundsMin + mesh.boundsMax) * 0.5f, 1.0f));
+    float nearest = glm::length(center - cameraPosition) - glm::length(mesh.boundsMax - mesh.boundsMin) * 0.5f * scale;
+    auto levelHidesLikeMesh = [&](size_t level) {
+        return level == 0 || (nearest > 0.0f && mesh.lods[level].error * scale * texelsPerRadian < nearest);
+    };
+
+    // Levels of detail get coarser (and their errors larger) as they go, so the first one that fits is the finest
+    size_t level = 0;
+    while (level < levelCount && levelHidesLikeMesh(level) &&
+        frameOccluderTriangles + levelIndices(level) / 3 > OCCLUSION_MAX_OCCLUDER_TRIANGLES) {
+        level++;
+    }
+    if (level == levelCount || !levelHidesLikeMesh(level)) {
+        size_t coarsest = levelIndices(levelCount - 1) / 3;
+        if (coarsest > OCCLUSION_MAX_OCCLUDER_TRIANGLES &&
+            std::find(oversizedOccluders.begin(), oversizedOccluders.end(), &mesh) == oversizedOccluders.end()) {
+            oversizedOccluders.push_back(&mesh);
+            std::cerr << "Occlusion: an occluder of " << levelIndices(0) / 3 << " triangles (" << coarsest
+                << " at its coarsest level of detail) never fits in the budget of " << OCCLUSION_MAX_OCCLUDER_TRIANGLES
+                << " triangles per frame and hides nothing" << std::endl;
+        }
+        stats.skippedOccluders++;
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    const uint32_t* indices = mesh.indices.data() + (mesh.lods.empty() ? 0 : mesh.lods[level].firstIndex);
+    frameOccluderTriangles += rasterizer.draw(mesh.vertices.data(), mesh.vertices.size(), indices, levelIndices(level), model);
+    stats.simplifiedOccluders += level > 0;
+    stats.rasterMilliseconds += millisecondsSince(start);
+    return true;
+}
+
+void OcclusionCuller::finish() {
+    auto start = std::chrono::steady_clock::now();
+    rasterizer.finish();
+    rasterizer.takeStats();
+    buildPyramid();
+    pyramidReady = true;
+    stats.frames++;
+    stats.occluderTriangles += frameOccluderTriangles;
+    stats.rasterMilliseconds += millisecondsSince(start);
+}
+
+// Level 0 is the rasterized depth; every further level halves both sides (rounding up, so odd edges repeat)
+void OcclusionCuller::buildPyramid() {
+    int width = rasterizer.width();
+    int height = rasterizer.height();
+    size_t levelCount = 1;
+    for (int side = std::max(width, height); side > 1; side = (side + 1) / 2) {
+        levelCount++;
+    }
+    levels.resize(levelCount);
+
+    PyramidLevel& base = levels[0];
+    base.width = width;
+    base.height = height;
+    base.depth.resize(static_cast<size_t>(width) * height);
+    const float* depth = rasterizer.depthData();
+    for (int y = 0; y < height; y++) {
+        std::copy(depth + static_cast<size_t>(y) * rasterizer.depthStride(), depth + static_cast<size_t>(y) * rasterizer.depthStride() + width,
+            base.depth.begin() + static_cast<size_t>(y) * width);
+    }
+
+    for (size_t level = 1; level < levelCount; level++) {
+        const PyramidLevel& below = levels[level - 1];
+        PyramidLevel& current = levels[level];
+        current.width = (below.width + 1) / 2;
+        current.height = (below.height + 1) / 2;
+        current.depth.resize(static_cast<size_t>(current.width) * current.height);
+        for (int y = 0; y < current.height; y++) {
+            const float* row0 = &below.depth[static_cast<size_t>(2 * y) * below.width];
+            const float* row1 = &below.depth[static_cast<size_t>(std::min(2 * y + 1, below.height - 1)) * below.width];
+            float* output = &current.depth[static_cast<size_t>(y) * current.width];
+            for (int x = 0; x < current.width; x++) {
+                int x0 = 2 * x, x1 = std::min(2 * x + 1, below.width - 1);
+                output[x] = std::max(std::max(row0[x0], row0[x1]), std::max(row1[x0], row1[x1]));
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::boxVisible(const glm::mat4& boxToClip, const glm::vec3& boundsMin, const glm::vec3& boundsMax, size_t triangles) {
+    if (!pyramidReady) {
+        return true;
+    }
+    auto start = std::chrono::steady_clock::now();
+    stats.testedBoxes++;
+
+    // Screen rectangle and nearest depth of the eight corners
+    const PyramidLevel& base = levels[0];
+    float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f, nearest = 1e30f;
+    bool visible = false;
+    for (int corner = 0; corner < 8 && !visible; corner++) {
+        glm::vec4 clip = boxToClip * glm::vec4(corner & 1 ? boundsMax.x : boundsMin.x, corner & 2 ? boundsMax.y : boundsMin.y,
+            corner & 4 ? boundsMax.z : boundsMin.z, 1.0f);
+        if (clip.w < OCCLUSION_MIN_W) {
+            visible = true;  // Reaches the camera plane, where the projection folds over
+            break;
+        }
+        float invW = 1.0f / clip.w;
+        float x = (clip.x * invW * 0.5f + 0.5f) * base.width;
+        float y = (clip.y * invW * 0.5f + 0.5f) * base.height;
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        nearest = std::min(nearest, clip.z * invW * 0.5f + 0.5f);
+    }
+
+    // Pixels the rectangle touches, at the level where it spans at most two texels each way
+    int x0 = std::max(static_cast<int>(std::floor(minX)), 0);
+    int y0 = std::max(static_cast<int>(std::floor(minY)), 0);
+    int x1 = std::min(static_cast<int>(std::floor(maxX)), base.width - 1);
+    int y1 = std::min(static_cast<int>(std::floor(maxY)), base.height - 1);
+    if (!visible && x0 <= x1 && y0 <= y1 && nearest > 0.0f) {
+        int extent = std::max(x1 - x0, y1 - y0) + 1;
+        size_t level = 0;
+        while (level + 1 < levels.size() && (1 << level) < extent) {
+            level++;
+        }
+        const PyramidLevel& texels = levels[level];
+        float farthest = 0.0f;
+        for (int y = y0 >> level; y <= (y1 >> level); y++) {
+            for (int x = x0 >> level; x <= (x1 >> level); x++) {
+                farthest = std::max(farthest, texels.depth[static_cast<size_t>(y) * texels.width + x]);
+            }
+        }
+        visible = nearest <= farthest;
+    }
+    else {
+        // Off screen boxes are left to frustum culling
+        visible = true;
+    }
+
+    if (!visible) {
+        stats.occludedBoxes++;
+        stats.occludedTriangles += triangles;
+    }
+    stats.testMilliseconds += millisecondsSince(start);
+    return visible;
+}
+
+OcclusionStats OcclusionCuller::takeStats() {
+    OcclusionStats taken = stats;
+    stats = OcclusionStats();
+    return taken;
+}
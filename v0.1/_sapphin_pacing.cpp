@@ -0,0 +1,84 @@
+// _sapphin_pacing.cpp
+// This holds the render loop to a frame rate cap with evenly spaced frames.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#ifdef _WIN32
+#include <windows.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+// Headers
+#include "headers/_sapphin_pacing.h"
+
+static double millisecondsBetween(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void FramePacer::setRate(double framesPerSecond) {
+    period = framesPerSecond > 0.0
+        ? std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / framesPerSecond))
+        : std::chrono::steady_clock::duration::zero();
+    scheduled = false;
+#ifdef _WIN32
+    // Sleeps are rounded to the 15.6 ms timer tick otherwise
+    static bool timerResolutionRaised = false;
+    if (active() && !timerResolutionRaised) {
+        timeBeginPeriod(1);
+        timerResolutionRaised = true;
+    }
+#endif
+}
+
+void FramePacer::wait() {
+    if (!active()) {
+        return;
+    }
+    stats.frames++;
+    auto now = std::chrono::steady_clock::now();
+    if (!scheduled) {
+        deadline = now + period;
+        scheduled = true;
+        return;
+    }
+    if (now >= deadline) {
+        stats.lateFrames++;
+        deadline = now + period;
+        return;
+    }
+
+    // Sleep through most of the wait, then yield until the deadline
+    auto sleepStart = now;
+    auto wakeTarget = deadline - std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double, std::milli>(spinMilliseconds));
+    if (wakeTarget > now) {
+        std::this_thread::sleep_until(wakeTarget);
+        now = std::chrono::steady_clock::now();
+        stats.sleepMilliseconds += millisecondsBetween(sleepStart, now);
+        // The OS woke us this much later than asked: stop sleeping earlier after a late wake, and drift back
+        // towards short yields while wakes are punctual (up to half a period, so pacing never becomes a busy loop)
+        double oversleep = millisecondsBetween(wakeTarget, now);
+        if (oversleep > spinMilliseconds) {
+            spinMilliseconds = std::min(oversleep * 1.25, std::chrono::duration<double, std::milli>(period).count() * 0.5);
+        }
+        else {
+            spinMilliseconds = std::max(spinMilliseconds * 0.95, FRAME_PACING_SPIN_MILLISECONDS);
+        }
+    }
+    auto spinStart = now;
+    while (now < deadline) {
+        std::this_thread::yield();
+        now = std::chrono::steady_clock::now();
+    }
+    stats.spinMilliseconds += millisecondsBetween(spinStart, now);
+    stats.maxErrorMilliseconds = std::max(stats.maxErrorMilliseconds, millisecondsBetween(deadline, now));
+    deadline += period;
+}
+
+FramePacingStats FramePacer::takeStats() {
+    FramePacingStats taken = stats;
+    stats = FramePacingStats();
+    return taken;
+}
@@ -0,0 +1,136 @@
+// _sapphin_packing.cpp
+// This converts meshes to the compact 20-byte PackedVertex layout.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+//
+// Error bounds of the packed layout (decoded value vs. the original float):
+//   Position: snorm16 over the mesh bounds, at most extent / 131068 per axis (half of a step of extent / 65534).
+//   Normal:   snorm10 per component, at most 1/1022 per component (well under 0.1 degrees).
+//   UV:       half float, relative error at most 2^-11 (2^-12 absolute for UVs in [0, 1]).
+//   Color:    unorm8, at most 1/510 per channel. Colors outside [0, 1] are clamped.
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+// Headers
+#include "headers/_sapphin_packing.h"
+#include "headers/_sapphin_types.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+
+// Convert a float to an IEEE half float, rounding to nearest even
+uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t floatExponent = (bits >> 23) & 0xFF;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    // Infinity and NaN
+    if (floatExponent == 0xFF) {
+        return static_cast<uint16_t>(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+    }
+
+    int32_t exponent = static_cast<int32_t>(floatExponent) - 127 + 15;
+    if (exponent >= 31) {
+        return static_cast<uint16_t>(sign | 0x7C00);  // Too large, becomes infinity
+    }
+
+    if (exponent <= 0) {
+        // Subnormal half (or zero)
+        if (exponent < -10) return static_cast<uint16_t>(sign);
+        mantissa |= 0x800000;
+        uint32_t shift = static_cast<uint32_t>(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1))) half++;
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    // A carry out of the mantissa correctly bumps the exponent
+    uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1FFF;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;
+    return static_cast<uint16_t>(sign | half);
+}
+
+float halfToFloat(uint16_t value) {
+    uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1F;
+    uint32_t mantissa = value & 0x3FF;
+
+    if (exponent == 0) {
+        float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -magnitude : magnitude;
+    }
+
+    uint32_t bits;
+    if (exponent == 31) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    }
+    else {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+// Signed normalized integer with 'bits' bits, as GL decodes it: max(q / (2^(bits-1) - 1), -1)
+static inline int32_t toSnorm(float value, int bits) {
+    float maxValue = static_cast<float>((1 << (bits - 1)) - 1);
+    return static_cast<int32_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * maxValue));
+}
+
+static inline uint8_t toUnorm8(float value) {
+    return static_cast<uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+}
+
+// Pack a normal as GL_INT_2_10_10_10_REV (x in the lowest bits, w unused)
+static inline uint32_t packNormal(float x, float y, float z) {
+    uint32_t px = static_cast<uint32_t>(toSnorm(x, 10)) & 0x3FF;
+    uint32_t py = static_cast<uint32_t>(toSnorm(y, 10)) & 0x3FF;
+    uint32_t pz = static_cast<uint32_t>(toSnorm(z, 10)) & 0x3FF;
+    return px | (py << 10) | (pz << 20);
+}
+
+PackedMeshInfo packVertices(const Mesh& mesh, std::vector<PackedVertex>& packed) {
+    PackedMeshInfo info;
+    info.positionOffset = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+    info.positionScale = (mesh.boundsMax - mesh.boundsMin) * 0.5f;
+
+    // A flat axis still needs a non-zero scale; every vertex then sits exactly on the center
+    for (int axis = 0; axis < 3; axis++) {
+        if (info.positionScale[axis] <= 0.0f) info.positionScale[axis] = 1.0f;
+    }
+
+    packed.resize(mesh.vertices.size());
+    for (size_t i = 0; i < mesh.vertices.size(); i++) {
+        const Vertex& vertex = mesh.vertices[i];
+        PackedVertex& out = packed[i];
+
+        // Position relative to the bounds
+        const float position[3] = { vertex.x, vertex.y, vertex.z };
+        int16_t* quantized[3] = { &out.x, &out.y, &out.z };
+        for (int axis = 0; axis < 3; axis++) {
+            float normalized = (position[axis] - info.positionOffset[axis]) / info.positionScale[axis];
+            *quantized[axis] = static_cast<int16_t>(toSnorm(normalized, 16));
+
+            float decoded = (*quantized[axis] / 32767.0f) * info.positionScale[axis] + info.positionOffset[axis];
+            info.maxPositionError = std::max(info.maxPositionError, std::fabs(decoded - position[axis]));
+        }
+        out.w = 0;
+
+        out.normal = packNormal(vertex.nx, vertex.ny, vertex.nz);
+        out.u = floatToHalf(vertex.u);
+        out.v = floatToHalf(vertex.v);
+        out.r = toUnorm8(vertex.r);
+        out.g = toUnorm8(vertex.g);
+        out.b = toUnorm8(vertex.b);
+        out.a = toUnorm8(vertex.a);
+    }
+    return info;
+}
@@ -0,0 +1,481 @@
+// _sapphin_picking.cpp
+// This builds a binned SAH hierarchy over the triangles of a mesh in parallel and casts picking rays against it.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SAPPHIN_PICKING_SSE2
+#endif
+
+// Headers
+#include "headers/_sapphin_picking.h"
+#include "headers/_sapphin_utils.h"
+#include "headers/_sapphin_types.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+
+// Triangles per task when computing bounds and binning the large nodes near the root
+static const size_t PICK_BLOCK_SIZE = 1 << 14;
+
+// Nodes below this many triangles are built by one thread each, as independent subtrees
+static const size_t PICK_SUBTREE_TRIANGLES = 1 << 15;
+
+// Deeper nodes become leaves whatever their size; bounds the traversal stack
+static const unsigned PICK_MAX_DEPTH = 96;
+
+// Bounds and centroid of one triangle
+struct PickItem {
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    glm::vec3 centroid;
+};
+
+struct PickBounds {
+    glm::vec3 boundsMin = glm::vec3(INFINITY);
+    glm::vec3 boundsMax = glm::vec3(-INFINITY);
+    glm::vec3 centroidMin = glm::vec3(INFINITY);
+    glm::vec3 centroidMax = glm::vec3(-INFINITY);
+
+    void add(const PickItem& item) {
+        boundsMin = glm::min(boundsMin, item.boundsMin);
+        boundsMax = glm::max(boundsMax, item.boundsMax);
+        centroidMin = glm::min(centroidMin, item.centroid);
+        centroidMax = glm::max(centroidMax, item.centroid);
+    }
+    void add(const PickBounds& other) {
+        boundsMin = glm::min(boundsMin, other.boundsMin);
+        boundsMax = glm::max(boundsMax, other.boundsMax);
+        centroidMin = glm::min(centroidMin, other.centroidMin);
+        centroidMax = glm::max(centroidMax, other.centroidMax);
+    }
+};
+
+struct SahBin {
+    glm::vec3 boundsMin = glm::vec3(INFINITY);
+    glm::vec3 boundsMax = glm::vec3(-INFINITY);
+    size_t count = 0;
+};
+
+// Half the surface area of a box; only ratios matter to the heuristic
+static inline float halfArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(0.0f));
+    return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+}
+
+// Node of a subtree that one thread builds on its own
+struct PickSubtree {
+    uint32_t node;
+    size_t begin;
+    size_t end;
+    unsigned depth;
+};
+
+struct PickBuilder {
+    const std::vector<PickItem>& items;
+    std::vector<uint32_t>& order;  // Triangle order; every node covers order[begin, end)
+    unsigned threadCount;
+    std::vector<PickSubtree> subtrees;
+
+    // Bounds of order[first, last)
+    void addBounds(size_t first, size_t last, PickBounds& bounds) const {
+        for (size_t i = first; i < last; i++) {
+            bounds.add(items[order[i]]);
+        }
+    }
+
+    // Sort the centroids of order[first, last) into PICK_SAH_BINS bins per axis (bins[axis * PICK_SAH_BINS + bin])
+    void addToBins(size_t first, size_t last, const PickBounds& nodeBounds, SahBin* bins) const {
+        glm::vec3 extent = nodeBounds.centroidMax - nodeBounds.centroidMin;
+        glm::vec3 scale;
+        for (int axis = 0; axis < 3; axis++) {
+            scale[axis] = extent[axis] > 0.0f ? PICK_SAH_BINS / extent[axis] : 0.0f;
+        }
+        for (size_t i = first; i < last; i++) {
+            const PickItem& item = items[order[i]];
+            for (int axis = 0; axis < 3; axis++) {
+                size_t index = std::min<size_t>(static_cast<size_t>((item.centroid[axis] - nodeBounds.centroidMin[axis]) * scale[axis]), PICK_SAH_BINS - 1);
+                SahBin& bin = bins[axis * PICK_SAH_BINS + index];
+                bin.boundsMin = glm::min(bin.boundsMin, item.boundsMin);
+                bin.boundsMax = glm::max(bin.boundsMax, item.boundsMax);
+                bin.count++;
+            }
+        }
+    }
+
+    // Build the node at nodes[nodeIndex] for order[begin, end). Near the root (topLevel), ranges small enough
+    // for one thread are recorded in subtrees instead of being built; larger ones are scanned in parallel blocks.
+    void build(std::vector<PickBvhNode>& nodes, uint32_t nodeIndex, size_t begin, size_t end, unsigned depth, bool topLevel) {
+        const size_t count = end - begin;
+        if (topLevel && count <= PICK_SUBTREE_TRIANGLES) {
+            subtrees.push_back({ nodeIndex, begin, end, depth });
+            return;
+        }
+        const size_t blocks = topLevel ? (count + PICK_BLOCK_SIZE - 1) / PICK_BLOCK_SIZE : 1;
+        auto blockBegin = [&](size_t block) { return begin + block * count / blocks; };
+
+        PickBounds nodeBounds;
+        if (blocks > 1) {
+            std::vector<PickBounds> partial(blocks);
+            parallelFor(blocks, threadCount, [&](size_t block) {
+                addBounds(blockBegin(block), blockBegin(block + 1), partial[block]);
+            });
+            for (const PickBounds& part : partial) {
+                nodeBounds.add(part);
+            }
+        }
+        else {
+            addBounds(begin, end, nodeBounds);
+        }
+        nodes[nodeIndex].boundsMin = nodeBounds.boundsMin;
+        nodes[nodeIndex].boundsMax = nodeBounds.boundsMax;
+
+        // Up to PICK_LEAF_TRIANGLES cost one SIMD test, as cheap as a node; so do triangles that can't be told apart
+        glm::vec3 extent = nodeBounds.centroidMax - nodeBounds.centroidMin;
+        if (count <= PICK_LEAF_TRIANGLES || depth >= PICK_MAX_DEPTH || std::max(extent.x, std::max(extent.y, extent.z)) <= 0.0f) {
+            nodes[nodeIndex].leftFirst = static_cast<uint32_t>(begin);
+            nodes[nodeIndex].count = static_cast<uint32_t>(count);
+            return;
+        }
+
+        SahBin bins[3 * PICK_SAH_BINS];
+        if (blocks > 1) {
+            std::vector<SahBin> partial(blocks * 3 * PICK_SAH_BINS);
+            parallelFor(blocks, threadCount, [&](size_t block) {
+                addToBins(blockBegin(block), blockBegin(block + 1), nodeBounds, &partial[block * 3 * PICK_SAH_BINS]);
+            });
+            for (size_t block = 0; block < blocks; block++) {
+                for (unsigned b = 0; b < 3 * PICK_SAH_BINS; b++) {
+                    const SahBin& part = partial[block * 3 * PICK_SAH_BINS + b];
+                    bins[b].boundsMin = glm::min(bins[b].boundsMin, part.boundsMin);
+                    bins[b].boundsMax = glm::max(bins[b].boundsMax, part.boundsMax);
+                    bins[b].count += part.count;
+                }
+            }
+        }
+        else {
+            addToBins(begin, end, nodeBounds, bins);
+        }
+
+        // Sweep every axis for the split with the least area-weighted triangle count
+        int bestAxis = -1;
+        size_t bestSplit = 0;
+        float bestCost = INFINITY;
+        for (int axis = 0; axis < 3; axis++) {
+            if (extent[axis] <= 0.0f) {
+                continue;
+            }
+            const SahBin* axisBins = &bins[axis * PICK_SAH_BINS];
+            float rightCost[PICK_SAH_BINS];
+            SahBin right;
+            for (unsigned b = PICK_SAH_BINS - 1; b > 0; b--) {
+                right.boundsMin = glm::min(right.boundsMin, axisBins[b].boundsMin);
+                right.boundsMax = glm::max(right.boundsMax, axisBins[b].boundsMax);
+                right.count += axisBins[b].count;
+                rightCost[b] = right.count * halfArea(right.boundsMin, right.boundsMax);
+            }
+            SahBin left;
+            for (unsigned b = 1; b < PICK_SAH_BINS; b++) {
+                left.boundsMin = glm::min(left.boundsMin, axisBins[b - 1].boundsMin);
+                left.boundsMax = glm::max(left.boundsMax, axisBins[b - 1].boundsMax);
+                left.count += axisBins[b - 1].count;
+                if (left.count == 0 || left.count == count) {
+                    continue;
+                }
+                float cost = left.count * halfArea(left.boundsMin, left.boundsMax) + rightCost[b];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = b;
+                }
+            }
+        }
+
+        size_t middle = begin + count / 2;  // Centroids all in one bin: halve the range
+        if (bestAxis >= 0) {
+            float scale = PICK_SAH_BINS / extent[bestAxis];
+            float centroidMin = nodeBounds.centroidMin[bestAxis];
+            middle = std::partition(order.begin() + begin, order.begin() + end, [&](uint32_t triangle) {
+                size_t index = std::min<size_t>(static_cast<size_t>((items[triangle].centroid[bestAxis] - centroidMin) * scale), PICK_SAH_BINS - 1);
+                return index < bestSplit;
+            }) - order.begin();
+        }
+
+        uint32_t left = static_cast<uint32_t>(nodes.size());
+        nodes.resize(nodes.size() + 2);
+        nodes[nodeIndex].leftFirst = left;
+        nodes[nodeIndex].count = 0;
+        build(nodes, left, begin, middle, depth + 1, topLevel);
+        build(nodes, left + 1, middle, end, depth + 1, topLevel);
+    }
+};
+
+void PickBvh::clear() {
+    nodes.clear();
+    for (int axis = 0; axis < 3; axis++) {
+        corner[axis].clear();
+        edge1[axis].clear();
+        edge2[axis].clear();
+    }
+    triangleIds.clear();
+    buildTime = 0.0;
+}
+
+void PickBvh::build(const Mesh& mesh, unsigned threadCount) {
+    auto start = std::chrono::steady_clock::now();
+    clear();
+    const size_t firstIndex = mesh.lods.empty() ? 0 : mesh.lods[0].firstIndex;
+    size_t triangleCount = (mesh.lods.empty() ? mesh.indices.size() : mesh.lods[0].indexCount) / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+    threadCount = resolveThreadCount(threadCount);
+
+    auto position = [&](size_t triangle, int corner) {
+        const Vertex& vertex = mesh.vertices[mesh.indices[firstIndex + triangle * 3 + corner]];
+        return glm::vec3(vertex.x, vertex.y, vertex.z);
+    };
+
+    std::vector<PickItem> items(triangleCount);
+    std::vector<uint32_t> order(triangleCount);
+    parallelFor((triangleCount + PICK_BLOCK_SIZE - 1) / PICK_BLOCK_SIZE, threadCount, [&](size_t block) {
+        size_t last = std::min(triangleCount, (block + 1) * PICK_BLOCK_SIZE);
+        for (size_t t = block * PICK_BLOCK_SIZE; t < last; t++) {
+            glm::vec3 p0 = position(t, 0), p1 = position(t, 1), p2 = position(t, 2);
+            items[t].boundsMin = glm::min(p0, glm::min(p1, p2));
+            items[t].boundsMax = glm::max(p0, glm::max(p1, p2));
+            items[t].centroid = (p0 + p1 + p2) / 3.0f;
+            order[t] = static_cast<uint32_t>(t);
+        }
+    });
+
+    // Top levels with parallel scans, then whole subtrees in parallel, biggest first
+    PickBuilder builder{ items, order, threadCount, {} };
+    nodes.resize(1);
+    builder.build(nodes, 0, 0, triangleCount, 0, true);
+    std::sort(builder.subtrees.begin(), builder.subtrees.end(), [](const PickSubtree& a, const PickSubtree& b) {
+        return a.end - a.begin > b.end - b.begin;
+    });
+    std::vector<std::vector<PickBvhNode>> subtreeNodes(builder.subtrees.size());
+    parallelFor(builder.subtrees.size(), threadCount, [&](size_t s) {
+        const PickSubtree& subtree = builder.subtrees[s];
+        subtreeNodes[s].resize(1);
+        builder.build(subtreeNodes[s], 0, subtree.begin, subtree.end, subtree.depth, false);
+    });
+
+    // Splice the subtrees in: their roots replace the placeholders, the rest is appended
+    for (size_t s = 0; s < builder.subtrees.size(); s++) {
+        const std::vector<PickBvhNode>& local = subtreeNodes[s];
+        uint32_t base = static_cast<uint32_t>(nodes.size()) - 1;  // Local node i (i >= 1) goes to base + i
+        for (size_t i = 0; i < local.size(); i++) {
+            PickBvhNode node = local[i];
+            if (node.count == 0) {
+                node.leftFirst += base;
+            }
+            if (i == 0) {
+                nodes[builder.subtrees[s].node] = node;
+            }
+            else {
+                nodes.push_back(node);
+            }
+        }
+    }
+
+    // Triangles in leaf order, one array per component, padded for the last SIMD load
+    const size_t padded = triangleCount + PICK_LEAF_TRIANGLES;
+    for (int axis = 0; axis < 3; axis++) {
+        corner[axis].assign(padded, 0.0f);
+        edge1[axis].assign(padded, 0.0f);
+        edge2[axis].assign(padded, 0.0f);
+    }
+    triangleIds.resize(triangleCount);
+    parallelFor((triangleCount + PICK_BLOCK_SIZE - 1) / PICK_BLOCK_SIZE, threadCount, [&](size_t block) {
+        size_t last = std::min(triangleCount, (block + 1) * PICK_BLOCK_SIZE);
+        for (size_t i = block * PICK_BLOCK_SIZE; i < last; i++) {
+            uint32_t triangle = order[i];
+            glm::vec3 p0 = position(triangle, 0), p1 = position(triangle, 1), p2 = position(triangle, 2);
+            for (int axis = 0; axis < 3; axis++) {
+                corner[axis][i] = p0[axis];
+                edge1[axis][i] = p1[axis] - p0[axis];
+                edge2[axis][i] = p2[axis] - p0[axis];
+            }
+            triangleIds[i] = static_cast<uint32_t>(firstIndex / 3 + triangle);
+        }
+    });
+
+    buildTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Built a picking BVH with " << nodes.size() << " nodes over " << triangleCount << " triangles in "
+        << buildTime << " ms (" << threadCount << " threads)" << std::endl;
+}
+
+// Distance at which the ray enters the box, or INFINITY if it misses it or enters beyond maxDistance
+static inline float enterBox(const PickBvhNode& node, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance) {
+    float tMin = 0.0f, tMax = maxDistance;
+    for (int axis = 0; axis < 3; axis++) {
+        float t0 = (node.boundsMin[axis] - origin[axis]) * inverseDirection[axis];
+        float t1 = (node.boundsMax[axis] - origin[axis]) * inverseDirection[axis];
+        tMin = std::max(tMin, std::min(t0, t1));
+        tMax = std::min(tMax, std::max(t0, t1));
+    }
+    return tMin <= tMax ? tMin : INFINITY;
+}
+
+RayHit PickBvh::intersect(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const {
+    RayHit result;
+    if (nodes.empty()) {
+        return result;
+    }
+    const glm::vec3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+    float closest = maxDistance;
+    size_t closestIndex = 0;
+
+#if defined(SAPPHIN_PICKING_SSE2)
+    const __m128 originX = _mm_set1_ps(origin.x), originY = _mm_set1_ps(origin.y), originZ = _mm_set1_ps(origin.z);
+    const __m128 directionX = _mm_set1_ps(direction.x), directionY = _mm_set1_ps(direction.y), directionZ = _mm_set1_ps(direction.z);
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+#endif
+
+    // Möller-Trumbore against the leaf's triangles, four at a time
+    auto intersectLeaf = [&](size_t first, size_t count) {
+        result.trianglesTested += count;
+        for (size_t i = first; i < first + count; i += PICK_LEAF_TRIANGLES) {
+#if defined(SAPPHIN_PICKING_SSE2)
+            __m128 e1x = _mm_loadu_ps(&edge1[0][i]), e1y = _mm_loadu_ps(&edge1[1][i]), e1z = _mm_loadu_ps(&edge1[2][i]);
+            __m128 e2x = _mm_loadu_ps(&edge2[0][i]), e2y = _mm_loadu_ps(&edge2[1][i]), e2z = _mm_loadu_ps(&edge2[2][i]);
+            __m128 px = _mm_sub_ps(_mm_mul_ps(directionY, e2z), _mm_mul_ps(directionZ, e2y));
+            __m128 py = _mm_sub_ps(_mm_mul_ps(directionZ, e2x), _mm_mul_ps(directionX, e2z));
+            __m128 pz = _mm_sub_ps(_mm_mul_ps(directionX, e2y), _mm_mul_ps(directionY, e2x));
+            __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+            __m128 inverseDet = _mm_div_ps(one, det);
+
+            __m128 tx = _mm_sub_ps(originX, _mm_loadu_ps(&corner[0][i]));
+            __m128 ty = _mm_sub_ps(originY, _mm_loadu_ps(&corner[1][i]));
+            __m128 tz = _mm_sub_ps(originZ, _mm_loadu_ps(&corner[2][i]));
+            __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), inverseDet);
+            __m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+            __m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+            __m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+            __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(directionX, qx), _mm_mul_ps(directionY, qy)), _mm_mul_ps(directionZ, qz)), inverseDet);
+            __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverseDet);
+
+            // Front faces only (det > 0), inside the triangle and nearer than the closest hit so far
+            __m128 hit = _mm_and_ps(_mm_cmpgt_ps(det, zero), _mm_cmpge_ps(u, zero));
+            hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(v, zero), _mm_cmple_ps(_mm_add_ps(u, v), one)));
+            hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpgt_ps(t, zero), _mm_cmplt_ps(t, _mm_set1_ps(closest))));
+            int mask = _mm_movemask_ps(hit) & ((1 << std::min<size_t>(first + count - i, PICK_LEAF_TRIANGLES)) - 1);
+            if (mask != 0) {
+                float distances[4];
+                _mm_storeu_ps(distances, t);
+                for (int lane = 0; lane < 4; lane++) {
+                    if ((mask >> lane & 1) && distances[lane] < closest) {
+                        closest = distances[lane];
+                        closestIndex = i + lane;
+                        result.hit = true;
+                    }
+                }
+            }
+#else
+            for (size_t j = i; j < std::min(i + PICK_LEAF_TRIANGLES, first + count); j++) {
+                glm::vec3 e1(edge1[0][j], edge1[1][j], edge1[2][j]);
+                glm::vec3 e2(edge2[0][j], edge2[1][j], edge2[2][j]);
+                glm::vec3 p = glm::cross(direction, e2);
+                float det = glm::dot(e1, p);
+                if (!(det > 0.0f)) {
+                    continue;
+                }
+                float inverseDet = 1.0f / det;
+                glm::vec3 s = origin - glm::vec3(corner[0][j], corner[1][j], corner[2][j]);
+                float u = glm::dot(s, p) * inverseDet;
+                glm::vec3 q = glm::cross(s, e1);
+                float v = glm::dot(direction, q) * inverseDet;
+                float t = glm::dot(e2, q) * inverseDet;
+                if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t > 0.0f && t < closest) {
+                    closest = t;
+                    closestIndex = j;
+                    result.hit = true;
+                }
+            }
+#endif
+        }
+    };
+
+    // Nearest child first; the far one waits on the stack with its entry distance
+    uint32_t stackNodes[PICK_MAX_DEPTH + 2];
+    float stackDistances[PICK_MAX_DEPTH + 2];
+    int stackSize = 0;
+    uint32_t node = 0;
+    if (enterBox(nodes[0], origin, inverseDirection, closest) == INFINITY) {
+        return result;
+    }
+    while (true) {
+        const PickBvhNode& current = nodes[node];
+        result.nodesVisited++;
+        bool descended = false;
+        if (current.count > 0) {
+            intersectLeaf(current.leftFirst, current.count);
+        }
+        else {
+            uint32_t nearChild = current.leftFirst, farChild = current.leftFirst + 1;
+            float nearDistance = enterBox(nodes[nearChild], origin, inverseDirection, closest);
+            float farDistance = enterBox(nodes[farChild], origin, inverseDirection, closest);
+            if (farDistance < nearDistance) {
+                std::swap(nearChild, farChild);
+                std::swap(nearDistance, farDistance);
+            }
+            if (nearDistance != INFINITY) {
+                if (farDistance != INFINITY) {
+                    stackNodes[stackSize] = farChild;
+                    stackDistances[stackSize] = farDistance;
+                    stackSize++;
+                }
+                node = nearChild;
+                descended = true;
+            }
+        }
+        if (!descended) {
+            // Skip waiting nodes that start beyond a hit found since they were pushed
+            while (stackSize > 0 && stackDistances[stackSize - 1] >= closest) {
+                stackSize--;
+            }
+            if (stackSize == 0) {
+                break;
+            }
+            node = stackNodes[--stackSize];
+        }
+    }
+
+    if (result.hit) {
+        glm::vec3 e1(edge1[0][closestIndex], edge1[1][closestIndex], edge1[2][closestIndex]);
+        glm::vec3 e2(edge2[0][closestIndex], edge2[1][closestIndex], edge2[2][closestIndex]);
+        result.distance = closest;
+        result.triangle = triangleIds[closestIndex];
+        result.position = origin + direction * closest;
+        result.normal = glm::normalize(glm::cross(e1, e2));
+    }
+    return result;
+}
+
+bool cursorRay(const glm::mat4& view, const glm::mat4& projection, double cursorX, double cursorY, int windowWidth, int windowHeight,
+    glm::vec3& origin, glm::vec3& direction) {
+    if (windowWidth <= 0 || windowHeight <= 0) {
+        return false;
+    }
+    // Window position to normalized device coordinates (y up), then back through the camera on both clip planes
+    float x = static_cast<float>(2.0 * cursorX / windowWidth - 1.0);
+    float y = static_cast<float>(1.0 - 2.0 * cursorY / windowHeight);
+    glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+    glm::vec4 nearPoint = inverseViewProjection * glm::vec4(x, y, -1.0f, 1.0f);
+    glm::vec4 farPoint = inverseViewProjection * glm::vec4(x, y, 1.0f, 1.0f);
+    if (nearPoint.w == 0.0f || farPoint.w == 0.0f) {
+        return false;
+    }
+    origin = glm::vec3(nearPoint) / nearPoint.w;
+    direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+    return true;
+}
@@ -0,0 +1,267 @@
+// _sapphin_preprocess.cpp
+// This builds the .sapmesh caches of whole model directories on a thread pool, without any prompts.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <system_error>
+
+// Headers
+#include "headers/_sapphin_preprocess.h"
+#include "headers/_sapphin_utils.h"
+#include "headers/_sapphin_modeling.h"
+#include "headers/_sapphin_meshcache.h"
+#include "headers/_sapphin_types.h"
+
+static bool hasObjExtension(const std::filesystem::path& path) {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension == ".obj";
+}
+
+// Add one argument (or list file line); list files may not name other list files
+static bool addModelPath(const std::string& argument, bool allowList, std::vector<std::string>& files) {
+    std::error_code error;
+    std::filesystem::path path(argument);
+    if (std::filesystem::is_directory(path, error)) {
+        std::vector<std::string> found;
+        for (std::filesystem::recursive_directory_iterator it(path, error), end; !error && it != end; it.increment(error)) {
+            if (it->is_regular_file(error) && hasObjExtension(it->path())) {
+                found.push_back(it->path().string());
+            }
+        }
+        if (error) {
+            std::cerr << "Could not search " << argument << ": " << error.message() << std::endl;
+            return false;
+        }
+        std::sort(found.begin(), found.end());
+        files.insert(files.end(), found.begin(), found.end());
+        return true;
+    }
+    if (!std::filesystem::is_regular_file(path, error)) {
+        std::cerr << "Not found: " << argument << std::endl;
+        return false;
+    }
+    if (hasObjExtension(path)) {
+        files.push_back(argument);
+        return true;
+    }
+    if (!allowList) {
+        std::cerr << "Not a model or directory: " << argument << std::endl;
+        return false;
+    }
+
+    std::ifstream list(argument);
+    std::string line;
+    bool ok = true;
+    while (std::getline(list, line)) {
+        line.erase(std::find(line.begin(), line.end(), '#'), line.end());
+        while (!line.empty() && std::isspace(static_cast<unsigned char>(line.back()))) line.pop_back();
+        size_t first = line.find_first_not_of(" \t");
+        if (first == std::string::npos) continue;
+        ok = addModelPath(line.substr(first), false, files) && ok;
+    }
+    return ok;
+}
+
+bool collectModelFiles(const std::vector<std::string>& paths, std::vector<std::string>& files) {
+    std::vector<std::string> found;
+    bool ok = true;
+    for (const std::string& path : paths) {
+        ok = addModelPath(path, true, found) && ok;
+    }
+
+    // The same model reached twice (a directory and a list, say) is built once
+    std::set<std::string> seen;
+    for (const std::string& file : found) {
+        std::error_code error;
+        std::string key = std::filesystem::weakly_canonical(file, error).string();
+        if (error) key = file;
+        if (seen.insert(key).second) {
+            files.push_back(file);
+        }
+    }
+    return ok;
+}
+
+// Swallows everything; the loaders' per-model statistics would interleave line by line across workers
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+};
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int runPreprocess(const EngineOptions& options) {
+    std::vector<std::string> files;
+    bool inputsFound = collectModelFiles(options.preprocessPaths, files);
+    if (files.empty()) {
+        std::cerr << "Preprocess: no .obj files found" << std::endl;
+        return 1;
+    }
+    const uint32_t flags = meshProcessingFlags(options);
+
+    // Biggest models first, so a large one found last doesn't run alone at the end
+    std::vector<PreprocessResult> results(files.size());
+    for (size_t i = 0; i < files.size(); i++) {
+        std::error_code error;
+        results[i].filename = files[i];
+        results[i].sourceBytes = std::filesystem::file_size(files[i], error);
+    }
+    std::stable_sort(results.begin(), results.end(), [](const PreprocessResult& a, const PreprocessResult& b) {
+        return a.sourceBytes > b.sourceBytes;
+    });
+
+    // One model per worker; when there are fewer models than threads, each model gets several threads
+    unsigned threads = resolveThreadCount(options.threadCount);
+    unsigned workers = static_cast<unsigned>(std::min<size_t>(threads, files.size()));
+    unsigned threadsPerModel = std::max(1u, threads / workers);
+    std::cout << "Preprocess: " << files.size() << " models on " << workers << " workers (" << threadsPerModel
+        << " threads per model";
+
+    // --memory-budget bounds the whole run, so every model in flight gets an equal share of it
+    const size_t memoryBudget = loadMemoryBudget();
+    const size_t modelBudget = std::max<size_t>(memoryBudget / workers, 1);
+    if (memoryBudget > 0) {
+        setLoadMemoryBudget(modelBudget);
+        resetBoundedLoadPeak();
+        std::cout << ", " << modelBudget / (1024 * 1024) << " MB load budget per model";
+    }
+    std::cout << ")" << std::endl;
+
+    NullBuffer nullBuffer;
+    std::streambuf* consoleBuffer = std::cout.rdbuf(&nullBuffer);
+    std::ostream console(consoleBuffer);
+    std::mutex consoleMutex;
+    size_t finished = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    parallelFor(results.size(), workers, [&](size_t i) {
+        PreprocessResult& result = results[i];
+        auto modelStart = std::chrono::steady_clock::now();
+
+        Mesh mesh;
+        if (!options.forcePreprocess && readMeshCache(result.filename, flags, mesh)) {
+            result.cached = true;
+        }
+        else {
+            mesh = processMesh(result.filename, flags, nullptr, threadsPerModel, &result.memory);
+            result.failed = mesh.indices.empty() || !writeMeshCache(result.filename, flags, mesh);
+        }
+        result.vertices = mesh.vertices.size();
+        // Meshes with levels of detail keep the full-detail triangles first
+        result.triangles = (mesh.lods.empty() ? mesh.indices.size() : mesh.lods[0].indexCount) / 3;
+        std::error_code error;
+        result.outputBytes = result.failed ? 0 : std::filesystem::file_size(meshCachePath(result.filename), error);
+        result.milliseconds = millisecondsSince(modelStart);
+
+        std::lock_guard<std::mutex> lock(consoleMutex);
+        finished++;
+        console << "[" << finished << "/" << results.size() << "] " << result.filename << ": "
+            << (result.failed ? "FAILED" : result.cached ? "current" : "built") << ", " << result.triangles << " triangles in "
+            << result.milliseconds << " ms";
+        if (result.memory.budgetBytes > 0) {
+            console << ", load peak " << result.memory.peakBytes / (1024 * 1024) << " MB" << (result.memory.overBudget ? " (over budget)" : "");
+        }
+        console << std::endl;
+    });
+    double wallMilliseconds = millisecondsSince(start);
+    std::cout.rdbuf(consoleBuffer);
+    const size_t loadPeakBytes = boundedLoadPeakBytes();
+    setLoadMemoryBudget(memoryBudget);
+
+    // Totals
+    size_t built = 0, cached = 0, failed = 0, overBudget = 0, triangles = 0;
+    uint64_t sourceBytes = 0, outputBytes = 0;
+    double modelMilliseconds = 0.0;
+    for (const PreprocessResult& result : results) {
+        built += !result.failed && !result.cached;
+        cached += result.cached;
+        failed += result.failed;
+        overBudget += result.memory.overBudget;
+        triangles += result.triangles;
+        sourceBytes += result.sourceBytes;
+        outputBytes += result.outputBytes;
+        modelMilliseconds += result.milliseconds;
+    }
+    double seconds = wallMilliseconds / 1000.0;
+    double megabytesPerSecond = seconds > 0.0 ? sourceBytes / (1024.0 * 1024.0) / seconds : 0.0;
+
+    // Models in flight on average; close to the worker count when the pool is kept busy
+    double concurrency = wallMilliseconds > 0.0 ? modelMilliseconds / wallMilliseconds : 0.0;
+
+    std::string outputPath = options.benchmarkOutput.empty() ? "preprocess.json" : options.benchmarkOutput;
+    std::ofstream output(outputPath);
+    if (!output.is_open()) {
+        std::cerr << "Preprocess: failed to write " << outputPath << std::endl;
+        return 1;
+    }
+    output << "{\n"
+        << "  \"threads\": " << threads << ",\n"
+        << "  \"workers\": " << workers << ",\n"
+        << "  \"threadsPerModel\": " << threadsPerModel << ",\n"
+        << "  \"processingFlags\": " << flags << ",\n"
+        << "  \"force\": " << (options.forcePreprocess ? "true" : "false") << ",\n"
+        << "  \"memoryBudgetBytes\": " << memoryBudget << ",\n";
+    if (memoryBudget > 0) {
+        // Most held by all loads in flight together, which the per-model shares keep within the budget
+        output << "  \"memoryBudgetPerModelBytes\": " << modelBudget << ",\n"
+            << "  \"loadPeakBytes\": " << loadPeakBytes << ",\n"
+            << "  \"overBudget\": " << overBudget << ",\n";
+    }
+    output << "  \"models\": " << results.size() << ",\n"
+        << "  \"built\": " << built << ",\n"
+        << "  \"current\": " << cached << ",\n"
+        << "  \"failed\": " << failed << ",\n"
+        << "  \"wallMilliseconds\": " << wallMilliseconds << ",\n"
+        << "  \"modelMilliseconds\": " << modelMilliseconds << ",\n"
+        << "  \"averageConcurrency\": " << concurrency << ",\n"
+        << "  \"sourceBytes\": " << sourceBytes << ",\n"
+        << "  \"outputBytes\": " << outputBytes << ",\n"
+        << "  \"sourceMegabytesPerSecond\": " << megabytesPerSecond << ",\n"
+        << "  \"trianglesPerSecond\": " << (seconds > 0.0 ? triangles / seconds : 0.0) << ",\n"
+        << "  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const PreprocessResult& result = results[i];
+        output << (i ? ",\n" : "\n") << "    { \"file\": " << jsonString(result.filename) << ", \"status\": \""
+            << (result.failed ? "failed" : result.cached ? "current" : "built") << "\", \"vertices\": " << result.vertices
+            << ", \"triangles\": " << result.triangles << ", \"sourceBytes\": " << result.sourceBytes << ", \"outputBytes\": "
+            << result.outputBytes << ", \"milliseconds\": " << result.milliseconds;
+        const LoadMemoryStats& memory = result.memory;
+        if (memory.budgetBytes > 0) {
+            // Per-stage peaks of the bounded loader, for sizing jobs
+            output << ", \"loadPlannedBytes\": " << memory.plannedBytes << ", \"loadPeakBytes\": " << memory.peakBytes
+                << ", \"overBudget\": " << (memory.overBudget ? "true" : "false") << ", \"loadStagePeakBytes\": {";
+            for (size_t stage = 0; stage < memory.stages.size(); stage++) {
+                output << (stage ? ", " : " ") << jsonString(memory.stages[stage].name) << ": " << memory.stages[stage].peakBytes;
+            }
+            output << " }";
+        }
+        output << " }";
+    }
+    output << "\n  ]\n}\n";
+
+    std::cout << "Preprocess: " << built << " built, " << cached << " current, " << failed << " failed in " << wallMilliseconds
+        << " ms (" << megabytesPerSecond << " MB/s of OBJ, " << concurrency << " models in flight on average, written to "
+        << outputPath << ")" << std::endl;
+    if (memoryBudget > 0) {
+        std::cout << "Preprocess: load peak " << loadPeakBytes / (1024 * 1024) << " MB of " << memoryBudget / (1024 * 1024)
+            << " MB across all workers";
+        if (overBudget > 0) {
+            std::cout << "; models that didn't fit their share: " << overBudget << " (fewer --threads gives each a larger one)";
+        }
+        std::cout << std::endl;
+    }
+    return (failed > 0 || !inputsFound) ? 1 : 0;
+}
@@ -0,0 +1,167 @@
+// _sapphin_profiler.cpp
+// This records where frame time goes, on the CPU and on the GPU, and writes it out as a Chrome trace.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+
+// Headers
+#include "headers/_sapphin_profiler.h"
+#include "lib/GLEW.win32/GLEW-lib/include/GL/glew.h"
+
+FrameProfiler& profiler() {
+    static FrameProfiler instance;
+    return instance;
+}
+
+FrameProfiler::FrameProfiler()
+    : origin(std::chrono::steady_clock::now()), slots(new Slot[PROFILER_RING_EVENTS]) {
+}
+
+uint64_t FrameProfiler::now() const {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count());
+}
+
+uint32_t FrameProfiler::currentTrack() {
+    static std::atomic<uint32_t> nextTrack{ 1 };
+    thread_local uint32_t track = nextTrack++;
+    return track;
+}
+
+// Every slot is a small sequence lock: readers only take events whose sequence says complete and unchanged
+void FrameProfiler::record(const char* name, uint64_t startNanoseconds, uint64_t durationNanoseconds, uint32_t track) {
+    uint64_t index = writeIndex.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = slots[index & (PROFILER_RING_EVENTS - 1)];
+
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start.store(startNanoseconds, std::memory_order_relaxed);
+    slot.duration.store(durationNanoseconds, std::memory_order_relaxed);
+    slot.track.store(track, std::memory_order_relaxed);
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+}
+
+void FrameProfiler::beginFrame() {
+    if (!isEnabled()) {
+        return;
+    }
+    if (!queriesCreated) {
+        for (GpuFrame& frame : gpuFrames) {
+            glGenQueries(static_cast<GLsizei>(PROFILER_GPU_ZONES), frame.queries);
+        }
+        queriesCreated = true;
+    }
+
+    frameNumber++;
+    GpuFrame& frame = gpuFrames[frameNumber % 2];
+    for (size_t i = 0; i < frame.count; i++) {
+        GLint available = 0;
+        glGetQueryObjectiv(frame.queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            droppedGpuZones++;
+            continue;
+        }
+        // GL_TIME_ELAPSED only has a duration; the zone is placed where the CPU submitted it
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &elapsed);
+        record(frame.names[i], frame.starts[i], elapsed, PROFILER_GPU_TRACK);
+    }
+    frame.count = 0;
+}
+
+bool FrameProfiler::beginGpuZone(const char* name) {
+    GpuFrame& frame = gpuFrames[frameNumber % 2];
+    if (!queriesCreated || gpuZoneOpen || frame.count == PROFILER_GPU_ZONES) {
+        return false;
+    }
+    frame.names[frame.count] = name;
+    frame.starts[frame.count] = now();
+    glBeginQuery(GL_TIME_ELAPSED, frame.queries[frame.count]);
+    gpuZoneOpen = true;
+    return true;
+}
+
+void FrameProfiler::endGpuZone() {
+    glEndQuery(GL_TIME_ELAPSED);
+    gpuFrames[frameNumber % 2].count++;
+    gpuZoneOpen = false;
+}
+
+void FrameProfiler::releaseGpu() {
+    if (queriesCreated) {
+        for (GpuFrame& frame : gpuFrames) {
+            glDeleteQueries(static_cast<GLsizei>(PROFILER_GPU_ZONES), frame.queries);
+            frame.count = 0;
+        }
+        queriesCreated = false;
+    }
+    if (droppedGpuZones > 0) {
+        std::cout << "Profiler: " << droppedGpuZones << " GPU zones were not finished two frames later and were dropped" << std::endl;
+        droppedGpuZones = 0;
+    }
+}
+
+bool FrameProfiler::writeChromeTrace(const std::string& filename) const {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Failed to write profile: " << filename << std::endl;
+        return false;
+    }
+
+    // Copy out every complete event still in the ring; slots being rewritten right now are skipped
+    uint64_t end = writeIndex.load(std::memory_order_acquire);
+    uint64_t begin = end > PROFILER_RING_EVENTS ? end - PROFILER_RING_EVENTS : 0;
+    std::vector<ProfileEvent> events;
+    events.reserve(static_cast<size_t>(end - begin));
+    for (uint64_t index = begin; index < end; index++) {
+        const Slot& slot = slots[index & (PROFILER_RING_EVENTS - 1)];
+        uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != 2 * index + 2) {
+            continue;
+        }
+        ProfileEvent event;
+        event.name = slot.name.load(std::memory_order_relaxed);
+        event.startNanoseconds = slot.start.load(std::memory_order_relaxed);
+        event.durationNanoseconds = slot.duration.load(std::memory_order_relaxed);
+        event.track = slot.track.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == sequence) {
+            events.push_back(event);
+        }
+    }
+    std::sort(events.begin(), events.end(), [](const ProfileEvent& a, const ProfileEvent& b) {
+        return a.startNanoseconds < b.startNanoseconds;
+    });
+
+    // Complete ("X") events in microseconds, plus names for the tracks
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Sapphin\"}},\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << PROFILER_GPU_TRACK << ",\"args\":{\"name\":\"GPU\"}}";
+    std::vector<uint32_t> namedTracks;
+    for (const ProfileEvent& event : events) {
+        if (event.track != PROFILER_GPU_TRACK && std::find(namedTracks.begin(), namedTracks.end(), event.track) == namedTracks.end()) {
+            namedTracks.push_back(event.track);
+            file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << event.track
+                << ",\"args\":{\"name\":\"Thread " << event.track << "\"}}";
+        }
+    }
+    file.setf(std::ios::fixed);
+    file.precision(3);
+    for (const ProfileEvent& event : events) {
+        file << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"" << (event.track == PROFILER_GPU_TRACK ? "gpu" : "cpu")
+            << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.track << ",\"ts\":" << event.startNanoseconds / 1000.0
+            << ",\"dur\":" << event.durationNanoseconds / 1000.0 << "}";
+    }
+    file << "\n]}\n";
+
+    std::cout << "Profile: " << events.size() << " zones written to " << filename;
+    if (end > PROFILER_RING_EVENTS) {
+        std::cout << " (the oldest " << end - PROFILER_RING_EVENTS << " were overwritten)";
+    }
+    std::cout << std::endl;
+    return file.good();
+}
@@ -5,17 +5,26 @@
 #include <stdio.h>
 #include <string>
 #include <vector>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <chrono>
 #include <thread>
 
 // Headers
+#include "headers/_sapphin_glstate.h"
 #include "headers/_sapphin_utils.h"
 #include "headers/_sapphin_camera.h"
 #include "headers/_sapphin_render.h"
 #include "headers/_sapphin_modeling.h"
 #include "headers/_sapphin_types.h"
+#include "headers/_sapphin_packing.h"
+#include "headers/_sapphin_culling.h"
+#include "headers/_sapphin_occlusion.h"
+#include "headers/_sapphin_lod.h"
+#include "headers/_sapphin_shadercache.h"
 #include "lib/GLEW.win32/GLEW-lib/include/GL/glew.h"
 #include "lib/GLFW.win32/GLFW-lib/include/GLFW/glfw3.h"
 
@@ -95,6 +104,371 @@ GLFWwindow* initOpenGL() {
 	return window;
 }
 
+// Hidden window whose only job is to own a GL 3.3 core context
+static GLFWwindow* createHiddenWindow(int width, int height, int contextApi) {
+    glfwDefaultWindowHints();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    if (contextApi != 0) {
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, contextApi);
+    }
+    return glfwCreateWindow(width, height, "Sapphin 3D Renderer (headless)", nullptr, nullptr);
+}
+
+// Context for rendering into framebuffer objects without showing anything. With GLFW 3.4 and Mesa this needs
+// no display server at all (null platform + OSMesa, which is llvmpipe underneath); otherwise it falls back to
+// a hidden window on an EGL context, then to a hidden window on the native one.
+GLFWwindow* initHeadlessOpenGL(int width, int height) {
+    glfwSetErrorCallback([](int error, const char* description) {
+        std::cerr << "GLFW Error " << error << ": " << description << std::endl;
+        });
+
+    GLFWwindow* window = nullptr;
+#if defined(GLFW_PLATFORM_NULL) && defined(GLFW_OSMESA_CONTEXT_API)
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    if (glfwInit()) {
+        window = createHiddenWindow(width, height, GLFW_OSMESA_CONTEXT_API);
+        if (!window) {
+            glfwTerminate();
+        }
+    }
+    glfwInitHint(GLFW_PLATFORM, GLFW_ANY_PLATFORM);
+#endif
+    if (!window) {
+        if (!glfwInit()) {
+            std::cerr << "Failed to initialize GLFW." << std::endl;
+            return nullptr;
+        }
+#ifdef GLFW_EGL_CONTEXT_API
+        window = createHiddenWindow(width, height, GLFW_EGL_CONTEXT_API);
+#endif
+        if (!window) {
+            window = createHiddenWindow(width, height, 0);
+        }
+        if (!window) {
+            std::cerr << "Failed to create a headless OpenGL context." << std::endl;
+            glfwTerminate();
+            return nullptr;
+        }
+    }
+
+    glfwMakeContextCurrent(window);
+    glewExperimental = GL_TRUE;
+    GLenum glewErr = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // GLX builds of GLEW complain about EGL and OSMesa contexts, but the GL entry points load fine
+    if (glewErr == GLEW_ERROR_NO_GLX_DISPLAY) glewErr = GLEW_OK;
+#endif
+    if (glewErr != GLEW_OK) {
+        std::cerr << "Failed to initialize GLEW: " << glewGetErrorString(glewErr) << std::endl;
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return nullptr;
+    }
+
+    // Same fixed state as initOpenGL
+    glViewport(0, 0, width, height);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_BACK);
+    glFrontFace(GL_CCW);
+    return window;
+}
+
+// Index data to upload, narrowed to 16 bits (in shortIndices) whenever every vertex can be addressed with them
+static GLenum narrowIndices(const Mesh& mesh, std::vector<uint16_t>& shortIndices, const void*& data, size_t& size) {
+    if (mesh.vertices.size() <= 0xFFFF) {
+        shortIndices.assign(mesh.indices.begin(), mesh.indices.end());
+        data = shortIndices.data();
+        size = shortIndices.size() * sizeof(uint16_t);
+        return GL_UNSIGNED_SHORT;
+    }
+    data = mesh.indices.data();
+    size = mesh.indices.size() * sizeof(uint32_t);
+    return GL_UNSIGNED_INT;
+}
+
+// Attribute layout of the vertex buffer bound to GL_ARRAY_BUFFER, recorded in the bound VAO
+static void setVertexLayout(bool packed) {
+    if (packed) {
+        // Position attribute (snorm16, scaled back to model space in the shader)
+        glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, x));
+        glEnableVertexAttribArray(0);
+
+        // Normal attribute (snorm 10_10_10_2, location = 1)
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+        glEnableVertexAttribArray(1);
+
+        // Texture coordinate attribute (half floats, location = 2)
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, u));
+        glEnableVertexAttribArray(2);
+
+        // Color attribute (unorm8, location = 3)
+        glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, r));
+        glEnableVertexAttribArray(3);
+        return;
+    }
+
+    // Position attribute
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, x));
+    glEnableVertexAttribArray(0);
+
+    // Normal attribute (location = 1)
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, nx));
+    glEnableVertexAttribArray(1);
+
+    // Texture coordinate attribute (location = 2)
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, u));
+    glEnableVertexAttribArray(2);
+
+    // Color attribute (location = 3)
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, r));
+    glEnableVertexAttribArray(3);
+}
+
+// New VAO with vertex and index buffers of the given sizes; data may be null to fill them later
+static GpuMesh createGpuMesh(const void* vertexData, size_t vertexSize, const void* indexData, size_t indexSize, bool packed) {
+    GpuMesh gpuMesh;
+    gpuMesh.packed = packed;
+    gpuMesh.vertexCapacity = vertexSize;
+    gpuMesh.indexCapacity = indexSize;
+    glGenVertexArrays(1, &gpuMesh.VAO);
+    glGenBuffers(1, &gpuMesh.VBO);
+    glGenBuffers(1, &gpuMesh.EBO);
+
+    glState().bindVertexArray(gpuMesh.VAO);
+    glState().bindBuffer(GL_ARRAY_BUFFER, gpuMesh.VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertexSize, vertexData, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpuMesh.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize, indexData, GL_STATIC_DRAW);
+    setVertexLayout(packed);
+
+    // The element buffer binding stays recorded in the VAO
+    glState().bindVertexArray(0);
+    glState().bindBuffer(GL_ARRAY_BUFFER, 0);
+    return gpuMesh;
+}
+
+// Upload a mesh into a new VAO with its own vertex and index buffers
+GpuMesh uploadMesh(const Mesh& mesh) {
+    std::vector<uint16_t> shortIndices;
+    const void* indexData;
+    size_t indexSize;
+    GLenum indexType = narrowIndices(mesh, shortIndices, indexData, indexSize);
+    GpuMesh gpuMesh = createGpuMesh(mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex), indexData, indexSize, false);
+    gpuMesh.indexType = indexType;
+    gpuMesh.indexCount = static_cast<GLsizei>(mesh.indices.size());
+    return gpuMesh;
+}
+
+// Upload a mesh using the 20-byte PackedVertex layout. Needs the shader from getPackedVertexShader().
+GpuMesh uploadPackedMesh(const Mesh& mesh) {
+    std::vector<PackedVertex> packed;
+    PackedMeshInfo info = packVertices(mesh, packed);
+
+    std::vector<uint16_t> shortIndices;
+    const void* indexData;
+    size_t indexSize;
+    GLenum indexType = narrowIndices(mesh, shortIndices, indexData, indexSize);
+    GpuMesh gpuMesh = createGpuMesh(packed.data(), packed.size() * sizeof(PackedVertex), indexData, indexSize, true);
+    gpuMesh.indexType = indexType;
+    gpuMesh.indexCount = static_cast<GLsizei>(mesh.indices.size());
+    gpuMesh.positionScale = info.positionScale;
+    gpuMesh.positionOffset = info.positionOffset;
+
+    std::cout << "Packed vertex buffer: " << (packed.size() * sizeof(PackedVertex)) / 1024 << " KB instead of "
+        << (mesh.vertices.size() * sizeof(Vertex)) / 1024 << " KB (max position error "
+        << info.maxPositionError << ")" << std::endl;
+    return gpuMesh;
+}
+
+MeshUpload prepareMeshUpload(const Mesh& mesh, bool packed) {
+    MeshUpload upload;
+    upload.packed = packed;
+    if (packed) {
+        PackedMeshInfo info = packVertices(mesh, upload.packedVertices);
+        upload.vertexBytes = upload.packedVertices.size() * sizeof(PackedVertex);
+        upload.positionScale = info.positionScale;
+        upload.positionOffset = info.positionOffset;
+    }
+    else {
+        upload.vertexBytes = mesh.vertices.size() * sizeof(Vertex);
+    }
+    const void* indexData;
+    upload.indexType = narrowIndices(mesh, upload.shortIndices, indexData, upload.indexBytes);
+    upload.indexCount = mesh.indices.size();
+    return upload;
+}
+
+void beginMeshUpload(const MeshUpload& upload, GpuMesh& gpuMesh) {
+    size_t vertexSize = upload.vertexBytes;
+    size_t indexSize = upload.indexBytes;
+    if (gpuMesh.VAO == 0) {
+        gpuMesh = createGpuMesh(nullptr, vertexSize, nullptr, indexSize, upload.packed);
+    }
+    else {
+        // Another model goes into the same VAO: buffers that are big enough are simply overwritten
+        glState().bindVertexArray(gpuMesh.VAO);
+        glState().bindBuffer(GL_ARRAY_BUFFER, gpuMesh.VBO);
+        if (vertexSize > gpuMesh.vertexCapacity) {
+            glBufferData(GL_ARRAY_BUFFER, vertexSize, nullptr, GL_STATIC_DRAW);
+            gpuMesh.vertexCapacity = vertexSize;
+            glState().countIssued();
+        }
+        if (indexSize > gpuMesh.indexCapacity) {
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize, nullptr, GL_STATIC_DRAW);
+            gpuMesh.indexCapacity = indexSize;
+            glState().countIssued();
+        }
+        if (upload.packed != gpuMesh.packed) {
+            setVertexLayout(upload.packed);
+            gpuMesh.packed = upload.packed;
+        }
+        glState().bindVertexArray(0);
+        glState().bindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    gpuMesh.indexType = upload.indexType;
+    gpuMesh.indexCount = static_cast<GLsizei>(upload.indexCount);
+    gpuMesh.positionScale = upload.positionScale;
+    gpuMesh.positionOffset = upload.positionOffset;
+}
+
+// One slice into buffer at offset: straight from memory, or staged in the ring and copied by the GPU
+static void uploadSlice(GLenum target, GLuint buffer, size_t offset, const uint8_t* data, size_t size, StreamRing* staging) {
+    if (!staging) {
+        glBufferSubData(target, offset, size, data);
+        glState().countIssued();
+        return;
+    }
+    size_t stagedOffset = staging->upload(data, size, 4);
+    glBindBuffer(GL_COPY_READ_BUFFER, staging->buffer());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, stagedOffset, offset, size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glState().countIssued(5);
+}
+
+bool continueMeshUpload(MeshUpload& upload, const Mesh& mesh, const GpuMesh& gpuMesh, size_t maxBytes, StreamRing* staging) {
+    const uint8_t* vertexData = upload.packed ? reinterpret_cast<const uint8_t*>(upload.packedVertices.data())
+        : reinterpret_cast<const uint8_t*>(mesh.vertices.data());
+    const uint8_t* indexData = upload.indexType == GL_UNSIGNED_SHORT ? reinterpret_cast<const uint8_t*>(upload.shortIndices.data())
+        : reinterpret_cast<const uint8_t*>(mesh.indices.data());
+
+    // Vertices first, so every index that arrives can be drawn right away
+    if (upload.uploadedVertexBytes < upload.vertexBytes) {
+        size_t size = std::min(maxBytes, upload.vertexBytes - upload.uploadedVertexBytes);
+        glState().bindBuffer(GL_ARRAY_BUFFER, gpuMesh.VBO);
+        uploadSlice(GL_ARRAY_BUFFER, gpuMesh.VBO, upload.uploadedVertexBytes, vertexData + upload.uploadedVertexBytes, size, staging);
+        upload.uploadedVertexBytes += size;
+        maxBytes -= size;
+    }
+    if (upload.uploadedVertexBytes == upload.vertexBytes && upload.uploadedIndexBytes < upload.indexBytes && maxBytes > 0) {
+        size_t size = std::min(maxBytes, upload.indexBytes - upload.uploadedIndexBytes);
+        glState().bindVertexArray(gpuMesh.VAO);
+        uploadSlice(GL_ELEMENT_ARRAY_BUFFER, gpuMesh.EBO, upload.uploadedIndexBytes, indexData + upload.uploadedIndexBytes, size, staging);
+        upload.uploadedIndexBytes += size;
+    }
+    if (staging) {
+        staging->endFrame();
+    }
+    return upload.uploadedVertexBytes == upload.vertexBytes && upload.uploadedIndexBytes == upload.indexBytes;
+}
+
+size_t uploadedTriangleIndices(const MeshUpload& upload) {
+    size_t indexSize = (upload.indexType == GL_UNSIGNED_SHORT) ? sizeof(uint16_t) : sizeof(uint32_t);
+    size_t indices = upload.uploadedIndexBytes / indexSize;
+    return indices - indices % 3;
+}
+
+void drawMesh(const GpuMesh& gpuMesh) {
+    glState().bindVertexArray(gpuMesh.VAO);
+    glDrawElements(GL_TRIANGLES, gpuMesh.indexCount, gpuMesh.indexType, (void*)0);
+    glState().countIssued();
+}
+
+// Draw only parts of the index buffer, all in a single call
+void drawMeshRanges(const GpuMesh& gpuMesh, const std::vector<IndexRange>& ranges) {
+    if (ranges.empty()) {
+        return;
+    }
+    size_t indexSize = (gpuMesh.indexType == GL_UNSIGNED_SHORT) ? sizeof(uint16_t) : sizeof(uint32_t);
+    std::vector<GLsizei> counts(ranges.size());
+    std::vector<const void*> offsets(ranges.size());
+    for (size_t i = 0; i < ranges.size(); i++) {
+        counts[i] = static_cast<GLsizei>(ranges[i].indexCount);
+        offsets[i] = reinterpret_cast<const void*>(static_cast<uintptr_t>(ranges[i].firstIndex) * indexSize);
+    }
+
+    glState().bindVertexArray(gpuMesh.VAO);
+    glMultiDrawElements(GL_TRIANGLES, counts.data(), gpuMesh.indexType, offsets.data(), static_cast<GLsizei>(ranges.size()));
+    glState().countIssued();
+}
+
+MeshDrawStats drawMeshView(const Mesh& mesh, const GpuMesh& gpuMesh, const glm::mat4& modelViewProjection, const glm::vec3& cameraInModel,
+    float fovyDegrees, int viewportHeight, std::vector<IndexRange>& ranges, OcclusionCuller* occlusion) {
+    MeshDrawStats stats;
+
+    // Pick the level of detail; all levels live in the same index buffer, so switching costs nothing
+    if (!mesh.lods.empty()) {
+        stats.lodLevel = selectMeshLod(mesh, cameraInModel, fovyDegrees, viewportHeight);
+    }
+
+    // Nothing to draw when the whole mesh is behind the occluders
+    if (occlusion && occlusion->ready()) {
+        size_t triangles = (mesh.lods.empty() ? mesh.indices.size() : mesh.lods[stats.lodLevel].indexCount) / 3;
+        if (!occlusion->boxVisible(modelViewProjection, mesh.boundsMin, mesh.boundsMax, triangles)) {
+            stats.occluded = true;
+            return stats;
+        }
+    }
+
+    // Draw the model, skipping chunks outside the view or meshlets facing away from the camera.
+    // Chunks and meshlets are built from the full-detail triangles, so a coarser level is culled as a whole;
+    // those levels are only picked while the mesh is small on screen, where it is nearly always entirely
+    // inside or outside the view anyway.
+    if (stats.lodLevel > 0 || (!mesh.lods.empty() && mesh.bvh.empty() && mesh.meshlets.empty())) {
+        if (boxInFrustum(extractFrustum(modelViewProjection), mesh.boundsMin, mesh.boundsMax) == FRUSTUM_OUTSIDE) {
+            stats.frustumCulled = true;
+            ranges.clear();
+            return stats;
+        }
+        ranges.assign(1, IndexRange{ mesh.lods[stats.lodLevel].firstIndex, mesh.lods[stats.lodLevel].indexCount });
+    }
+    else if (!mesh.bvh.empty()) {
+        stats.bvh = cullMeshBvh(mesh, extractFrustum(modelViewProjection), cameraInModel, ranges, occlusion, modelViewProjection);
+        stats.bvhCulled = true;
+    }
+    else if (!mesh.meshlets.empty()) {
+        stats.meshlets = cullMeshlets(mesh.meshlets, extractFrustum(modelViewProjection), cameraInModel, ranges);
+        stats.meshletsCulled = true;
+    }
+    else {
+        drawMesh(gpuMesh);
+        stats.triangles = static_cast<size_t>(gpuMesh.indexCount / 3);
+        stats.drawCalls = 1;
+        return stats;
+    }
+
+    drawMeshRanges(gpuMesh, ranges);
+    stats.drawCalls = ranges.empty() ? 0 : 1;
+    for (const IndexRange& range : ranges) {
+        stats.triangles += range.indexCount / 3;
+    }
+    return stats;
+}
+
+void destroyMesh(GpuMesh& gpuMesh) {
+    glState().forgetVertexArray(gpuMesh.VAO);
+    glState().forgetBuffer(gpuMesh.VBO);
+    glDeleteVertexArrays(1, &gpuMesh.VAO);
+    glDeleteBuffers(1, &gpuMesh.VBO);
+    glDeleteBuffers(1, &gpuMesh.EBO);
+    gpuMesh = GpuMesh();
+}
+
 // Function to load shader source from file
 std::string loadShaderSource(const std::string& filename) {
     std::ifstream file(filename);
@@ -131,12 +505,8 @@ GLuint compileShader(const std::string& source, GLenum shaderType) {
 
 
 // Function to create complete shader program
-GLuint createShaderProgram(const std::string& vertexSource, const std::string& fragmentSource) {
-    if (vertexSource.empty() || fragmentSource.empty()) {
-        std::cerr << "Empty shader source" << std::endl;
-        return 0;
-    }
-
+// Compile and link from source; the binary is kept retrievable for the shader cache
+static GLuint compileShaderProgram(const std::string& vertexSource, const std::string& fragmentSource) {
     // Compile shaders
     GLuint vertexShader = compileShader(vertexSource, GL_VERTEX_SHADER);
     GLuint fragmentShader = compileShader(fragmentSource, GL_FRAGMENT_SHADER);
@@ -151,6 +521,9 @@ GLuint createShaderProgram(const std::string& vertexSource, const std::string& f
     GLuint program = glCreateProgram();
     glAttachShader(program, vertexShader);
     glAttachShader(program, fragmentShader);
+    if (GLEW_ARB_get_program_binary) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     glLinkProgram(program);
 
     // Check linking status
@@ -169,25 +542,39 @@ GLuint createShaderProgram(const std::string& vertexSource, const std::string& f
     // Clean up
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
+    return program;
+}
 
-    // Add debug information
-    GLint numAttributes;
-    glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &numAttributes);
-    std::cout << "Maximum number of vertex attributes supported: " << numAttributes << std::endl;
+GLuint createShaderProgram(const std::string& vertexSource, const std::string& fragmentSource) {
+    if (vertexSource.empty() || fragmentSource.empty()) {
+        std::cerr << "Empty shader source" << std::endl;
+        return 0;
+    }
 
-    // Verify program attributes
-    GLint activeAttributes;
-    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &activeAttributes);
-    std::cout << "Number of active attributes: " << activeAttributes << std::endl;
+    // A program linked by an earlier run is used as is; otherwise compile and remember the result
+    auto start = std::chrono::steady_clock::now();
+    uint64_t key = shaderProgramKey(vertexSource, fragmentSource);
+    GLuint program = loadCachedProgram(key);
+    bool cached = program != 0;
+    if (!cached) {
+        program = compileShaderProgram(vertexSource, fragmentSource);
+        if (!program) {
+            return 0;
+        }
+        saveCachedProgram(key, program);
+    }
 
-    for (GLint i = 0; i < activeAttributes; i++) {
-        GLchar name[32];
-        GLint size;
-        GLenum type;
-        glGetActiveAttrib(program, i, sizeof(name), nullptr, &size, &type, name);
-        std::cout << "Attribute " << i << ": " << name << " (type: " << type << ")" << std::endl;
+    // Per-frame camera data comes from a uniform buffer shared by every program
+    GLuint cameraBlock = glGetUniformBlockIndex(program, "Camera");
+    if (cameraBlock != GL_INVALID_INDEX) {
+        glUniformBlockBinding(program, cameraBlock, CAMERA_BLOCK_BINDING);
     }
 
+    GLint activeAttributes;
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &activeAttributes);
+    std::cout << "Shader program " << (cached ? "loaded from cache" : "compiled") << " in "
+        << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms ("
+        << activeAttributes << " active attributes)" << std::endl;
     return program;
 }
 
@@ -223,8 +610,10 @@ std::string getDefaultVertexShader() {
         "out vec4 Color;\n"
         "\n"
         "uniform mat4 model;\n"
-        "uniform mat4 view;\n"
-        "uniform mat4 projection;\n"
+        "layout(std140) uniform Camera {\n"
+        "    mat4 view;\n"
+        "    mat4 projection;\n"
+        "};\n"
         "\n"
         "void main() {\n"
         "    gl_Position = projection * view * model * vec4(aPos, 1.0);\n"
@@ -234,6 +623,93 @@ std::string getDefaultVertexShader() {
         "}";
 }
 
+// Same as the default vertex shader, but positions arrive as snorm16 relative to the mesh bounds
+std::string getPackedVertexShader() {
+    return
+        "#version 330 core\n"
+        "layout(location = 0) in vec3 aPos;\n"
+        "layout(location = 1) in vec3 aNormal;\n"
+        "layout(location = 2) in vec2 aTexCoord;\n"
+        "layout(location = 3) in vec4 aColor;\n"
+        "\n"
+        "out vec3 Normal;\n"
+        "out vec2 TexCoord;\n"
+        "out vec4 Color;\n"
+        "\n"
+        "uniform mat4 model;\n"
+        "layout(std140) uniform Camera {\n"
+        "    mat4 view;\n"
+        "    mat4 projection;\n"
+        "};\n"
+        "uniform vec3 positionScale;\n"
+        "uniform vec3 positionOffset;\n"
+        "\n"
+        "void main() {\n"
+        "    vec3 position = aPos * positionScale + positionOffset;\n"
+        "    gl_Position = projection * view * model * vec4(position, 1.0);\n"
+        "    Normal = mat3(transpose(inverse(model))) * aNormal;\n"
+        "    TexCoord = aTexCoord;\n"
+        "    Color = aColor;\n"
+        "}";
+}
+
+// Scene shaders: the model matrix is a per-instance attribute (locations 4-7) instead of a uniform.
+// Instances only use uniform scale, so mat3(model) is enough to transform normals.
+std::string getInstancedVertexShader() {
+    return
+        "#version 330 core\n"
+        "layout(location = 0) in vec3 aPos;\n"
+        "layout(location = 1) in vec3 aNormal;\n"
+        "layout(location = 2) in vec2 aTexCoord;\n"
+        "layout(location = 3) in vec4 aColor;\n"
+        "layout(location = 4) in mat4 instanceModel;\n"
+        "\n"
+        "out vec3 Normal;\n"
+        "out vec2 TexCoord;\n"
+        "out vec4 Color;\n"
+        "\n"
+        "layout(std140) uniform Camera {\n"
+        "    mat4 view;\n"
+        "    mat4 projection;\n"
+        "};\n"
+        "\n"
+        "void main() {\n"
+        "    gl_Position = projection * view * instanceModel * vec4(aPos, 1.0);\n"
+        "    Normal = mat3(instanceModel) * aNormal;\n"
+        "    TexCoord = aTexCoord;\n"
+        "    Color = aColor;\n"
+        "}";
+}
+
+std::string getPackedInstancedVertexShader() {
+    return
+        "#version 330 core\n"
+        "layout(location = 0) in vec3 aPos;\n"
+        "layout(location = 1) in vec3 aNormal;\n"
+        "layout(location = 2) in vec2 aTexCoord;\n"
+        "layout(location = 3) in vec4 aColor;\n"
+        "layout(location = 4) in mat4 instanceModel;\n"
+        "\n"
+        "out vec3 Normal;\n"
+        "out vec2 TexCoord;\n"
+        "out vec4 Color;\n"
+        "\n"
+        "layout(std140) uniform Camera {\n"
+        "    mat4 view;\n"
+        "    mat4 projection;\n"
+        "};\n"
+        "uniform vec3 positionScale;\n"
+        "uniform vec3 positionOffset;\n"
+        "\n"
+        "void main() {\n"
+        "    vec3 position = aPos * positionScale + positionOffset;\n"
+        "    gl_Position = projection * view * instanceModel * vec4(position, 1.0);\n"
+        "    Normal = mat3(instanceModel) * aNormal;\n"
+        "    TexCoord = aTexCoord;\n"
+        "    Color = aColor;\n"
+        "}";
+}
+
 std::string getDefaultFragmentShader() {
     return
         "#version 330 core\n"
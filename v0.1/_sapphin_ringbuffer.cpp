@@ -0,0 +1,168 @@
+// _sapphin_ringbuffer.cpp
+// This streams per-frame data to the GPU through a fenced ring buffer.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+
+#include <iostream>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+// Headers
+#include "headers/_sapphin_ringbuffer.h"
+#include "headers/_sapphin_glstate.h"
+#include "lib/GLEW.win32/GLEW-lib/include/GL/glew.h"
+
+// The ring is bound to GL_COPY_WRITE_BUFFER for its own calls, so the state cache's GL_ARRAY_BUFFER stays valid
+
+bool StreamRing::create(size_t bytesPerFrame) {
+    destroy();
+    persistent = GLEW_ARB_buffer_storage != 0;
+    allocate(std::max<size_t>(bytesPerFrame, 256));
+    if (ringBuffer == 0) {
+        std::cerr << "Failed to create the stream ring buffer" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void StreamRing::allocate(size_t newSegmentSize) {
+    // The old buffer may still be read by queued draws; GL deletes it once they're done
+    if (ringBuffer != 0) {
+        releaseFences();
+        glState().forgetBuffer(ringBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ringBuffer);
+        if (mapped) {
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            mapped = nullptr;
+        }
+        glDeleteBuffers(1, &ringBuffer);
+        ringBuffer = 0;
+    }
+
+    // Keeps every part, and so every upload offset, aligned
+    segmentSize = (newSegmentSize + 255) / 256 * 256;
+    head = 0;
+    glGenBuffers(1, &ringBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ringBuffer);
+    if (persistent) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        GLsizeiptr size = static_cast<GLsizeiptr>(segmentSize * STREAM_RING_FRAMES);
+        glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+        mapped = static_cast<uint8_t*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+        if (!mapped) {
+            // Some drivers expose the extension but refuse the mapping; the fallback still works
+            std::cerr << "Persistent mapping failed, streaming with glBufferSubData" << std::endl;
+            glDeleteBuffers(1, &ringBuffer);
+            persistent = false;
+            glGenBuffers(1, &ringBuffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, ringBuffer);
+        }
+    }
+    if (!persistent) {
+        glBufferData(GL_COPY_WRITE_BUFFER, segmentSize, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void StreamRing::releaseFences() {
+    for (GLsync& fence : fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+}
+
+void StreamRing::destroy() {
+    if (ringBuffer != 0) {
+        releaseFences();
+        glState().forgetBuffer(ringBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ringBuffer);
+        if (mapped) {
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glDeleteBuffers(1, &ringBuffer);
+    }
+    ringBuffer = 0;
+    mapped = nullptr;
+    segmentSize = 0;
+    segment = 0;
+    head = 0;
+    frameStarted = false;
+}
+
+void StreamRing::beginFrame() {
+    frameStarted = true;
+    head = 0;
+    stats.frames++;
+
+    if (!persistent) {
+        // Orphan: queued draws keep the old storage, this frame gets new storage without waiting
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ringBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, segmentSize, nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return;
+    }
+
+    // Wait until the GPU is done with what was written here STREAM_RING_FRAMES frames ago
+    GLsync& fence = fences[segment];
+    if (fence) {
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED) {
+            auto start = std::chrono::steady_clock::now();
+            do {
+                result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            } while (result == GL_TIMEOUT_EXPIRED);
+            stats.stalls++;
+            stats.waitMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+size_t StreamRing::upload(const void* data, size_t size, size_t alignment) {
+    if (!frameStarted) {
+        beginFrame();
+    }
+
+    size_t offset = (head + alignment - 1) / alignment * alignment;
+    if (offset + size > segmentSize) {
+        // Too much for one frame: switch to a bigger buffer. Data uploaded earlier this frame lives on in the
+        // old one, which the draws issued so far keep referencing.
+        allocate(std::max(segmentSize * 2, size + alignment));
+        offset = 0;
+    }
+
+    if (persistent) {
+        offset += segment * segmentSize;
+        memcpy(mapped + offset, data, size);
+        head = offset - segment * segmentSize + size;
+    }
+    else {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ringBuffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        head = offset + size;
+    }
+    stats.bytesUploaded += size;
+    return offset;
+}
+
+void StreamRing::endFrame() {
+    if (!frameStarted) {
+        return;
+    }
+    if (persistent) {
+        fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        segment = (segment + 1) % STREAM_RING_FRAMES;
+    }
+    frameStarted = false;
+}
+
+StreamStats StreamRing::takeStats() {
+    StreamStats taken = stats;
+    stats = StreamStats();
+    return taken;
+}
@@ -0,0 +1,285 @@
+// _sapphin_scene.cpp
+// This loads scenes of placed model copies and draws each mesh once for all of its visible copies.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <algorithm>
+
+// Headers
+#include "headers/_sapphin_scene.h"
+#include "headers/_sapphin_modeling.h"
+#include "headers/_sapphin_render.h"
+#include "headers/_sapphin_culling.h"
+#include "headers/_sapphin_occlusion.h"
+#include "headers/_sapphin_lod.h"
+#include "headers/_sapphin_glstate.h"
+#include "headers/_sapphin_types.h"
+#include "lib/GLEW.win32/GLEW-lib/include/GL/glew.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+#include "lib/GLM.win32/GLM-lib/glm/gtc/matrix_transform.hpp"
+#include "lib/GLM.win32/GLM-lib/glm/gtc/type_ptr.hpp"
+
+// First vertex attribute of the per-instance model matrix (one column per location)
+const GLuint INSTANCE_ATTRIBUTE = 4;
+
+glm::mat4 instanceTransform(const SceneInstance& instance) {
+    glm::mat4 transform = glm::translate(glm::mat4(1.0f), instance.position);
+    transform = glm::rotate(transform, glm::radians(instance.yaw), glm::vec3(0.0f, 1.0f, 0.0f));
+    return glm::scale(transform, glm::vec3(instance.scale));
+}
+
+bool loadScene(const std::string& filename, Scene& scene, uint32_t processingFlags) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open scene file: " << filename << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        std::istringstream stream(line);
+        std::string command;
+        if (!(stream >> command) || command[0] == '#') {
+            continue;
+        }
+
+        if (command == "mesh") {
+            std::string name, path;
+            if (!(stream >> name >> path)) {
+                std::cerr << filename << ":" << lineNumber << ": expected 'mesh <name> <file.obj>'" << std::endl;
+                return false;
+            }
+            Mesh mesh = loadMeshCached(path, processingFlags);
+            if (mesh.indices.empty()) {
+                std::cerr << filename << ":" << lineNumber << ": could not load " << path << std::endl;
+                return false;
+            }
+            scene.meshes.push_back(std::move(mesh));
+            scene.meshNames.push_back(name);
+        }
+        else if (command == "instance") {
+            std::string name;
+            SceneInstance instance = { 0, glm::vec3(0.0f), 0.0f, 1.0f };
+            if (!(stream >> name >> instance.position.x >> instance.position.y >> instance.position.z)) {
+                std::cerr << filename << ":" << lineNumber << ": expected 'instance <name> <x> <y> <z> [yaw] [scale]'" << std::endl;
+                return false;
+            }
+            if (stream >> instance.yaw) {
+                stream >> instance.scale;
+            }
+
+            auto found = std::find(scene.meshNames.begin(), scene.meshNames.end(), name);
+            if (found == scene.meshNames.end()) {
+                std::cerr << filename << ":" << lineNumber << ": unknown mesh '" << name << "'" << std::endl;
+                return false;
+            }
+            instance.mesh = static_cast<uint32_t>(found - scene.meshNames.begin());
+            scene.instances.push_back(instance);
+        }
+        else if (command == "occluder") {
+            std::string name;
+            if (!(stream >> name)) {
+                std::cerr << filename << ":" << lineNumber << ": expected 'occluder <name>'" << std::endl;
+                return false;
+            }
+            auto found = std::find(scene.meshNames.begin(), scene.meshNames.end(), name);
+            if (found == scene.meshNames.end()) {
+                std::cerr << filename << ":" << lineNumber << ": unknown mesh '" << name << "'" << std::endl;
+                return false;
+            }
+            scene.occluderMeshes.push_back(static_cast<uint32_t>(found - scene.meshNames.begin()));
+        }
+        else {
+            std::cerr << filename << ":" << lineNumber << ": unknown command '" << command << "'" << std::endl;
+            return false;
+        }
+    }
+
+    std::cout << "Scene: " << scene.meshes.size() << " meshes, " << scene.instances.size() << " instances" << std::endl;
+    return true;
+}
+
+void addGridInstances(Scene& scene, uint32_t mesh, size_t count) {
+    const Mesh& source = scene.meshes[mesh];
+    glm::vec3 extent = source.boundsMax - source.boundsMin;
+    float spacing = std::max(std::max(extent.x, extent.z), 1e-3f) * 1.5f;
+    size_t side = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+
+    for (size_t i = 0; i < count; i++) {
+        SceneInstance instance;
+        instance.mesh = mesh;
+        instance.position = glm::vec3((i % side) * spacing, 0.0f, -static_cast<float>(i / side) * spacing);
+        instance.yaw = static_cast<float>((i * 37) % 360);
+        instance.scale = 1.0f;
+        scene.instances.push_back(instance);
+    }
+}
+
+// Index range drawn for a mesh at a level of detail
+static IndexRange lodRange(const Mesh& mesh, const GpuMesh& gpuMesh, size_t level) {
+    if (mesh.lods.empty()) {
+        return { 0, static_cast<uint32_t>(gpuMesh.indexCount) };
+    }
+    return { mesh.lods[level].firstIndex, mesh.lods[level].indexCount };
+}
+
+GpuScene uploadScene(const Scene& scene, bool packed) {
+    GpuScene gpuScene;
+    for (const Mesh& mesh : scene.meshes) {
+        gpuScene.meshes.push_back(packed ? uploadPackedMesh(mesh) : uploadMesh(mesh));
+    }
+
+    // Per-instance transforms; the attribute offsets are set per draw once the frame's layout is known
+    gpuScene.instanceRing.create(scene.instances.size() * sizeof(glm::mat4));
+    for (const GpuMesh& gpuMesh : gpuScene.meshes) {
+        glState().bindVertexArray(gpuMesh.VAO);
+        for (GLuint column = 0; column < 4; column++) {
+            glEnableVertexAttribArray(INSTANCE_ATTRIBUTE + column);
+            glVertexAttribDivisor(INSTANCE_ATTRIBUTE + column, 1);
+        }
+    }
+    glState().bindVertexArray(0);
+    return gpuScene;
+}
+
+void prepareOcclusion(OcclusionCuller& occlusion, const Scene& scene, const Mesh& occluderMesh, const glm::mat4& view,
+    const glm::mat4& projection, int framebufferWidth, int framebufferHeight) {
+    occlusion.beginFrame(view, projection, framebufferWidth, framebufferHeight);
+    if (!occluderMesh.indices.empty()) {
+        occlusion.addOccluder(occluderMesh, glm::mat4(1.0f));
+    }
+
+    // Occluder instances in view, nearest first, so the budget goes to the ones that hide the most
+    Frustum frustum = extractFrustum(occlusion.frameViewProjection());
+    glm::vec3 cameraPosition = glm::vec3(glm::inverse(view)[3]);
+    std::vector<std::pair<float, size_t>> occluders;
+    for (size_t i = 0; i < scene.instances.size(); i++) {
+        const SceneInstance& instance = scene.instances[i];
+        if (!scene.occluderMeshes.empty() &&
+            std::find(scene.occluderMeshes.begin(), scene.occluderMeshes.end(), instance.mesh) == scene.occluderMeshes.end()) {
+            continue;
+        }
+        const Mesh& mesh = scene.meshes[instance.mesh];
+        glm::vec3 center = glm::vec3(instanceTransform(instance) * glm::vec4((mesh.boundsMin + mesh.boundsMax) * 0.5f, 1.0f));
+        float radius = glm::length(mesh.boundsMax - mesh.boundsMin) * 0.5f * instance.scale;
+        if (sphereInFrustum(frustum, center, radius)) {
+            occluders.push_back({ glm::length(center - cameraPosition) - radius, i });
+        }
+    }
+    std::sort(occluders.begin(), occluders.end());
+    for (const auto& occluder : occluders) {
+        const SceneInstance& instance = scene.instances[occluder.second];
+        occlusion.addOccluder(scene.meshes[instance.mesh], instanceTransform(instance));
+    }
+    occlusion.finish();
+}
+
+SceneDrawStats drawScene(GpuScene& gpuScene, const Scene& scene, const Frustum& frustum, const glm::vec3& cameraPosition,
+    float fovyDegrees, int viewportHeight, GLuint shaderProgram, OcclusionCuller* occlusion) {
+    SceneDrawStats stats;
+
+    // Bucket visible instances by mesh and level of detail
+    std::vector<size_t> bucketStart(scene.meshes.size() + 1, 0);
+    for (size_t m = 0; m < scene.meshes.size(); m++) {
+        bucketStart[m + 1] = bucketStart[m] + std::max<size_t>(1, scene.meshes[m].lods.size());
+    }
+    std::vector<std::vector<glm::mat4>> buckets(bucketStart.back());
+
+    for (const SceneInstance& instance : scene.instances) {
+        const Mesh& mesh = scene.meshes[instance.mesh];
+        glm::mat4 transform = instanceTransform(instance);
+        glm::vec3 localCenter = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+        glm::vec3 center = glm::vec3(transform * glm::vec4(localCenter, 1.0f));
+        float radius = glm::length(mesh.boundsMax - mesh.boundsMin) * 0.5f * instance.scale;
+        if (!sphereInFrustum(frustum, center, radius)) {
+            stats.culledInstances++;
+            continue;
+        }
+
+        size_t level = 0;
+        if (!mesh.lods.empty() && instance.scale > 0.0f) {
+            // Camera in the instance's model space (the transform is rigid apart from the uniform scale)
+            glm::vec3 offset = cameraPosition - instance.position;
+            float angle = glm::radians(-instance.yaw);
+            glm::vec3 local(std::cos(angle) * offset.x + std::sin(angle) * offset.z, offset.y,
+                -std::sin(angle) * offset.x + std::cos(angle) * offset.z);
+            level = selectMeshLod(mesh, local / instance.scale, fovyDegrees, viewportHeight);
+        }
+        if (occlusion && occlusion->ready()) {
+            size_t triangles = (mesh.lods.empty() ? mesh.indices.size() : mesh.lods[level].indexCount) / 3;
+            if (!occlusion->boxVisible(occlusion->frameViewProjection() * transform, mesh.boundsMin, mesh.boundsMax, triangles)) {
+                stats.occludedInstances++;
+                continue;
+            }
+        }
+        stats.visibleInstances++;
+        buckets[bucketStart[instance.mesh] + level].push_back(transform);
+    }
+
+    // Stream this frame's transforms into the ring; frames still queued on the GPU read other parts of it
+    gpuScene.transforms.clear();
+    for (const std::vector<glm::mat4>& bucket : buckets) {
+        gpuScene.transforms.insert(gpuScene.transforms.end(), bucket.begin(), bucket.end());
+    }
+    if (gpuScene.transforms.empty()) {
+        return stats;
+    }
+    stats.streamedBytes = gpuScene.transforms.size() * sizeof(glm::mat4);
+    size_t ringOffset = gpuScene.instanceRing.upload(gpuScene.transforms.data(), stats.streamedBytes, sizeof(glm::mat4));
+    glState().bindBuffer(GL_ARRAY_BUFFER, gpuScene.instanceRing.buffer());
+
+    const ProgramUniforms& uniforms = glState().uniforms(shaderProgram);
+
+    size_t firstInstance = 0;
+    for (size_t m = 0; m < scene.meshes.size(); m++) {
+        const GpuMesh& gpuMesh = gpuScene.meshes[m];
+        glState().bindVertexArray(gpuMesh.VAO);
+        if (gpuMesh.packed) {
+            glState().uniform3(uniforms.positionScale, gpuMesh.positionScale);
+            glState().uniform3(uniforms.positionOffset, gpuMesh.positionOffset);
+        }
+
+        for (size_t bucket = bucketStart[m]; bucket < bucketStart[m + 1]; bucket++) {
+            GLsizei instanceCount = static_cast<GLsizei>(buckets[bucket].size());
+            if (instanceCount == 0) continue;
+
+            // GL 3.3 has no base instance, so the attributes point at this batch's first transform instead
+            size_t offset = ringOffset + firstInstance * sizeof(glm::mat4);
+            for (GLuint column = 0; column < 4; column++) {
+                glVertexAttribPointer(INSTANCE_ATTRIBUTE + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                    (void*)(offset + column * sizeof(glm::vec4)));
+            }
+
+            IndexRange range = lodRange(scene.meshes[m], gpuMesh, bucket - bucketStart[m]);
+            size_t indexSize = (gpuMesh.indexType == GL_UNSIGNED_SHORT) ? sizeof(uint16_t) : sizeof(uint32_t);
+            glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(range.indexCount), gpuMesh.indexType,
+                (void*)(static_cast<size_t>(range.firstIndex) * indexSize), instanceCount);
+            glState().countIssued(5);
+
+            stats.drawCalls++;
+            stats.triangles += static_cast<size_t>(range.indexCount / 3) * instanceCount;
+            firstInstance += instanceCount;
+        }
+    }
+    glState().bindVertexArray(0);
+    glState().bindBuffer(GL_ARRAY_BUFFER, 0);
+    gpuScene.instanceRing.endFrame();
+    return stats;
+}
+
+void destroyScene(GpuScene& gpuScene) {
+    for (GpuMesh& gpuMesh : gpuScene.meshes) {
+        destroyMesh(gpuMesh);
+    }
+    gpuScene.instanceRing.destroy();
+    gpuScene = GpuScene();
+}
@@ -0,0 +1,140 @@
+// _sapphin_shadercache.cpp
+// This stores linked shader programs on disk, so later runs skip compiling and linking GLSL.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+
+// Headers
+#include "headers/_sapphin_shadercache.h"
+#include "headers/_sapphin_utils.h"
+#include "lib/GLEW.win32/GLEW-lib/include/GL/glew.h"
+
+static const char SHADER_CACHE_MAGIC[8] = { 'S', 'A', 'P', 'P', 'R', 'O', 'G', '\0' };
+
+// One file per program: "shaders/cache/0123456789abcdef.sapprog"
+static std::string shaderCachePath(uint64_t key) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.sapprog", static_cast<unsigned long long>(key));
+    return (std::filesystem::path(SHADER_CACHE_DIRECTORY) / name).string();
+}
+
+bool shaderCacheSupported() {
+    if (!GLEW_ARB_get_program_binary) {
+        return false;
+    }
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+uint64_t shaderProgramKey(const std::string& vertexSource, const std::string& fragmentSource) {
+    uint64_t key = hashBytes(vertexSource.data(), vertexSource.size());
+    key = hashBytes(fragmentSource.data(), fragmentSource.size(), key);
+    for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+        const char* value = reinterpret_cast<const char*>(glGetString(name));
+        if (value) {
+            key = hashBytes(value, strlen(value), key);
+        }
+    }
+    return key;
+}
+
+GLuint loadCachedProgram(uint64_t key) {
+    if (!shaderCacheSupported()) {
+        return 0;
+    }
+    MappedFile cache;
+    if (!cache.open(shaderCachePath(key))) {
+        return 0;  // Not cached yet
+    }
+
+    ShaderCacheHeader header;
+    if (cache.size() < sizeof(header)) {
+        std::cout << "Shader cache entry is corrupt, compiling." << std::endl;
+        return 0;
+    }
+    memcpy(&header, cache.data(), sizeof(header));
+    const char* binary = cache.data() + sizeof(header);
+    if (memcmp(header.magic, SHADER_CACHE_MAGIC, sizeof(SHADER_CACHE_MAGIC)) != 0 || header.version != SHADER_CACHE_VERSION ||
+        header.key != key || header.binarySize != cache.size() - sizeof(header) ||
+        header.binaryHash != hashBytes(binary, static_cast<size_t>(header.binarySize))) {
+        std::cout << "Shader cache entry is corrupt, compiling." << std::endl;
+        return 0;
+    }
+
+    // Drivers may refuse binaries they wrote themselves (after an update, for instance); that is not an error
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.binaryFormat, binary, static_cast<GLsizei>(header.binarySize));
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        std::cout << "Driver rejected the cached shader program, compiling." << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+bool saveCachedProgram(uint64_t key, GLuint program) {
+    if (!shaderCacheSupported()) {
+        return false;
+    }
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return false;
+    }
+    std::vector<uint8_t> binary(static_cast<size_t>(length));
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &written, &format, binary.data());
+    if (written <= 0) {
+        return false;
+    }
+    binary.resize(static_cast<size_t>(written));
+
+    ShaderCacheHeader header = {};
+    memcpy(header.magic, SHADER_CACHE_MAGIC, sizeof(SHADER_CACHE_MAGIC));
+    header.version = SHADER_CACHE_VERSION;
+    header.binaryFormat = format;
+    header.key = key;
+    header.binarySize = binary.size();
+    header.binaryHash = hashBytes(binary.data(), binary.size());
+
+    std::error_code error;
+    std::filesystem::create_directories(SHADER_CACHE_DIRECTORY, error);
+    if (error) {
+        std::cerr << "Failed to create " << SHADER_CACHE_DIRECTORY << ": " << error.message() << std::endl;
+        return false;
+    }
+
+    // Write to a temporary file first so a crash never leaves a half-written entry behind
+    std::string cachePath = shaderCachePath(key);
+    std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(binary.data()), binary.size());
+        if (!file.good()) {
+            file.close();
+            std::filesystem::remove(tempPath, error);
+            return false;
+        }
+    }
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
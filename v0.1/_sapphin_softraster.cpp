@@ -0,0 +1,564 @@
+// _sapphin_softraster.cpp
+// This rasterizes meshes on the CPU: triangles are sorted into screen tiles and the tiles are shaded in parallel.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SAPPHIN_SOFTRASTER_SSE2
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Headers
+#include "headers/_sapphin_softraster.h"
+#include "headers/_sapphin_utils.h"
+#include "headers/_sapphin_types.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+#include "lib/GLM.win32/GLM-lib/glm/gtc/matrix_transform.hpp"
+
+// Vertices per vertex-stage task, and triangles per setup and binning task
+static const size_t SOFTWARE_VERTEX_BLOCK = 1 << 14;
+static const size_t SOFTWARE_BIN_BLOCK = 1 << 13;
+
+// Draws smaller than this run on the calling thread; starting the workers would cost more than the work
+static const size_t SOFTWARE_PARALLEL_TRIANGLES = 1 << 14;
+
+// Window coordinates carry this many fractional bits (16 sub-pixel positions per pixel)
+static const int SUBPIXEL_BITS = 4;
+static const int SUBPIXEL_SCALE = 1 << SUBPIXEL_BITS;
+static const int SUBPIXEL_HALF = SUBPIXEL_SCALE / 2;
+
+static_assert(SOFTWARE_TILE_SIZE == 64, "Tile rows are covered by one 64-bit mask");
+
+// The lighting of getDefaultFragmentShader()
+static const float AMBIENT = 0.3f;
+static const float DIFFUSE = 0.7f;
+static const glm::vec3 LIGHT_DIRECTION = glm::normalize(glm::vec3(1.0f, 1.0f, 1.0f));
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static inline int lowestBit(uint64_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+// Coverage and depth test of `pixels` consecutive pixels of a row. edge holds the three edge functions
+// at the first pixel (a pixel is inside when all are >= 0) and stepX their change per pixel; depthRow
+// may be read up to the next multiple of the lane count. Bit i of the result is set when pixel i is
+// inside the triangle and closer than the depth buffer.
+#if defined(__AVX2__)
+static const int SOFTWARE_LANES = 8;
+
+static uint64_t coverageRow(const int32_t edge[3], const int32_t stepX[3], float depth, float depthStep, const float* depthRow, int pixels) {
+    __m256i e[3], groupStep[3];
+    for (int i = 0; i < 3; i++) {
+        e[i] = _mm256_add_epi32(_mm256_set1_epi32(edge[i]),
+            _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stepX[i])));
+        groupStep[i] = _mm256_set1_epi32(stepX[i] * 8);
+    }
+    const __m256i outside = _mm256_set1_epi32(-1);
+    const __m256 depthBase = _mm256_set1_ps(depth);
+    const __m256 depthSlope = _mm256_set1_ps(depthStep);
+    __m256 lane = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+
+    uint64_t mask = 0;
+    for (int x = 0; x < pixels; x += 8) {
+        __m256i inside = _mm256_and_si256(_mm256_and_si256(_mm256_cmpgt_epi32(e[0], outside), _mm256_cmpgt_epi32(e[1], outside)),
+            _mm256_cmpgt_epi32(e[2], outside));
+        if (!_mm256_testz_si256(inside, inside)) {
+            __m256 z = _mm256_add_ps(depthBase, _mm256_mul_ps(lane, depthSlope));
+            __m256 closer = _mm256_cmp_ps(z, _mm256_loadu_ps(depthRow + x), _CMP_LT_OQ);
+            mask |= static_cast<uint64_t>(_mm256_movemask_ps(_mm256_and_ps(_mm256_castsi256_ps(inside), closer))) << x;
+        }
+        for (int i = 0; i < 3; i++) {
+            e[i] = _mm256_add_epi32(e[i], groupStep[i]);
+        }
+        lane = _mm256_add_ps(lane, _mm256_set1_ps(8.0f));
+    }
+    return mask;
+}
+#elif defined(SAPPHIN_SOFTRASTER_SSE2)
+static const int SOFTWARE_LANES = 4;
+
+static uint64_t coverageRow(const int32_t edge[3], const int32_t stepX[3], float depth, float depthStep, const float* depthRow, int pixels) {
+    __m128i e[3], groupStep[3];
+    for (int i = 0; i < 3; i++) {
+        // SSE2 has no 32-bit multiply, so the lane offsets are built on the scalar side
+        e[i] = _mm_setr_epi32(edge[i], edge[i] + stepX[i], edge[i] + 2 * stepX[i], edge[i] + 3 * stepX[i]);
+        groupStep[i] = _mm_set1_epi32(stepX[i] * 4);
+    }
+    const __m128i outside = _mm_set1_epi32(-1);
+    const __m128 depthBase = _mm_set1_ps(depth);
+    const __m128 depthSlope = _mm_set1_ps(depthStep);
+    __m128 lane = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+
+    uint64_t mask = 0;
+    for (int x = 0; x < pixels; x += 4) {
+        __m128i inside = _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi32(e[0], outside), _mm_cmpgt_epi32(e[1], outside)),
+            _mm_cmpgt_epi32(e[2], outside));
+        if (_mm_movemask_epi8(inside) != 0) {
+            __m128 z = _mm_add_ps(depthBase, _mm_mul_ps(lane, depthSlope));
+            __m128 closer = _mm_cmplt_ps(z, _mm_loadu_ps(depthRow + x));
+            mask |= static_cast<uint64_t>(_mm_movemask_ps(_mm_and_ps(_mm_castsi128_ps(inside), closer))) << x;
+        }
+        for (int i = 0; i < 3; i++) {
+            e[i] = _mm_add_epi32(e[i], groupStep[i]);
+        }
+        lane = _mm_add_ps(lane, _mm_set1_ps(4.0f));
+    }
+    return mask;
+}
+#else
+static const int SOFTWARE_LANES = 1;
+
+static uint64_t coverageRow(const int32_t edge[3], const int32_t stepX[3], float depth, float depthStep, const float* depthRow, int pixels) {
+    uint64_t mask = 0;
+    for (int x = 0; x < pixels; x++) {
+        bool inside = edge[0] + x * stepX[0] >= 0 && edge[1] + x * stepX[1] >= 0 && edge[2] + x * stepX[2] >= 0;
+        if (inside && depth + static_cast<float>(x) * depthStep < depthRow[x]) {
+            mask |= uint64_t(1) << x;
+        }
+    }
+    return mask;
+}
+#endif
+
+const char* SoftwareRasterizer::kernelName() {
+#if defined(__AVX2__)
+    return "AVX2";
+#elif defined(SAPPHIN_SOFTRASTER_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+static inline uint8_t toUnorm8(float value) {
+    return static_cast<uint8_t>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+bool SoftwareRasterizer::create(int width, int height, unsigned threads, bool depthOnlyTarget) {
+    if (width <= 0 || height <= 0 || width > SOFTWARE_MAX_SIZE || height > SOFTWARE_MAX_SIZE) {
+        std::cerr << "Software rasterizer: unsupported framebuffer size " << width << "x" << height << std::endl;
+        return false;
+    }
+    framebufferWidth = width;
+    framebufferHeight = height;
+    tilesX = (width + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+    tilesY = (height + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+    stride = tilesX * SOFTWARE_TILE_SIZE;
+    threadCount = resolveThreadCount(threads);
+    workers.start(threadCount);
+    depthOnly = depthOnlyTarget;
+
+    // Clip x and y at the guard band, so window coordinates stay within +-SOFTWARE_MAX_SIZE pixels
+    guardBand = 2.0f * SOFTWARE_MAX_SIZE / static_cast<float>(std::max(width, height)) - 1.0f;
+
+    color.assign(depthOnly ? 0 : static_cast<size_t>(stride) * height * 4, 0);
+    depth.assign(static_cast<size_t>(stride) * height, 1.0f);
+    tilePixels.assign(static_cast<size_t>(tilesX) * tilesY, 0);
+    blocks.clear();
+    usedBlocks = 0;
+    clearPending = false;
+    stats = SoftwareRasterStats();
+    return true;
+}
+
+void SoftwareRasterizer::clear(const glm::vec4& clearValue) {
+    clearColor = clearValue;
+    clearPending = true;
+}
+
+void SoftwareRasterizer::setCamera(const glm::mat4& view, const glm::mat4& projection) {
+    viewProjection = projection * view;
+}
+
+size_t SoftwareRasterizer::draw(const Mesh& mesh, const glm::mat4& model) {
+    // Meshes with levels of detail keep the full-detail triangles first
+    size_t indexCount = mesh.lods.empty() ? mesh.indices.size() : mesh.lods[0].indexCount;
+    return draw(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), indexCount, model);
+}
+
+size_t SoftwareRasterizer::draw(const Vertex* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount,
+    const glm::mat4& model) {
+    size_t triangleCount = indices ? indexCount / 3 : vertexCount / 3;
+    if (framebufferWidth == 0 || triangleCount == 0) {
+        return 0;
+    }
+    auto start = std::chrono::steady_clock::now();
+    unsigned threads = triangleCount >= SOFTWARE_PARALLEL_TRIANGLES ? threadCount : 1;
+
+    // Vertex stage, as in getDefaultVertexShader()
+    const glm::mat4 clipMatrix = viewProjection * model;
+    const glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(model)));
+    shadedVertices.resize(vertexCount);
+    workers.parallelFor((vertexCount + SOFTWARE_VERTEX_BLOCK - 1) / SOFTWARE_VERTEX_BLOCK, threads, [&](size_t block) {
+        size_t last = std::min(vertexCount, (block + 1) * SOFTWARE_VERTEX_BLOCK);
+        for (size_t i = block * SOFTWARE_VERTEX_BLOCK; i < last; i++) {
+            const Vertex& vertex = vertices[i];
+            ShadedVertex& shaded = shadedVertices[i];
+            shaded.clip = clipMatrix * glm::vec4(vertex.x, vertex.y, vertex.z, 1.0f);
+            if (depthOnly) {
+                continue;
+            }
+            shaded.normal = normalMatrix * glm::vec3(vertex.nx, vertex.ny, vertex.nz);
+            shaded.color = glm::vec4(vertex.r, vertex.g, vertex.b, vertex.a);
+        }
+    });
+
+    // Clipping, setup and binning; every task fills its own block, so no locks are needed
+    size_t blockCount = (triangleCount + SOFTWARE_BIN_BLOCK - 1) / SOFTWARE_BIN_BLOCK;
+    if (blocks.size() < usedBlocks + blockCount) {
+        blocks.resize(usedBlocks + blockCount);
+    }
+    const size_t tileCount = static_cast<size_t>(tilesX) * tilesY;
+    workers.parallelFor(blockCount, threads, [&](size_t b) {
+        BinBlock& block = blocks[usedBlocks + b];
+        block.bins.resize(tileCount);
+        size_t last = std::min(triangleCount, (b + 1) * SOFTWARE_BIN_BLOCK);
+        for (size_t triangle = b * SOFTWARE_BIN_BLOCK; triangle < last; triangle++) {
+            size_t corner[3];
+            for (int i = 0; i < 3; i++) {
+                corner[i] = indices ? indices[triangle * 3 + i] : triangle * 3 + i;
+            }
+            if (corner[0] >= vertexCount || corner[1] >= vertexCount || corner[2] >= vertexCount) {
+                continue;
+            }
+            const ShadedVertex& a = shadedVertices[corner[0]];
+            const ShadedVertex& b = shadedVertices[corner[1]];
+            const ShadedVertex& c = shadedVertices[corner[2]];
+
+            // Outcodes: bits 0-3 outside the view in x and y, 4 behind the near plane, 5 beyond the far plane;
+            // bit 6 and up mark vertices outside the guard band, which must be clipped before setup
+            unsigned outcode[3];
+            const ShadedVertex* corners[3] = { &a, &b, &c };
+            for (int i = 0; i < 3; i++) {
+                const glm::vec4& p = corners[i]->clip;
+                float guard = guardBand * p.w;
+                outcode[i] = (p.x < -p.w) | (p.x > p.w) << 1 | (p.y < -p.w) << 2 | (p.y > p.w) << 3 |
+                    (p.z < -p.w) << 4 | (p.z > p.w) << 5 | (p.x < -guard || p.x > guard || p.y < -guard || p.y > guard) << 6;
+            }
+            if ((outcode[0] & outcode[1] & outcode[2] & 0x3F) != 0) {
+                continue;  // Entirely on the outside of one plane
+            }
+            if (((outcode[0] | outcode[1] | outcode[2]) & (1 << 4 | 1 << 6)) != 0) {
+                clipTriangle(a, b, c, block);
+            }
+            else {
+                setupTriangle(a, b, c, block);
+            }
+        }
+    });
+    usedBlocks += blockCount;
+
+    stats.trianglesSubmitted += triangleCount;
+    stats.geometryMilliseconds += millisecondsSince(start);
+    return triangleCount;
+}
+
+// Cut the triangle at the near plane and the guard band (Sutherland-Hodgman in clip space) and set up the fan
+void SoftwareRasterizer::clipTriangle(const ShadedVertex& a, const ShadedVertex& b, const ShadedVertex& c, BinBlock& block) const {
+    // Each plane adds at most one vertex
+    ShadedVertex polygon[2][8];
+    int count = 3;
+    polygon[0][0] = a;
+    polygon[0][1] = b;
+    polygon[0][2] = c;
+
+    // Signed distances: z + w (near), guard * w -+ x, guard * w -+ y
+    const glm::vec4 planes[5] = {
+        glm::vec4(0.0f, 0.0f, 1.0f, 1.0f),
+        glm::vec4(-1.0f, 0.0f, 0.0f, guardBand),
+        glm::vec4(1.0f, 0.0f, 0.0f, guardBand),
+        glm::vec4(0.0f, -1.0f, 0.0f, guardBand),
+        glm::vec4(0.0f, 1.0f, 0.0f, guardBand),
+    };
+    int current = 0;
+    for (const glm::vec4& plane : planes) {
+        const ShadedVertex* input = polygon[current];
+        ShadedVertex* output = polygon[current ^ 1];
+        int outputCount = 0;
+        for (int i = 0; i < count; i++) {
+            const ShadedVertex& from = input[i];
+            const ShadedVertex& to = input[(i + 1) % count];
+            float fromDistance = glm::dot(plane, from.clip);
+            float toDistance = glm::dot(plane, to.clip);
+            if (fromDistance >= 0.0f) {
+                output[outputCount++] = from;
+            }
+            if ((fromDistance >= 0.0f) != (toDistance >= 0.0f)) {
+                float t = fromDistance / (fromDistance - toDistance);
+                ShadedVertex& cut = output[outputCount++];
+                cut.clip = glm::mix(from.clip, to.clip, t);
+                cut.normal = glm::mix(from.normal, to.normal, t);
+                cut.color = glm::mix(from.color, to.color, t);
+            }
+        }
+        count = outputCount;
+        current ^= 1;
+        if (count < 3) {
+            return;
+        }
+    }
+    for (int i = 1; i + 1 < count; i++) {
+        setupTriangle(polygon[current][0], polygon[current][i], polygon[current][i + 1], block);
+    }
+}
+
+void SoftwareRasterizer::setupTriangle(const ShadedVertex& a, const ShadedVertex& b, const ShadedVertex& c, BinBlock& block) const {
+    const ShadedVertex* corners[3] = { &a, &b, &c };
+    RasterTriangle triangle;
+    float depthAt[3];
+    for (int i = 0; i < 3; i++) {
+        const ShadedVertex& vertex = *corners[i];
+        float invW = 1.0f / vertex.clip.w;
+        // Viewport transform (glViewport(0, 0, width, height), default depth range) to fixed point
+        float x = (vertex.clip.x * invW * 0.5f + 0.5f) * framebufferWidth;
+        float y = (vertex.clip.y * invW * 0.5f + 0.5f) * framebufferHeight;
+        triangle.x[i] = static_cast<int32_t>(std::lround(x * SUBPIXEL_SCALE));
+        triangle.y[i] = static_cast<int32_t>(std::lround(y * SUBPIXEL_SCALE));
+        triangle.invW[i] = invW;
+        triangle.normal[i] = vertex.normal;
+        triangle.color[i] = vertex.color;
+        depthAt[i] = vertex.clip.z * invW * 0.5f + 0.5f;
+    }
+
+    // Twice the signed area; back faces (clockwise) and triangles with no area are culled
+    int64_t x10 = int64_t(triangle.x[1]) - triangle.x[0], y10 = int64_t(triangle.y[1]) - triangle.y[0];
+    int64_t x20 = int64_t(triangle.x[2]) - triangle.x[0], y20 = int64_t(triangle.y[2]) - triangle.y[0];
+    int64_t area = x10 * y20 - x20 * y10;
+    if (area <= 0) {
+        return;
+    }
+
+    // Pixels whose centers (at +8 sub-pixels) fall inside the bounding box
+    int32_t minX = std::min({ triangle.x[0], triangle.x[1], triangle.x[2] });
+    int32_t maxX = std::max({ triangle.x[0], triangle.x[1], triangle.x[2] });
+    int32_t minY = std::min({ triangle.y[0], triangle.y[1], triangle.y[2] });
+    int32_t maxY = std::max({ triangle.y[0], triangle.y[1], triangle.y[2] });
+    triangle.minX = std::max((minX - SUBPIXEL_HALF + SUBPIXEL_SCALE - 1) >> SUBPIXEL_BITS, 0);
+    triangle.maxX = std::min((maxX - SUBPIXEL_HALF) >> SUBPIXEL_BITS, framebufferWidth - 1);
+    triangle.minY = std::max((minY - SUBPIXEL_HALF + SUBPIXEL_SCALE - 1) >> SUBPIXEL_BITS, 0);
+    triangle.maxY = std::min((maxY - SUBPIXEL_HALF) >> SUBPIXEL_BITS, framebufferHeight - 1);
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+        return;  // Covers no pixel center
+    }
+
+    // Window depth is linear in screen space; its plane through the three corners, per pixel
+    double inverseArea = 1.0 / static_cast<double>(area);
+    double dz1 = depthAt[1] - depthAt[0], dz2 = depthAt[2] - depthAt[0];
+    triangle.depth0 = depthAt[0];
+    triangle.depthDx = static_cast<float>((dz1 * static_cast<double>(y20) - dz2 * static_cast<double>(y10)) * SUBPIXEL_SCALE * inverseArea);
+    triangle.depthDy = static_cast<float>((dz2 * static_cast<double>(x10) - dz1 * static_cast<double>(x20)) * SUBPIXEL_SCALE * inverseArea);
+    triangle.inverseArea = static_cast<float>(inverseArea);
+
+    uint32_t index = static_cast<uint32_t>(block.triangles.size());
+    block.triangles.push_back(triangle);
+    for (int tileY = triangle.minY / SOFTWARE_TILE_SIZE; tileY <= triangle.maxY / SOFTWARE_TILE_SIZE; tileY++) {
+        for (int tileX = triangle.minX / SOFTWARE_TILE_SIZE; tileX <= triangle.maxX / SOFTWARE_TILE_SIZE; tileX++) {
+            block.bins[static_cast<size_t>(tileY) * tilesX + tileX].push_back(index);
+            block.tileReferences++;
+        }
+    }
+}
+
+void SoftwareRasterizer::rasterizeTile(size_t tile) {
+    const int tileX = static_cast<int>(tile % tilesX) * SOFTWARE_TILE_SIZE;
+    const int tileY = static_cast<int>(tile / tilesX) * SOFTWARE_TILE_SIZE;
+    const int tileMaxX = std::min(tileX + SOFTWARE_TILE_SIZE, framebufferWidth) - 1;
+    const int tileMaxY = std::min(tileY + SOFTWARE_TILE_SIZE, framebufferHeight) - 1;
+
+    if (clearPending) {
+        const uint8_t clearBytes[4] = { toUnorm8(clearColor.r), toUnorm8(clearColor.g), toUnorm8(clearColor.b), toUnorm8(clearColor.a) };
+        for (int y = tileY; y <= tileMaxY; y++) {
+            size_t row = static_cast<size_t>(y) * stride;
+            std::fill(depth.begin() + row + tileX, depth.begin() + row + tileMaxX + 1, 1.0f);
+            for (int x = tileX; x <= tileMaxX && !depthOnly; x++) {
+                std::copy(clearBytes, clearBytes + 4, &color[(row + x) * 4]);
+            }
+        }
+    }
+
+    size_t shaded = 0;
+    for (size_t b = 0; b < usedBlocks; b++) {
+        const BinBlock& block = blocks[b];
+        for (uint32_t index : block.bins[tile]) {
+            const RasterTriangle& triangle = block.triangles[index];
+            int minX = std::max(triangle.minX, tileX), maxX = std::min(triangle.maxX, tileMaxX);
+            int minY = std::max(triangle.minY, tileY), maxY = std::min(triangle.maxY, tileMaxY);
+
+            // Rows start on a lane boundary inside the tile, so SIMD loads stay within the tile's padded row
+            int startX = tileX + ((minX - tileX) & ~(SOFTWARE_LANES - 1));
+            int span = maxX - startX + 1;
+
+            // Edge i runs from corner i + 1 to corner i + 2 and is >= 0 on the inside. Pixel centers exactly
+            // on an edge belong to the triangle only for top and left edges, so shared edges are drawn once.
+            int32_t edge[3], stepX[3], stepY[3];
+            bool covered = true;
+            for (int i = 0; i < 3 && covered; i++) {
+                int j = (i + 1) % 3, k = (i + 2) % 3;
+                int64_t dx = int64_t(triangle.x[k]) - triangle.x[j];
+                int64_t dy = int64_t(triangle.y[k]) - triangle.y[j];
+                int64_t bias = (dy < 0 || (dy == 0 && dx < 0)) ? 0 : -1;
+                auto edgeAt = [&](int px, int py) {
+                    return dx * (int64_t(py) * SUBPIXEL_SCALE + SUBPIXEL_HALF - triangle.y[j]) -
+                        dy * (int64_t(px) * SUBPIXEL_SCALE + SUBPIXEL_HALF - triangle.x[j]) + bias;
+                };
+                int64_t corners[4] = { edgeAt(minX, minY), edgeAt(maxX, minY), edgeAt(minX, maxY), edgeAt(maxX, maxY) };
+                int64_t low = std::min({ corners[0], corners[1], corners[2], corners[3] });
+                int64_t high = std::max({ corners[0], corners[1], corners[2], corners[3] });
+                if (high < 0) {
+                    covered = false;  // The whole part of the tile is outside this edge
+                }
+                else if (low >= 0) {
+                    edge[i] = stepX[i] = stepY[i] = 0;  // Entirely inside: skip the test (and its large values)
+                }
+                else {
+                    // The edge crosses the tile, so its values here are bounded by the tile size and fit 32 bits
+                    edge[i] = static_cast<int32_t>(edgeAt(startX, minY));
+                    stepX[i] = static_cast<int32_t>(-dy * SUBPIXEL_SCALE);
+                    stepY[i] = static_cast<int32_t>(dx * SUBPIXEL_SCALE);
+                }
+            }
+            if (!covered) {
+                continue;
+            }
+
+            uint64_t spanMask = (span >= 64 ? ~uint64_t(0) : (uint64_t(1) << span) - 1) & ~((uint64_t(1) << (minX - startX)) - 1);
+            float startOffsetX = static_cast<float>(startX * SUBPIXEL_SCALE + SUBPIXEL_HALF - triangle.x[0]) / SUBPIXEL_SCALE;
+            for (int y = minY; y <= maxY; y++) {
+                float startOffsetY = static_cast<float>(y * SUBPIXEL_SCALE + SUBPIXEL_HALF - triangle.y[0]) / SUBPIXEL_SCALE;
+                float rowDepth = triangle.depth0 + triangle.depthDx * startOffsetX + triangle.depthDy * startOffsetY;
+                size_t row = static_cast<size_t>(y) * stride;
+                uint64_t mask = coverageRow(edge, stepX, rowDepth, triangle.depthDx, &depth[row + startX], span) & spanMask;
+
+                for (int i = 0; i < 3; i++) {
+                    edge[i] += stepY[i];
+                }
+                while (mask != 0) {
+                    int bit = lowestBit(mask);
+                    mask &= mask - 1;
+                    int x = startX + bit;
+                    depth[row + x] = rowDepth + static_cast<float>(bit) * triangle.depthDx;
+                    if (depthOnly) {
+                        shaded++;
+                        continue;
+                    }
+
+                    // Perspective-correct barycentrics, from the exact fixed-point edge functions
+                    int64_t centerX = int64_t(x) * SUBPIXEL_SCALE + SUBPIXEL_HALF;
+                    int64_t centerY = int64_t(y) * SUBPIXEL_SCALE + SUBPIXEL_HALF;
+                    float b1 = static_cast<float>((int64_t(triangle.x[0]) - triangle.x[2]) * (centerY - triangle.y[2]) -
+                        (int64_t(triangle.y[0]) - triangle.y[2]) * (centerX - triangle.x[2])) * triangle.inverseArea;
+                    float b2 = static_cast<float>((int64_t(triangle.x[1]) - triangle.x[0]) * (centerY - triangle.y[0]) -
+                        (int64_t(triangle.y[1]) - triangle.y[0]) * (centerX - triangle.x[0])) * triangle.inverseArea;
+                    float w0 = (1.0f - b1 - b2) * triangle.invW[0];
+                    float w1 = b1 * triangle.invW[1];
+                    float w2 = b2 * triangle.invW[2];
+                    float inverseWeight = 1.0f / (w0 + w1 + w2);
+                    glm::vec3 normal = triangle.normal[0] * w0 + triangle.normal[1] * w1 + triangle.normal[2] * w2;
+                    glm::vec4 vertexColor = (triangle.color[0] * w0 + triangle.color[1] * w1 + triangle.color[2] * w2) * inverseWeight;
+
+                    // getDefaultFragmentShader()
+                    float lengthSquared = glm::dot(normal, normal);
+                    float diffuse = lengthSquared > 0.0f ? std::max(glm::dot(normal, LIGHT_DIRECTION) / std::sqrt(lengthSquared), 0.0f) : 0.0f;
+                    glm::vec3 lit = (AMBIENT + DIFFUSE * diffuse) * glm::vec3(vertexColor);
+                    uint8_t* pixel = &color[(row + x) * 4];
+                    pixel[0] = toUnorm8(lit.r);
+                    pixel[1] = toUnorm8(lit.g);
+                    pixel[2] = toUnorm8(lit.b);
+                    pixel[3] = toUnorm8(vertexColor.a);
+                    shaded++;
+                }
+            }
+        }
+    }
+    tilePixels[tile] = shaded;
+}
+
+void SoftwareRasterizer::finish() {
+    if (framebufferWidth == 0) {
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    const size_t tileCount = static_cast<size_t>(tilesX) * tilesY;
+    workers.parallelFor(tileCount, threadCount, [&](size_t tile) {
+        rasterizeTile(tile);
+    });
+    clearPending = false;
+
+    for (size_t tile = 0; tile < tileCount; tile++) {
+        stats.pixelsShaded += tilePixels[tile];
+    }
+    for (size_t b = 0; b < usedBlocks; b++) {
+        BinBlock& block = blocks[b];
+        stats.trianglesBinned += block.triangles.size();
+        stats.tileReferences += block.tileReferences;
+        block.triangles.clear();
+        block.tileReferences = 0;
+        for (std::vector<uint32_t>& bin : block.bins) {
+            bin.clear();
+        }
+    }
+    usedBlocks = 0;
+    stats.frames++;
+    stats.rasterMilliseconds += millisecondsSince(start);
+}
+
+void SoftwareRasterizer::readPixels(std::vector<uint8_t>& pixels) const {
+    pixels.assign(static_cast<size_t>(framebufferWidth) * framebufferHeight * 4, 0);
+    if (depthOnly) {
+        return;
+    }
+    for (int y = 0; y < framebufferHeight; y++) {
+        std::copy(color.begin() + static_cast<size_t>(y) * stride * 4, color.begin() + (static_cast<size_t>(y) * stride + framebufferWidth) * 4,
+            pixels.begin() + static_cast<size_t>(y) * framebufferWidth * 4);
+    }
+}
+
+SoftwareRasterStats SoftwareRasterizer::takeStats() {
+    SoftwareRasterStats taken = stats;
+    stats = SoftwareRasterStats();
+    return taken;
+}
+
+bool writeImagePPM(const std::string& filename, int width, int height, const std::vector<uint8_t>& pixels) {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open() || pixels.size() < static_cast<size_t>(width) * height * 4) {
+        std::cerr << "Failed to write image: " << filename << std::endl;
+        return false;
+    }
+    file << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<uint8_t> row(static_cast<size_t>(width) * 3);
+    for (int y = height - 1; y >= 0; y--) {  // PPM rows run top to bottom
+        const uint8_t* source = &pixels[static_cast<size_t>(y) * width * 4];
+        for (int x = 0; x < width; x++) {
+            row[x * 3 + 0] = source[x * 4 + 0];
+            row[x * 3 + 1] = source[x * 4 + 1];
+            row[x * 3 + 2] = source[x * 4 + 2];
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+    return file.good();
+}
@@ -1,6 +1,17 @@
 // _sapphin_utils.cpp
 // This is for extra functionality (possibly also needed).
 // Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include <iostream>
 #include <stdio.h>
 #include <string>
@@ -9,6 +20,12 @@
 #include <sstream>
 #include <chrono>
 #include <thread>
+#include <cstring>
+#include <algorithm>
+#include <cstdlib>
+#include <mutex>
+#include <deque>
+#include <condition_variable>
 
 // Headers
 #include "headers/_sapphin_utils.h"
@@ -24,6 +41,230 @@
 #include "lib/GLM.win32/GLM-lib/glm/gtc/matrix_transform.hpp"
 #include "lib/GLM.win32/GLM-lib/glm/gtc/type_ptr.hpp"
 
+// Print the command line options
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+        "  --packed    Use the compact 20-byte vertex format\n"
+        "  --optimize  Reorder the mesh for vertex cache, overdraw and fetch locality\n"
+        "  --meshlets  Split the mesh into meshlets and skip those outside the view or facing away\n"
+        "  --bvh       Build a hierarchy over mesh chunks and skip the ones outside the view\n"
+        "  --lod       Generate simplified levels of detail and pick one by on-screen size\n"
+        "  --scene <file>     Draw a scene file (lines 'mesh <name> <file.obj>' and\n"
+        "                     'instance <name> <x> <y> <z> [yaw] [scale]') instead of one model\n"
+        "  --instances <n>    Draw n copies of the model on a grid\n"
+        "  --record-path <file>   Save the camera pose of every frame (for --camera-path)\n"
+        "  --benchmark <file.obj> Render the model offscreen without a window, report frame times and exit\n"
+        "  --frames <n>           Timed benchmark frames (default 300)\n"
+        "  --camera-path <file>   Benchmark camera path, one 'x y z yaw pitch zoom' per line\n"
+        "                         (default: an orbit around the model)\n"
+        "  --json <file>          Benchmark, preprocessing or microbenchmark report\n"
+        "                         (default benchmark.json / preprocess.json / microbench.json)\n"
+        "  --profile <file>       Time input, drawing (CPU and GPU) and swaps and write a Chrome trace\n"
+        "                         (open in chrome://tracing or ui.perfetto.dev)\n"
+        "  --preprocess <path>    Build the .sapmesh of every model in a directory (searched recursively),\n"
+        "                         an .obj file or a list file (one path per line) and exit; repeatable\n"
+        "  --force                Rebuild .sapmesh files that are already current\n"
+        "  --threads <n>          Worker threads for --preprocess, --software, --occlusion and --microbench (default: one per hardware thread)\n"
+        "  --software             Benchmark with the built-in CPU rasterizer instead of OpenGL (no GPU needed)\n"
+        "  --image <file.ppm>     Save the last benchmark frame\n"
+        "  --picks <n>            Also time n picks through random pixels of the first benchmark frame\n"
+        "  --memory-budget <MB>   Parse .obj files with the streaming loader, which refuses models whose buffers\n"
+        "                         won't fit in <MB> (per model, before the processing stages) and reports its peaks;\n"
+        "                         --preprocess shares <MB> out between the models it loads at once\n"
+        "  --occlusion            Rasterize occluders on the CPU each frame and skip the instances and BVH chunks\n"
+        "                         hidden behind them (occluders: scene 'occluder' lines, or every scene mesh)\n"
+        "  --occluders <file.obj> Extra occluder geometry in world space, not drawn (implies --occlusion)\n"
+        "  --microbench <faces>   Time each .obj loading stage on generated files of every format, from 1000 faces\n"
+        "                         up to <faces> in powers of ten, and exit\n"
+        "  --baseline <file>      Compare --microbench with an earlier report\n"
+        "  --on-demand            Only draw when the camera, the window or the model changes; sleep otherwise\n"
+        "  --fps-cap <n>          Draw at most n frames per second, evenly paced\n"
+        "  --vsync                Wait for the display's refresh before showing each frame\n"
+        "                         (otherwise the driver's setting applies)\n"
+        "  --help      Show this message" << std::endl;
+}
+
+// Options followed by a value; given last on the command line, the value is missing
+static bool takesValue(const std::string& arg) {
+    static const char* const options[] = { "--scene", "--instances", "--record-path", "--benchmark", "--frames", "--camera-path",
+        "--json", "--profile", "--preprocess", "--threads", "--image", "--memory-budget", "--picks", "--occluders",
+        "--microbench", "--baseline", "--fps-cap" };
+    for (const char* option : options) {
+        if (arg == option) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Read the command line into options. Returns false if the application should exit.
+bool parseCommandLine(int argc, char** argv, EngineOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--packed") {
+            options.packedVertices = true;
+        }
+        else if (arg == "--optimize") {
+            options.optimizeMesh = true;
+        }
+        else if (arg == "--meshlets") {
+            options.meshlets = true;
+        }
+        else if (arg == "--bvh") {
+            options.bvh = true;
+        }
+        else if (arg == "--lod") {
+            options.lods = true;
+        }
+        else if (arg == "--scene" && i + 1 < argc) {
+            options.scenePath = argv[++i];
+        }
+        else if (arg == "--instances" && i + 1 < argc) {
+            long long count = std::atoll(argv[++i]);
+            if (count < 1) {
+                std::cerr << "--instances needs a positive number" << std::endl;
+                return false;
+            }
+            options.instanceCount = static_cast<size_t>(count);
+        }
+        else if (arg == "--record-path" && i + 1 < argc) {
+            options.recordPathFile = argv[++i];
+        }
+        else if (arg == "--benchmark" && i + 1 < argc) {
+            options.benchmarkModel = argv[++i];
+        }
+        else if (arg == "--frames" && i + 1 < argc) {
+            long long frames = std::atoll(argv[++i]);
+            if (frames < 1) {
+                std::cerr << "--frames needs a positive number" << std::endl;
+                return false;
+            }
+            options.benchmarkFrames = static_cast<size_t>(frames);
+        }
+        else if (arg == "--camera-path" && i + 1 < argc) {
+            options.cameraPathFile = argv[++i];
+        }
+        else if (arg == "--json" && i + 1 < argc) {
+            options.benchmarkOutput = argv[++i];
+        }
+        else if (arg == "--profile" && i + 1 < argc) {
+            options.profilePath = argv[++i];
+        }
+        else if (arg == "--preprocess" && i + 1 < argc) {
+            options.preprocessPaths.push_back(argv[++i]);
+        }
+        else if (arg == "--force") {
+            options.forcePreprocess = true;
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            long long threads = std::atoll(argv[++i]);
+            if (threads < 0) {
+                std::cerr << "--threads needs a number (0 for all hardware threads)" << std::endl;
+                return false;
+            }
+            options.threadCount = static_cast<unsigned>(threads);
+        }
+        else if (arg == "--software") {
+            options.softwareRasterizer = true;
+        }
+        else if (arg == "--image" && i + 1 < argc) {
+            options.imagePath = argv[++i];
+        }
+        else if (arg == "--memory-budget" && i + 1 < argc) {
+            long long megabytes = std::atoll(argv[++i]);
+            if (megabytes < 1) {
+                std::cerr << "--memory-budget needs a positive number of megabytes" << std::endl;
+                return false;
+            }
+            options.memoryBudgetBytes = static_cast<size_t>(megabytes) * 1024 * 1024;
+        }
+        else if (arg == "--picks" && i + 1 < argc) {
+            long long picks = std::atoll(argv[++i]);
+            if (picks < 1) {
+                std::cerr << "--picks needs a positive number" << std::endl;
+                return false;
+            }
+            options.pickCount = static_cast<size_t>(picks);
+        }
+        else if (arg == "--occlusion") {
+            options.occlusion = true;
+        }
+        else if (arg == "--occluders" && i + 1 < argc) {
+            options.occluderPath = argv[++i];
+            options.occlusion = true;
+        }
+        else if (arg == "--microbench" && i + 1 < argc) {
+            long long faces = std::atoll(argv[++i]);
+            if (faces < 1) {
+                std::cerr << "--microbench needs a positive number of faces" << std::endl;
+                return false;
+            }
+            options.microbenchFaces = static_cast<size_t>(faces);
+        }
+        else if (arg == "--baseline" && i + 1 < argc) {
+            options.baselinePath = argv[++i];
+        }
+        else if (arg == "--on-demand") {
+            options.onDemand = true;
+        }
+        else if (arg == "--fps-cap" && i + 1 < argc) {
+            double fps = std::atof(argv[++i]);
+            if (!(fps > 0.0)) {
+                std::cerr << "--fps-cap needs a positive number of frames per second" << std::endl;
+                return false;
+            }
+            options.fpsCap = fps;
+        }
+        else if (arg == "--vsync") {
+            options.vsync = true;
+        }
+        else if (takesValue(arg)) {
+            std::cerr << arg << " needs a value" << std::endl;
+            return false;
+        }
+        else if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return false;
+        }
+        else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            printUsage(argv[0]);
+            return false;
+        }
+    }
+    if (!options.benchmarkModel.empty() && !options.scenePath.empty()) {
+        std::cerr << "--benchmark and --scene can't be combined (use --instances for many copies)" << std::endl;
+        return false;
+    }
+    if (!options.preprocessPaths.empty() && (!options.benchmarkModel.empty() || !options.scenePath.empty())) {
+        std::cerr << "--preprocess can't be combined with --benchmark or --scene" << std::endl;
+        return false;
+    }
+    if ((options.softwareRasterizer || !options.imagePath.empty() || options.pickCount > 0) && options.benchmarkModel.empty()) {
+        std::cerr << "--software, --image and --picks need --benchmark" << std::endl;
+        return false;
+    }
+    if (options.microbenchFaces > 0 && (!options.benchmarkModel.empty() || !options.scenePath.empty() || !options.preprocessPaths.empty())) {
+        std::cerr << "--microbench can't be combined with --benchmark, --scene or --preprocess" << std::endl;
+        return false;
+    }
+    if (!options.baselinePath.empty() && options.microbenchFaces == 0) {
+        std::cerr << "--baseline needs --microbench" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Optional processing stages requested on the command line, also part of the mesh cache key
+uint32_t meshProcessingFlags(const EngineOptions& options) {
+    uint32_t flags = 0;
+    if (options.optimizeMesh) flags |= MESH_OPTIMIZE;
+    if (options.meshlets) flags |= MESH_MESHLETS;
+    if (options.bvh) flags |= MESH_BVH;
+    if (options.lods) flags |= MESH_LODS;
+    return flags;
+}
+
 // Set a function for a typewriter effect for text
 void typewriterEffect(const std::string& text, const std::string& color, int milliseconds_delay) {
     std::cout << color;  // Set color
@@ -52,3 +293,287 @@ void checkGLError(const char* operation) {
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
 	glViewport(0, 0, width, height);
 }
+
+static bool redrawRequested = false;
+
+void window_refresh_callback(GLFWwindow* window) {
+    redrawRequested = true;
+}
+
+bool takeRedrawRequest() {
+    bool requested = redrawRequested;
+    redrawRequested = false;
+    return requested;
+}
+
+// Quote text for a JSON report; control characters become spaces
+std::string jsonString(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            quoted += ' ';
+        }
+        else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+// Fast 64-bit hash for file contents (not cryptographic).
+// Four independent lanes of 8 bytes each keep the multipliers busy on large inputs.
+static inline uint64_t mixHashWord(uint64_t hash, uint64_t word) {
+    hash = (hash ^ (word * 0x9E3779B97F4A7C15ull)) * 0xFF51AFD7ED558CCDull;
+    return hash ^ (hash >> 32);
+}
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t lanes[4] = { seed ^ size, seed + 0x632BE59BD9B4E019ull, seed ^ 0x8CB92BA72F3D8DD7ull, seed - 0x2545F4914F6CDD1Dull };
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (int lane = 0; lane < 4; lane++) {
+            uint64_t word;
+            memcpy(&word, bytes + i + lane * 8, 8);
+            lanes[lane] = mixHashWord(lanes[lane], word);
+        }
+    }
+
+    uint64_t hash = lanes[0];
+    for (int lane = 1; lane < 4; lane++) {
+        hash = mixHashWord(hash, lanes[lane]);
+    }
+    for (; i < size; i += 8) {
+        uint64_t word = 0;
+        memcpy(&word, bytes + i, std::min<size_t>(8, size - i));
+        hash = mixHashWord(hash, word);
+    }
+    return mixHashWord(hash, size);
+}
+
+// Map a file read-only into memory. Empty files open successfully with a null data pointer.
+bool MappedFile::open(const std::string& filename) {
+    close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    mappedSize = static_cast<size_t>(fileSize.QuadPart);
+    if (mappedSize > 0) {
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            close();
+            return false;
+        }
+        mappingHandle = mapping;
+        mappedData = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!mappedData) {
+            close();
+            return false;
+        }
+    }
+#else
+    fileDescriptor = ::open(filename.c_str(), O_RDONLY);
+    if (fileDescriptor < 0) {
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(fileDescriptor, &fileStat) != 0) {
+        close();
+        return false;
+    }
+
+    mappedSize = static_cast<size_t>(fileStat.st_size);
+    if (mappedSize > 0) {
+        void* address = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+        if (address == MAP_FAILED) {
+            close();
+            return false;
+        }
+        madvise(address, mappedSize, MADV_SEQUENTIAL);
+        mappedData = static_cast<const char*>(address);
+    }
+#endif
+    opened = true;
+    return true;
+}
+
+// Unmap the file and release its handles
+void MappedFile::close() {
+#ifdef _WIN32
+    if (mappedData) UnmapViewOfFile(mappedData);
+    if (mappingHandle) CloseHandle(static_cast<HANDLE>(mappingHandle));
+    if (fileHandle) CloseHandle(static_cast<HANDLE>(fileHandle));
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    if (mappedData) munmap(const_cast<char*>(mappedData), mappedSize);
+    if (fileDescriptor >= 0) ::close(fileDescriptor);
+    fileDescriptor = -1;
+#endif
+    mappedData = nullptr;
+    mappedSize = 0;
+    opened = false;
+}
+
+struct WorkerPool::State {
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+
+    // The current loop; only changed while no pool thread works on it
+    void (*call)(void*, size_t) = nullptr;
+    void* context = nullptr;
+    size_t count = 0;
+    std::atomic<size_t> next{0};
+    unsigned helpers = 0;  // Pool threads taking part
+    unsigned busy = 0;     // Pool threads still taking part
+    uint64_t generation = 0;
+    bool stopping = false;
+
+    ~State() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    void work(unsigned index) {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [&]() { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            if (index >= helpers) {
+                continue;
+            }
+            lock.unlock();
+            for (size_t i = next++; i < count; i = next++) {
+                call(context, i);
+            }
+            lock.lock();
+            if (--busy == 0) {
+                finished.notify_one();
+            }
+        }
+    }
+};
+
+WorkerPool::WorkerPool() = default;
+WorkerPool::~WorkerPool() = default;
+WorkerPool::WorkerPool(WorkerPool&&) noexcept = default;
+WorkerPool& WorkerPool::operator=(WorkerPool&&) noexcept = default;
+
+void WorkerPool::start(unsigned threadCount) {
+    threadCount = resolveThreadCount(threadCount);
+    if (threads() == threadCount) {
+        return;
+    }
+    state.reset();
+    if (threadCount == 1) {
+        return;
+    }
+    state.reset(new State());
+    for (unsigned i = 0; i + 1 < threadCount; i++) {
+        State* shared = state.get();
+        state->threads.emplace_back([shared, i]() { shared->work(i); });
+    }
+}
+
+unsigned WorkerPool::threads() const {
+    return state ? static_cast<unsigned>(state->threads.size()) + 1 : 1;
+}
+
+void WorkerPool::run(size_t count, unsigned threadLimit, void (*call)(void*, size_t), void* context) {
+    size_t helpers = 0;
+    if (state && threadLimit > 1 && count > 1) {
+        helpers = std::min({state->threads.size(), static_cast<size_t>(threadLimit - 1), count - 1});
+    }
+    if (helpers == 0) {
+        for (size_t i = 0; i < count; i++) {
+            call(context, i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->call = call;
+        state->context = context;
+        state->count = count;
+        state->next = 0;
+        state->helpers = static_cast<unsigned>(helpers);
+        state->busy = static_cast<unsigned>(helpers);
+        state->generation++;
+    }
+    state->wake.notify_all();
+    for (size_t i = state->next++; i < count; i = state->next++) {
+        call(context, i);
+    }
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&]() { return state->busy == 0; });
+}
+
+struct ConsoleLineReader::State {
+    std::mutex mutex;
+    std::deque<std::string> lines;
+};
+
+void ConsoleLineReader::start() {
+    if (state) {
+        return;
+    }
+    state = std::make_shared<State>();
+    std::shared_ptr<State> shared = state;
+    std::thread([shared]() {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            {
+                std::lock_guard<std::mutex> lock(shared->mutex);
+                shared->lines.push_back(line);
+            }
+            glfwPostEmptyEvent();  // Wakes a render loop that waits for events
+        }
+    }).detach();
+}
+
+bool ConsoleLineReader::takeLine(std::string& line) {
+    if (!state) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (state->lines.empty()) {
+        return false;
+    }
+    line = std::move(state->lines.front());
+    state->lines.pop_front();
+    return true;
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
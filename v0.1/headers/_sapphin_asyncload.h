@@ -0,0 +1,86 @@
+// _sapphin_asyncload.h
+// This header file includes the background model loader that lets the window come up before the model is ready.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+#pragma once  // Prevents multiple inclusions
+
+// Headers
+#include <string>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "headers/_sapphin_render.h"
+#include "headers/_sapphin_ringbuffer.h"
+#include "headers/_sapphin_picking.h"
+#include "headers/_sapphin_types.h"
+
+// Bytes copied to the GPU per frame while a loaded model is uploaded; keeps frames short on slow buses
+const size_t ASYNC_UPLOAD_BYTES_PER_FRAME = 16 * 1024 * 1024;
+
+// Loads (parses, processes and prepares for upload) one model on a worker thread, then uploads it in
+// slices from the render loop. Only update() touches GL, so call it on the thread owning the context.
+// start() may be called again for the next model; its upload then reuses the buffers of gpuMesh. A load that
+// is still running is cancelled: start() leaves its worker to stop by itself, the destructor waits for it.
+class AsyncMeshLoader {
+public:
+    AsyncMeshLoader() = default;
+    ~AsyncMeshLoader();
+    AsyncMeshLoader(const AsyncMeshLoader&) = delete;
+    AsyncMeshLoader& operator=(const AsyncMeshLoader&) = delete;
+
+    void start(const std::string& filename, uint32_t processingFlags, bool packed);
+
+    // Drop the model being loaded or uploaded, if any, without waiting for its worker
+    void cancel();
+
+    // Once per frame: when the worker is done, moves its mesh into mesh, creates (or reuses) gpuMesh and
+    // uploads the next slice of at most maxBytes. Returns true when loading is over (finished or failed).
+    // Until the upload begins, mesh and gpuMesh are left alone and can still be drawn.
+    bool update(Mesh& mesh, GpuMesh& gpuMesh, size_t maxBytes = ASYNC_UPLOAD_BYTES_PER_FRAME);
+
+    // While uploading: indices at the start of mesh.indices that are already on the GPU (whole triangles)
+    size_t drawableIndices() const;
+
+    // Once after update() took the mesh: swaps the picking BVH the worker built for it into picker
+    bool takePickBvh(PickBvh& picker);
+
+    bool failed() const { return state == FAILED; }
+    bool isUploading() const { return state == UPLOADING; }
+
+    // What is going on, for the window title ("Parsing model.obj", "Uploading model.obj 40%")
+    std::string status() const;
+
+private:
+    enum State { IDLE, LOADING, UPLOADING, DONE, FAILED };
+
+    // What one worker works on; shared with it, so a cancelled worker can finish after the loader moved on
+    struct Job {
+        std::string filename;
+        std::atomic<int> stage{ 0 };
+        std::atomic<bool> cancel{ false };
+        std::atomic<bool> done{ false };
+
+        // Written by the worker, read after done
+        Mesh mesh;
+        MeshUpload upload;
+        PickBvh picker;
+    };
+
+    // Stop the current worker: detach it (start) or wait for it (destructor)
+    void cancelJob(bool wait);
+
+    State state = IDLE;
+    std::string filename;
+    std::thread worker;
+    std::shared_ptr<Job> job;
+    std::chrono::steady_clock::time_point startTime;
+
+    // Taken from the job once it is done
+    MeshUpload upload;
+    PickBvh loadedPicker;
+    bool pickerReady = false;
+
+    // Slices are staged here while uploading
+    StreamRing staging;
+};
@@ -0,0 +1,43 @@
+// _sapphin_benchmark.h
+// This header file includes the headless benchmark that replays a camera path and reports frame times.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+#pragma once  // Prevents multiple inclusions
+
+// Headers
+#include <string>
+#include <vector>
+#include "headers/_sapphin_utils.h"
+#include "headers/_sapphin_camera.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+
+// Offscreen framebuffer size; the same aspect as the window, so projections match interactive runs
+const int BENCHMARK_WIDTH = 800;
+const int BENCHMARK_HEIGHT = 600;
+
+// Frames rendered before timing starts (shader compilation, first uploads, driver caches)
+const size_t BENCHMARK_WARMUP_FRAMES = 10;
+
+// One camera pose of a path; angles and field of view in degrees, like Camera
+struct CameraKeyframe {
+    glm::vec3 position;
+    float yaw;
+    float pitch;
+    float zoom;
+};
+
+// Camera path files hold one keyframe per line: x y z yaw pitch zoom
+bool loadCameraPath(const std::string& filename, std::vector<CameraKeyframe>& path);
+bool saveCameraPath(const std::string& filename, const std::vector<CameraKeyframe>& path);
+CameraKeyframe cameraKeyframe(const Camera& camera);
+
+// Scripted path: one orbit around a bounding box, dollying in and out so levels of detail and culling change
+std::vector<CameraKeyframe> orbitCameraPath(const glm::vec3& boundsMin, const glm::vec3& boundsMax, size_t keyframes = 64);
+
+// Pose at t in [0, 1] along the path, interpolated linearly between keyframes
+CameraKeyframe sampleCameraPath(const std::vector<CameraKeyframe>& path, float t);
+
+// Render options.benchmarkModel offscreen for options.benchmarkFrames frames along the camera path and write
+// the timings as JSON (to options.benchmarkOutput, or benchmark.json). Returns the process exit code.
+int runBenchmark(const EngineOptions& options);
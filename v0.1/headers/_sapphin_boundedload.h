@@ -0,0 +1,45 @@
+// _sapphin_boundedload.h
+// This header file includes the .obj loader that keeps its buffers within a memory budget.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+#pragma once  // Prevents multiple inclusions
+
+// Headers
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstddef>
+#include "headers/_sapphin_types.h"
+
+// Faces are parsed this many at a time
+const size_t BOUNDED_FACE_BLOCK = 1 << 16;
+
+// Most bytes the loader's buffers held at once during one stage
+struct LoadStageMemory {
+    std::string name;
+    size_t peakBytes = 0;
+    double milliseconds = 0.0;
+};
+
+struct LoadMemoryStats {
+    size_t budgetBytes = 0;   // 0 for no budget
+    size_t plannedBytes = 0;  // Peak predicted from the record counts, before any large buffer was allocated
+    size_t peakBytes = 0;     // Most held at once over all stages
+    size_t mappedBytes = 0;   // Size of the memory mapped .obj; its pages belong to the file and aren't counted above
+    std::vector<LoadStageMemory> stages;
+    bool overBudget = false;  // Nothing (or not everything) was loaded because the budget was too small
+};
+
+// Builds the same mesh as loadMesh (normals summed in the same order, so they only differ where the compiler
+// fuses multiply-adds differently) without ever holding all faces, the file's normals or a color per position
+// when the file has none. A counting pass sizes every buffer exactly, the positions and
+// texture coordinates are parsed into them, and the faces are then streamed in blocks while the vertices are
+// deduplicated and the normals summed in place. If the predicted peak (or a later reallocation) doesn't fit
+// in budgetBytes (when nonzero), loading stops with an empty mesh. stats, if given, gets the per-stage peaks.
+// Setting cancel (if given) from another thread also stops it with an empty mesh, after the current block.
+Mesh loadMeshBounded(const std::string& filename, size_t budgetBytes, LoadMemoryStats* stats = nullptr, unsigned threadCount = 0,
+    const std::atomic<bool>* cancel = nullptr);
+
+// Most bytes held by all bounded loads running at the same time (counted like LoadMemoryStats::peakBytes),
+// since the program started or resetBoundedLoadPeak() was last called
+size_t boundedLoadPeakBytes();
+void resetBoundedLoadPeak();
@@ -0,0 +1,18 @@
+// _sapphin_bvh.h
+// This header file includes the bounding volume hierarchy built over mesh chunks at load time.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+#pragma once  // Prevents multiple inclusions
+
+// Headers
+#include <vector>
+#include <cstdint>
+#include "headers/_sapphin_types.h"
+
+// Leaf sizes: triangles per leaf for plain meshes, meshlets per leaf when the mesh has meshlets
+const unsigned BVH_LEAF_TRIANGLES = 256;
+const unsigned BVH_LEAF_MESHLETS = 4;
+
+// Build mesh.bvh over the mesh's meshlets, or over its triangles if it has none. Triangles (and meshlets)
+// are reordered so every node covers a contiguous part of the index buffer; within a leaf they keep
+// their previous relative order, so an earlier vertex cache optimization mostly survives.
+void buildMeshBvh(Mesh& mesh);
@@ -27,6 +27,13 @@ enum Camera_Movement {
 	DOWN
 };
 
+// What a mouse click asks of the render loop: left selects a triangle, right measures between two points
+enum PickRequest {
+    PICK_NONE,
+    PICK_SELECT,
+    PICK_MEASURE
+};
+
 class Camera {
 public:
     glm::vec3 position;
@@ -53,6 +60,7 @@ public:
     void processMouseMovement(float xoffset, float yoffset, bool constrainPitch = true);
     void processMouseScroll(float yoffset);
     void smoothMoveToTarget(const glm::vec3& target, float smoothFactor);
+    void setPose(const glm::vec3& position, float yaw, float pitch);
 
 private:
     void updateCameraVectors();
@@ -65,4 +73,17 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 // Additional function declarations
 void SetupMouseCapture(GLFWwindow* window);
 void processInput(GLFWwindow* window, Camera& camera, float deltaTime);
+
+// True once after N was pressed in processInput
+bool takeModelSwitchRequest();
+
+// The click made in processInput since the last call, if any
+PickRequest takePickRequest();
+
+// Files dropped on the window; takeDroppedFile returns the last one dropped since the previous call
+void drop_callback(GLFWwindow* window, int count, const char** paths);
+bool takeDroppedFile(std::string& path);
+
+// True while a key that moves or zooms the camera in processInput is held
+bool cameraKeysHeld(GLFWwindow* window);
 void updateCameraProjection(glm::mat4& projection, const Camera& camera);
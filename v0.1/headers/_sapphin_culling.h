@@ -0,0 +1,64 @@
+// _sapphin_culling.h
+// This header file includes the per-frame visibility tests that run on the CPU before draws are issued.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+#pragma once  // Prevents multiple inclusions
+
+// Headers
+#include <vector>
+#include <cstdint>
+#include "headers/_sapphin_types.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+
+// Six planes (ax + by + cz + d >= 0 inside), normalized so the plane equation gives distances
+struct Frustum {
+    glm::vec4 planes[6];
+};
+
+// Planes of a (projection * view * model) matrix, in the space the matrix transforms from
+Frustum extractFrustum(const glm::mat4& viewProjection);
+
+bool sphereInFrustum(const Frustum& frustum, const glm::vec3& center, float radius);
+
+enum FrustumTest {
+    FRUSTUM_OUTSIDE,
+    FRUSTUM_INTERSECTS,
+    FRUSTUM_INSIDE
+};
+
+FrustumTest boxInFrustum(const Frustum& frustum, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+// Part of a mesh's index buffer to draw
+struct IndexRange {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+};
+
+struct MeshletCullStats {
+    size_t visible = 0;
+    size_t frustumCulled = 0;
+    size_t backfaceCulled = 0;
+};
+
+// Collect the index ranges of meshlets that are inside the frustum and not facing away from the camera.
+// frustum and cameraPosition must be in the mesh's model space. Neighbouring visible meshlets share one range.
+MeshletCullStats cullMeshlets(const std::vector<Meshlet>& meshlets, const Frustum& frustum, const glm::vec3& cameraPosition,
+    std::vector<IndexRange>& ranges);
+
+// Per-frame counters of cullMeshBvh
+struct BvhCullStats {
+    size_t visitedNodes = 0;
+    size_t culledTriangles = 0;    // Outside the frustum, or in meshlets facing away
+    size_t occludedTriangles = 0;  // In chunks hidden behind occluders
+    size_t drawnTriangles = 0;
+    double cullMilliseconds = 0.0;
+};
+
+class OcclusionCuller;
+
+// Walk mesh.bvh and collect the index ranges that may be visible. Nodes fully inside the frustum are
+// drawn without visiting their children; meshlets in the leaves are also tested against their normal cones.
+// With an occlusion culler, nodes are also tested against its pyramid, through modelViewProjection.
+BvhCullStats cullMeshBvh(const Mesh& mesh, const Frustum& frustum, const glm::vec3& cameraPosition, std::vector<IndexRange>& ranges,
+    OcclusionCuller* occlusion = nullptr, const glm::mat4& modelViewProjection = glm::mat4(1.0f));
@@ -0,0 +1,87 @@
+// _sapphin_glstate.h
+// This header file includes the GL state cache that skips redundant binds, state changes and uniform uploads.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+#pragma once  // Prevents multiple inclusions
+
+// Headers
+#include <map>
+#include <utility>
+#include <cstdint>
+#include "lib/GLEW.win32/GLEW-lib/include/GL/glew.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+
+// Uniform buffer binding point of the per-frame camera block:
+//   layout(std140) uniform Camera { mat4 view; mat4 projection; };
+const GLuint CAMERA_BLOCK_BINDING = 0;
+
+// Locations of the uniforms Sapphin's shaders use (-1 when a program doesn't have one)
+struct ProgramUniforms {
+    GLint model = -1;
+    GLint positionScale = -1;
+    GLint positionOffset = -1;
+};
+
+// GL calls that went to the driver versus those skipped because they would not change anything
+struct GlCallStats {
+    size_t issued = 0;
+    size_t elided = 0;
+};
+
+// Mirror of the GL state Sapphin changes per frame. Everything that binds programs, vertex arrays or
+// buffers while rendering goes through here, so the mirror stays correct. Element array buffers are
+// part of the vertex array state and are not tracked.
+class GlStateCache {
+public:
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vertexArray);
+    void bindBuffer(GLenum target, GLuint buffer);
+    void polygonMode(GLenum mode);
+
+    // Uniform locations of a program, looked up once
+    const ProgramUniforms& uniforms(GLuint program);
+
+    // Upload uniforms of the current program, skipped when the value is already set
+    void uniformMatrix4(GLint location, const glm::mat4& value);
+    void uniform3(GLint location, const glm::vec3& value);
+
+    // Fill the camera uniform block (created on first use and bound to CAMERA_BLOCK_BINDING)
+    void updateCameraBlock(const glm::mat4& view, const glm::mat4& projection);
+
+    // Call before deleting GL objects, so the mirror doesn't report them as still bound
+    void forgetVertexArray(GLuint vertexArray);
+    void forgetBuffer(GLuint buffer);
+    void forgetProgram(GLuint program);
+
+    // Forget everything; call when the context is destroyed
+    void reset();
+
+    // Counts draws and other calls that don't go through the cache but should appear in the totals
+    void countIssued(size_t calls = 1) { callStats.issued += calls; }
+
+    GlCallStats stats() const { return callStats; }
+    void resetStats() { callStats = GlCallStats(); }
+
+private:
+    GLuint currentProgram = 0;
+    GLuint currentVertexArray = 0;
+    GLuint currentArrayBuffer = 0;
+    GLuint currentUniformBuffer = 0;
+    GLenum currentPolygonMode = GL_FILL;
+    bool polygonModeKnown = false;
+
+    std::map<GLuint, ProgramUniforms> programUniforms;
+    std::map<std::pair<GLuint, GLint>, glm::mat4> matrixValues;
+    std::map<std::pair<GLuint, GLint>, glm::vec3> vectorValues;
+
+    GLuint cameraBuffer = 0;
+    bool cameraValid = false;
+    glm::mat4 cameraView = glm::mat4(1.0f);
+    glm::mat4 cameraProjection = glm::mat4(1.0f);
+
+    GlCallStats callStats;
+};
+
+// The cache of the current GL context
+GlStateCache& glState();
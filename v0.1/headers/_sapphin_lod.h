@@ -0,0 +1,36 @@
+// _sapphin_lod.h
+// This header file includes the level of detail generation (quadric error simplification) and selection.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+#pragma once  // Prevents multiple inclusions
+
+// Headers
+#include <vector>
+#include <cstdint>
+#include "headers/_sapphin_types.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+
+// Number of simplified levels generated at most, each with about half the triangles of the previous one
+const unsigned MESH_LOD_LEVELS = 6;
+
+// Meshes are not simplified below this many triangles
+const size_t MESH_LOD_MIN_TRIANGLES = 64;
+
+// Projected error (in pixels) a level may have before a finer one is picked
+const float MESH_LOD_PIXEL_ERROR = 1.0f;
+
+// Collapse edges of an index buffer until at most targetIndexCount indices are left, or no collapse is
+// possible without moving the surface more than maxError. Vertices are never moved or added; seams and
+// open borders stay in place. Returns the simplified indices and sets error to the largest distance
+// (estimated from the quadrics) between the result and the original surface.
+std::vector<uint32_t> simplifyMesh(const Mesh& mesh, const std::vector<uint32_t>& indices, size_t targetIndexCount,
+    float maxError, float& error);
+
+// Append simplified levels to mesh.indices and fill mesh.lods, all sharing the same vertices.
+// Meshlets and BVH nodes keep referring to the full mesh (lods[0]).
+void buildMeshLods(Mesh& mesh);
+
+// Coarsest level whose error projects to under MESH_LOD_PIXEL_ERROR pixels for a camera at cameraPosition
+// (in model space), with the given vertical field of view (degrees) and viewport height (pixels)
+size_t selectMeshLod(const Mesh& mesh, const glm::vec3& cameraPosition, float fovyDegrees, int viewportHeight);
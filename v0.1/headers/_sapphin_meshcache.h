@@ -0,0 +1,44 @@
+// _sapphin_meshcache.h
+// This header file includes the binary mesh cache (.sapmesh) that is stored next to a model.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+#pragma once  // Prevents multiple inclusions
+
+// Headers
+#include <string>
+#include <cstdint>
+#include "headers/_sapphin_utils.h"
+#include "headers/_sapphin_types.h"
+
+// Bump whenever the layout of the cache or of Vertex changes
+const uint32_t MESH_CACHE_VERSION = 4;
+
+// Fixed-size header at the start of every .sapmesh file, followed by the vertices, the indices, the meshlets,
+// the BVH nodes and the levels of detail
+struct MeshCacheHeader {
+    char magic[8];            // "SAPMESH"
+    uint32_t version;
+    uint32_t vertexSize;      // sizeof(Vertex) when the cache was written
+    uint32_t flags;           // Processing options the mesh was built with
+    uint32_t reserved;
+    uint64_t sourceSize;      // Size of the .obj file
+    int64_t sourceTime;       // Last write time of the .obj file
+    uint64_t sourceHash;      // hashBytes() of the .obj contents
+    uint64_t payloadHash;     // hashBytes() of the vertex, index, meshlet, BVH and LOD data
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint64_t meshletCount;
+    uint64_t bvhNodeCount;
+    uint64_t lodCount;
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+// Path of the cache that belongs to an .obj file ("model.obj" -> "model.sapmesh")
+std::string meshCachePath(const std::string& objFilename);
+
+// Read the cache of an .obj file. Returns false if it is missing, stale or corrupt. A source with the recorded
+// size and write time is not read again; one with a new write time is hashed and compared.
+bool readMeshCache(const std::string& objFilename, uint32_t flags, Mesh& mesh);
+
+// Write the cache of an .obj file. Returns false if the file could not be written.
+bool writeMeshCache(const std::string& objFilename, uint32_t flags, const Mesh& mesh);
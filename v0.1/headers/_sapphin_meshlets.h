@@ -0,0 +1,20 @@
+// _sapphin_meshlets.h
+// This header file includes the partitioning of meshes into small cullable clusters (meshlets).
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+#pragma once  // Prevents multiple inclusions
+
+// Headers
+#include <vector>
+#include <cstdint>
+#include "headers/_sapphin_types.h"
+
+// Limits of a single meshlet
+const unsigned MESHLET_MAX_TRIANGLES = 128;
+const unsigned MESHLET_MAX_VERTICES = 128;
+
+// Split the mesh into meshlets, grown greedily over shared vertices so they stay compact.
+// The index buffer is reordered so every meshlet is a contiguous range; mesh.meshlets is filled in.
+void buildMeshlets(Mesh& mesh);
+
+// Bounding sphere and normal cone of the triangles in [firstIndex, firstIndex + indexCount)
+void computeMeshletBounds(const Mesh& mesh, Meshlet& meshlet);
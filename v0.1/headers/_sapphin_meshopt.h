@@ -0,0 +1,34 @@
+// _sapphin_meshopt.h
+// This header file includes the optional mesh optimization stages (vertex cache, overdraw and vertex fetch order).
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+#pragma once  // Prevents multiple inclusions
+
+// Headers
+#include <vector>
+#include <cstdint>
+#include "headers/_sapphin_types.h"
+
+// Post-transform cache size the optimizer plans for (a FIFO of this many vertices)
+const unsigned VERTEX_CACHE_SIZE = 16;
+
+// Vertex cache efficiency of an index buffer, simulated with a FIFO cache
+struct VertexCacheStats {
+    float acmr = 0.0f;  // Average cache misses per triangle (0.5 is the best possible, 3 the worst)
+    float atvr = 0.0f;  // Cache misses per referenced vertex (1.0 is the best possible)
+};
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, unsigned cacheSize = VERTEX_CACHE_SIZE);
+
+// Reorder triangles for vertex cache locality (Tipsify). Returns the triangle index where each
+// cache-coherent run starts, which optimizeOverdraw uses as cluster boundaries.
+std::vector<uint32_t> optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, unsigned cacheSize = VERTEX_CACHE_SIZE);
+
+// Reorder the clusters produced by optimizeVertexCache so outward-facing ones draw first, which lets
+// early-Z reject more of what is behind them. threshold bounds how much ACMR may grow (1.05 = 5%).
+void optimizeOverdraw(const Mesh& mesh, std::vector<uint32_t>& indices, const std::vector<uint32_t>& clusters, float threshold = 1.05f);
+
+// Renumber vertices in the order the index buffer first uses them, so vertex fetch reads memory linearly
+void optimizeVertexFetch(Mesh& mesh);
+
+// Run every stage above on a mesh and print ACMR/ATVR before and after
+void optimizeMesh(Mesh& mesh);
@@ -0,0 +1,47 @@
+// _sapphin_microbench.h
+// This header file includes the loader microbenchmarks and the synthetic .obj files they run on.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+#pragma once  // Prevents multiple inclusions
+
+// Headers
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include "headers/_sapphin_utils.h"
+
+// Attribute layouts of the generated files
+enum SyntheticObjFormat : int {
+    SYNTHETIC_POSITIONS,          // f a b c
+    SYNTHETIC_TEXCOORDS,          // f a/a b/b c/c
+    SYNTHETIC_NORMALS,            // f a//a b//b c//c
+    SYNTHETIC_TEXCOORDS_NORMALS,  // f a/a/a b/b/b c/c/c
+    SYNTHETIC_COLORS,             // v x y z r g b, f a b c
+    SYNTHETIC_FORMAT_COUNT,
+};
+const char* syntheticObjFormatName(int format);
+
+// --microbench runs every power of ten from MICROBENCH_MIN_FACES up to its argument
+const size_t MICROBENCH_MIN_FACES = 1000;
+
+// Every stage is repeated until it has run this long in total (and at least once)
+const double MICROBENCH_MIN_MILLISECONDS = 200.0;
+
+// Write a height field of faceCount triangles in the given format. Coordinates are generated as integers
+// from seed, so the same arguments give the same bytes on every platform and compiler.
+// Returns the file size, or 0 (and prints why) if the file could not be written.
+uint64_t writeSyntheticObj(const std::string& filename, size_t faceCount, int format, uint32_t seed = 1);
+
+// Heap allocations made through operator new (on every thread) while counting was on; it is off
+// unless a microbenchmark stage is being measured
+struct AllocationCount {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+};
+void countAllocations(bool enabled);
+AllocationCount allocationCount();
+
+// Time the line loop, face index parsing, full parse, normal averaging and vertex building on synthetic files
+// of every format and size up to options.microbenchFaces, print them and write them as JSON (to
+// options.benchmarkOutput, or microbench.json). With options.baselinePath, every stage is also compared with
+// the same stage of that earlier report. Returns the process exit code.
+int runMicrobench(const EngineOptions& options);
@@ -7,9 +7,11 @@
 #include <string>
 #include <vector>
 #include <array>
+#include <atomic>
 #include "headers/_sapphin_utils.h"
 #include "headers/_sapphin_render.h"
 #include "headers/_sapphin_camera.h"
+#include "headers/_sapphin_boundedload.h"
 #include "headers/_sapphin_types.h"
 #include "lib/GLEW.win32/GLEW-lib/include/GL/glew.h"
 #include "lib/GLFW.win32/GLFW-lib/include/GLFW/glfw3.h"
@@ -19,8 +21,50 @@
 #include "lib/GLM.win32/GLM-lib/glm/gtc/matrix_transform.hpp"
 #include "lib/GLM.win32/GLM-lib/glm/gtc/type_ptr.hpp"
 
+// Optional processing stages of loadMeshCached (stored in the .sapmesh header, so changing them rebuilds the cache)
+enum MeshProcessingFlags : uint32_t {
+    MESH_OPTIMIZE = 1 << 0,  // Vertex cache, overdraw and vertex fetch reordering (_sapphin_meshopt.h)
+    MESH_MESHLETS = 1 << 1,  // Split into cullable meshlets (_sapphin_meshlets.h)
+    MESH_BVH = 1 << 2,       // Bounding volume hierarchy for frustum culling (_sapphin_bvh.h)
+    MESH_LODS = 1 << 3,      // Simplified levels of detail (_sapphin_lod.h)
+};
+
+// What loadMeshCached is doing, reported through its optional stage argument when loading on another thread
+enum MeshLoadStage : int {
+    LOAD_READING_CACHE,
+    LOAD_PARSING,
+    LOAD_OPTIMIZING,
+    LOAD_MESHLETS,
+    LOAD_BVH,
+    LOAD_LODS,
+    LOAD_WRITING_CACHE,
+    LOAD_FINISHED,
+};
+const char* meshLoadStageName(int stage);
+
 GLFWwindow* initOpenGL();
 std::vector<Vertex> loadModel(const std::string& filename);
+Mesh loadMesh(const std::string& filename, unsigned threadCount = 0, const std::atomic<bool>* cancel = nullptr);
+
+struct ObjData;
+
+// Fill mesh.vertices and mesh.indices from parsed faces (all position indices valid) and per-position normals
+void buildMeshVertices(const ObjData& data, const std::vector<glm::vec3>& vertexNormals, Mesh& mesh);
+
+// Parse an .obj and run the requested processing stages, without looking at the cache. threadCount is
+// passed to the parser and normal generation (0 = every hardware thread). With a load memory budget set,
+// the .obj is read by loadMeshBounded, which fills memory (if given) with its per-stage peaks.
+// Setting cancel (if given) from another thread stops the parse or between stages, with an empty mesh.
+Mesh processMesh(const std::string& filename, uint32_t processingFlags, std::atomic<int>* stage = nullptr, unsigned threadCount = 0,
+    LoadMemoryStats* memory = nullptr, const std::atomic<bool>* cancel = nullptr);
+
+// Bytes every .obj load may hold in buffers (0, the default, for no limit); see loadMeshBounded
+void setLoadMemoryBudget(size_t bytes);
+size_t loadMemoryBudget();
+Mesh loadMeshCached(const std::string& filename, uint32_t processingFlags = 0, std::atomic<int>* stage = nullptr,
+    const std::atomic<bool>* cancel = nullptr);
+void computeMeshBounds(Mesh& mesh);
+size_t meshGpuBytes(const Mesh& mesh);
 GLuint createShaderProgram(const std::string& vertexShaderSource, const std::string& fragmentShaderSource);
 void renderModel(GLFWwindow* window, const std::vector<Vertex>& vertices, GLuint shaderProgram);
 
@@ -0,0 +1,16 @@
+// _sapphin_normals.h
+// This header file includes the smooth vertex normal generation used by the loaders.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+#pragma once  // Prevents multiple inclusions
+
+// Headers
+#include <vector>
+#include "headers/_sapphin_objparser.h"
+#include "headers/_sapphin_types.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+
+// Average the unit normals of all faces around every position, then normalize.
+// Runs on threadCount threads (0 = all) and sums faces in file order, so the result matches a serial loop.
+std::vector<glm::vec3> computeVertexNormals(const std::vector<glm::vec3>& positions, const std::vector<ObjFace>& faces, unsigned threadCount = 0);
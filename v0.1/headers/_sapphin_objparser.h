@@ -0,0 +1,77 @@
+// _sapphin_objparser.h
+// This header file includes the in-place .obj parser used by loadModel.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+#pragma once  // Prevents multiple inclusions
+
+// Headers
+#include <string>
+#include <vector>
+#include <atomic>
+#include "headers/_sapphin_utils.h"
+#include "headers/_sapphin_types.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+
+// One triangle of an 'f' record (indices are 0-based, -1 when not present)
+struct ObjFace {
+    int posIndices[3];
+    int texIndices[3];
+    int normIndices[3];
+};
+
+// Color of 'v' records without one
+const glm::vec4 OBJ_DEFAULT_COLOR(0.7f, 0.7f, 0.7f, 1.0f);
+
+// Attribute streams exactly as they appear in the .obj file. colors stays empty while no 'v' record had a
+// color; after the first one it has an entry for every position.
+struct ObjData {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec4> colors;
+    std::vector<glm::vec3> fileNormals;
+    std::vector<glm::vec2> texcoords;
+    std::vector<ObjFace> faces;
+};
+
+// Parse .obj text in [begin, end) without copying it. Records are appended to data.
+void parseObjBuffer(const char* begin, const char* end, ObjData& data);
+
+// Parse [begin, end) on several threads by splitting it into newline-aligned chunks.
+// The result is identical to parseObjBuffer. threadCount 0 uses every hardware thread.
+// When cancel (if given) is set from another thread, parsing stops early and data is incomplete.
+void parseObjBufferParallel(const char* begin, const char* end, ObjData& data, unsigned threadCount = 0,
+    const std::atomic<bool>* cancel = nullptr);
+
+// Memory map the file and parse it (in parallel for large files). Returns false if the file could not be opened
+// or cancel was set before parsing finished.
+bool parseObjFile(const std::string& filename, ObjData& data, unsigned threadCount = 0, const std::atomic<bool>* cancel = nullptr);
+
+// Number of records of every kind, for sizing buffers before parsing
+struct ObjCounts {
+    size_t positions = 0;
+    size_t coloredPositions = 0;  // 'v' records with at least six values
+    size_t texcoords = 0;
+    size_t fileNormals = 0;
+    size_t faces = 0;             // 'f' records, including ones that will turn out malformed
+};
+
+// Count the records in [begin, end) on threadCount threads (0 = all) without parsing any numbers
+ObjCounts countObjRecords(const char* begin, const char* end, unsigned threadCount = 0);
+
+// Parse only the 'v' and 'vt' records of [begin, end) into data; normals are skipped and faces are left
+// for readObjFaces. Reserve data with countObjRecords first to parse without reallocating.
+void parseObjAttributes(const char* begin, const char* end, ObjData& data);
+
+// Position in a file whose faces are read a block at a time. Relative indices are resolved against the
+// records passed so far, exactly as parseObjBuffer resolves them.
+struct ObjFaceStream {
+    const char* cursor = nullptr;
+    const char* end = nullptr;
+    size_t positions = 0;
+    size_t texcoords = 0;
+    size_t fileNormals = 0;
+};
+
+// Replace faces with the next (up to) maxFaces faces of the stream. Returns false once the stream is exhausted
+// and no face was read.
+bool readObjFaces(ObjFaceStream& stream, std::vector<ObjFace>& faces, size_t maxFaces);
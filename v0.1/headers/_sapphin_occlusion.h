@@ -0,0 +1,84 @@
+// _sapphin_occlusion.h
+// This header file includes the CPU occlusion culling against a hierarchical depth buffer of occluder meshes.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+#pragma once  // Prevents multiple inclusions
+
+// Headers
+#include <vector>
+#include <cstdint>
+#include "headers/_sapphin_types.h"
+#include "headers/_sapphin_softraster.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+
+// Width of the occlusion depth buffer; its height follows the aspect of the view
+const int OCCLUSION_WIDTH = 256;
+
+// Occluder triangles rasterized per frame at most; the nearest occluders go first
+const size_t OCCLUSION_MAX_OCCLUDER_TRIANGLES = 1 << 16;
+
+// Per-frame counters since the last takeStats()
+struct OcclusionStats {
+    size_t frames = 0;
+    size_t occluderTriangles = 0;  // Submitted to the depth rasterizer
+    size_t simplifiedOccluders = 0;  // Rasterized at a coarser level of detail to fit in the budget
+    size_t skippedOccluders = 0;     // Not rasterized at all: no level of detail small and accurate enough fit
+    size_t testedBoxes = 0;
+    size_t occludedBoxes = 0;
+    size_t occludedTriangles = 0;  // Triangles of the occluded boxes, not drawn
+    double rasterMilliseconds = 0.0;   // Occluder depth and pyramid
+    double testMilliseconds = 0.0;     // Box tests
+};
+
+// Every frame: beginFrame() with the camera matrices, addOccluder() for the meshes that hide things, then
+// finish() rasterizes their depth at low resolution (on several threads, with the SIMD kernel of the software
+// rasterizer) and builds a pyramid where every texel holds the farthest depth of the 2x2 texels below it.
+// boxVisible() then compares the nearest depth of a projected bounding box with the farthest occluder depth
+// over the few texels of the level that covers the box. Parts of the view without occluders stay at the far
+// plane, so only boxes entirely behind occluders are reported hidden (up to the coverage of single
+// low-resolution pixels, which are filled when their centers are covered).
+class OcclusionCuller {
+public:
+    bool create(unsigned threadCount = 0);
+
+    // Start a frame seen by view and projection, on a framebuffer of the given size (for the aspect)
+    void beginFrame(const glm::mat4& view, const glm::mat4& projection, int framebufferWidth, int framebufferHeight);
+
+    // Queue the triangles of mesh, placed by model: full detail, or the finest of its levels of detail that fits in
+    // what is left of the frame's occluder budget, as long as that level's error is under one depth texel at the
+    // mesh's nearest distance (so it hides what the mesh hides). Returns false when it was skipped; a mesh that
+    // can never fit is reported once.
+    bool addOccluder(const Mesh& mesh, const glm::mat4& model);
+
+    // Rasterize the occluders and build the pyramid; boxVisible() answers from it until the next beginFrame()
+    void finish();
+
+    // False when the box (in the space boxToClip transforms from) is hidden behind the occluders.
+    // triangles is what drawing the box would cost; it is counted as saved when the box is hidden.
+    bool boxVisible(const glm::mat4& boxToClip, const glm::vec3& boundsMin, const glm::vec3& boundsMax, size_t triangles);
+
+    bool ready() const { return pyramidReady; }
+    const glm::mat4& frameViewProjection() const { return viewProjection; }
+    OcclusionStats takeStats();
+
+private:
+    struct PyramidLevel {
+        int width = 0;
+        int height = 0;
+        std::vector<float> depth;  // Farthest depth under every texel, bottom row first
+    };
+
+    void buildPyramid();
+
+    SoftwareRasterizer rasterizer;
+    unsigned threadCount = 0;
+    std::vector<PyramidLevel> levels;
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    float texelsPerRadian = 1.0f;  // Depth texels per unit of size at unit distance, near the view's center
+    size_t frameOccluderTriangles = 0;
+    std::vector<const Mesh*> oversizedOccluders;  // Already reported as never fitting in the budget
+    bool pyramidReady = false;
+    OcclusionStats stats;
+};
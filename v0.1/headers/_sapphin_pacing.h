@@ -0,0 +1,48 @@
+// _sapphin_pacing.h
+// This header file includes the frame rate cap of the render loop.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+#pragma once  // Prevents multiple inclusions
+
+// Headers
+#include <chrono>
+#include <cstddef>
+
+// --on-demand waits this long at most for an event before looking at the loop again
+const double ON_DEMAND_WAIT_SECONDS = 0.5;
+
+// Sleeps end this close to the deadline at first; the rest is spent yielding. Grows if the OS sleeps longer.
+const double FRAME_PACING_SPIN_MILLISECONDS = 1.0;
+
+// Counters since the last takeStats()
+struct FramePacingStats {
+    size_t frames = 0;
+    size_t lateFrames = 0;          // Frames that took longer than the frame period
+    double sleepMilliseconds = 0.0;
+    double spinMilliseconds = 0.0;
+    double maxErrorMilliseconds = 0.0;  // Latest a paced frame started after its deadline
+};
+
+// Frames start at fixed deadlines one period apart. wait() sleeps until shortly before the next deadline and
+// yields for the rest, so frames start on time even where sleeps are coarse. A frame that overruns its period
+// starts the schedule again from now instead of rushing the following frames to catch up.
+class FramePacer {
+public:
+    // Frames per second at most; 0 removes the cap
+    void setRate(double framesPerSecond);
+    bool active() const { return period.count() > 0; }
+
+    // Call once per frame, after presenting it: returns when the next frame is due
+    void wait();
+
+    // Forget the schedule (after the loop was idle) so the next frame neither waits nor counts as late
+    void reset() { scheduled = false; }
+
+    FramePacingStats takeStats();
+
+private:
+    std::chrono::steady_clock::duration period = std::chrono::steady_clock::duration::zero();
+    std::chrono::steady_clock::time_point deadline;
+    bool scheduled = false;
+    double spinMilliseconds = FRAME_PACING_SPIN_MILLISECONDS;
+    FramePacingStats stats;
+};
@@ -0,0 +1,25 @@
+// _sapphin_packing.h
+// This header file includes the conversion of meshes to the compact PackedVertex layout.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+#pragma once  // Prevents multiple inclusions
+
+// Headers
+#include <vector>
+#include <cstdint>
+#include "headers/_sapphin_types.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+
+// Everything the vertex shader needs to turn packed positions back into model space
+struct PackedMeshInfo {
+    glm::vec3 positionScale = glm::vec3(1.0f);   // Half extent of the bounds
+    glm::vec3 positionOffset = glm::vec3(0.0f);  // Center of the bounds
+    float maxPositionError = 0.0f;               // Largest per-axis position error measured while packing
+};
+
+uint16_t floatToHalf(float value);
+float halfToFloat(uint16_t value);
+
+// Pack all vertices of a mesh. The mesh bounds must be up to date.
+PackedMeshInfo packVertices(const Mesh& mesh, std::vector<PackedVertex>& packed);
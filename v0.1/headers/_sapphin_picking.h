@@ -0,0 +1,70 @@
+// _sapphin_picking.h
+// This header file includes the triangle BVH used to pick and measure points on a mesh with rays.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+#pragma once  // Prevents multiple inclusions
+
+// Headers
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include "headers/_sapphin_types.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+
+// Leaves hold up to this many triangles, which are tested together with one SIMD step
+const unsigned PICK_LEAF_TRIANGLES = 4;
+
+// Split candidates per axis of the binned SAH builder
+const unsigned PICK_SAH_BINS = 16;
+
+// Node of a PickBvh: leaves (count > 0) cover count triangles from leftFirst on, inner nodes have their
+// two children next to each other at leftFirst and leftFirst + 1
+struct PickBvhNode {
+    glm::vec3 boundsMin;
+    uint32_t leftFirst;
+    glm::vec3 boundsMax;
+    uint32_t count;
+};
+
+// Closest hit of a ray. triangle is the triangle's position in the mesh's index buffer (first index / 3).
+struct RayHit {
+    bool hit = false;
+    float distance = INFINITY;
+    uint32_t triangle = 0;
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 normal = glm::vec3(0.0f);  // Of the triangle's plane, toward the ray origin
+    size_t nodesVisited = 0;
+    size_t trianglesTested = 0;
+};
+
+// Bounding volume hierarchy over single triangles of a mesh, built with the surface area heuristic.
+// Triangle corners are copied (as a corner and two edges, per axis in separate arrays) in leaf order,
+// so the mesh may change or go away afterwards. Rays hit front faces only, like the renderer draws them.
+class PickBvh {
+public:
+    // Build over the full-detail triangles of the mesh, on up to threadCount threads (0 = all)
+    void build(const Mesh& mesh, unsigned threadCount = 0);
+    void clear();
+
+    bool empty() const { return nodes.empty(); }
+    size_t nodeCount() const { return nodes.size(); }
+    size_t triangleCount() const { return triangleIds.size(); }
+    double buildMilliseconds() const { return buildTime; }
+
+    // Closest front-facing triangle along origin + t * direction, for t in (0, maxDistance)
+    RayHit intersect(const glm::vec3& origin, const glm::vec3& direction, float maxDistance = INFINITY) const;
+
+private:
+    std::vector<PickBvhNode> nodes;
+    std::vector<float> corner[3];  // x, y and z of corner 0, per triangle in leaf order
+    std::vector<float> edge1[3];   // corner 1 - corner 0
+    std::vector<float> edge2[3];   // corner 2 - corner 0
+    std::vector<uint32_t> triangleIds;
+    double buildTime = 0.0;
+};
+
+// Ray through a window position (pixels from the top left, as GLFW reports the cursor), starting on the
+// near plane. Returns false for a degenerate projection.
+bool cursorRay(const glm::mat4& view, const glm::mat4& projection, double cursorX, double cursorY, int windowWidth, int windowHeight,
+    glm::vec3& origin, glm::vec3& direction);
@@ -0,0 +1,33 @@
+// _sapphin_preprocess.h
+// This header file includes the offline preprocessing mode that builds mesh caches for many models at once.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+#pragma once  // Prevents multiple inclusions
+
+// Headers
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "headers/_sapphin_utils.h"
+#include "headers/_sapphin_boundedload.h"
+
+// What happened to one model
+struct PreprocessResult {
+    std::string filename;
+    bool cached = false;   // Its .sapmesh was already current and was left alone
+    bool failed = false;
+    size_t vertices = 0;
+    size_t triangles = 0;
+    uint64_t sourceBytes = 0;
+    uint64_t outputBytes = 0;
+    double milliseconds = 0.0;
+    LoadMemoryStats memory;  // Filled when a load memory budget is set
+};
+
+// Expand --preprocess arguments into .obj files: directories are searched recursively, any other file that
+// is not an .obj is read as a list of paths (one per line, '#' starts a comment). Duplicates are dropped.
+// Returns false (and prints why) if some path could not be used; files still holds everything else.
+bool collectModelFiles(const std::vector<std::string>& paths, std::vector<std::string>& files);
+
+// Build the .sapmesh of every model on a pool of threads, print a summary and write a JSON report.
+// Returns the process exit code (non-zero if any model failed).
+int runPreprocess(const EngineOptions& options);
@@ -0,0 +1,125 @@
+// _sapphin_profiler.h
+// This header file includes the frame profiler: scoped CPU zones, GPU timer queries and Chrome trace export.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+#pragma once  // Prevents multiple inclusions
+
+// Headers
+#include <string>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+#include "lib/GLEW.win32/GLEW-lib/include/GL/glew.h"
+
+// Events kept in the ring; older ones are overwritten (about 1000 frames of the render loop's zones)
+const size_t PROFILER_RING_EVENTS = 1 << 14;
+
+// GPU zones per frame; GL_TIME_ELAPSED queries can't nest, so zones beyond this or inside another are skipped
+const size_t PROFILER_GPU_ZONES = 8;
+
+// Track of GPU zones in the trace (CPU zones use one track per thread, numbered from 1)
+const uint32_t PROFILER_GPU_TRACK = 0;
+
+// One finished zone. Names must outlive the profiler (string literals).
+struct ProfileEvent {
+    const char* name = nullptr;
+    uint64_t startNanoseconds = 0;
+    uint64_t durationNanoseconds = 0;
+    uint32_t track = 0;
+};
+
+class FrameProfiler {
+public:
+    FrameProfiler();
+
+    // Disabled profilers record nothing; zones then cost one check each
+    void setEnabled(bool on) { enabled.store(on, std::memory_order_relaxed); }
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    // Nanoseconds since the profiler was created
+    uint64_t now() const;
+
+    // Append an event to the ring. Safe to call from any thread without locking.
+    void record(const char* name, uint64_t startNanoseconds, uint64_t durationNanoseconds, uint32_t track);
+
+    // Track of the calling thread
+    static uint32_t currentTrack();
+
+    // Call once per frame before any GPU zone. Collects the queries of two frames back, which the GPU has
+    // normally finished by now; results that are still not available are dropped rather than waited for.
+    void beginFrame();
+    bool beginGpuZone(const char* name);
+    void endGpuZone();
+
+    // Delete the queries; call while the GL context still exists
+    void releaseGpu();
+
+    // Write the events in the ring as Chrome trace JSON (opens in chrome://tracing and Perfetto)
+    bool writeChromeTrace(const std::string& filename) const;
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> sequence{ 0 };  // 2 * index + 2 once event index is complete, odd while writing
+        std::atomic<const char*> name{ nullptr };
+        std::atomic<uint64_t> start{ 0 };
+        std::atomic<uint64_t> duration{ 0 };
+        std::atomic<uint32_t> track{ 0 };
+    };
+
+    // Queries of one frame; two of these alternate so reading never waits for the frame just submitted
+    struct GpuFrame {
+        GLuint queries[PROFILER_GPU_ZONES] = {};
+        const char* names[PROFILER_GPU_ZONES] = {};
+        uint64_t starts[PROFILER_GPU_ZONES] = {};
+        size_t count = 0;
+    };
+
+    std::atomic<bool> enabled{ false };
+    std::chrono::steady_clock::time_point origin;
+    std::atomic<uint64_t> writeIndex{ 0 };
+    std::unique_ptr<Slot[]> slots;
+
+    GpuFrame gpuFrames[2];
+    size_t frameNumber = 0;
+    bool gpuZoneOpen = false;
+    bool queriesCreated = false;
+    size_t droppedGpuZones = 0;
+};
+
+// The process-wide profiler
+FrameProfiler& profiler();
+
+// Times its own lifetime on the calling thread's track
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name)
+        : name(name), active(profiler().isEnabled()), start(active ? profiler().now() : 0) {}
+    ~ProfileZone() {
+        if (active) {
+            profiler().record(name, start, profiler().now() - start, FrameProfiler::currentTrack());
+        }
+    }
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* name;
+    bool active;
+    uint64_t start;
+};
+
+// Times the GPU work submitted during its lifetime (the result shows up two frames later)
+class GpuProfileZone {
+public:
+    explicit GpuProfileZone(const char* name) : active(profiler().isEnabled() && profiler().beginGpuZone(name)) {}
+    ~GpuProfileZone() {
+        if (active) {
+            profiler().endGpuZone();
+        }
+    }
+    GpuProfileZone(const GpuProfileZone&) = delete;
+    GpuProfileZone& operator=(const GpuProfileZone&) = delete;
+
+private:
+    bool active;
+};
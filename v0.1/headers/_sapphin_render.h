@@ -9,6 +9,8 @@
 #include "headers/_sapphin_utils.h"
 #include "headers/_sapphin_modeling.h"
 #include "headers/_sapphin_types.h"
+#include "headers/_sapphin_culling.h"
+#include "headers/_sapphin_ringbuffer.h"
 #include "lib/GLEW.win32/GLEW-lib/include/GL/glew.h"
 #include "lib/GLFW.win32/GLFW-lib/include/GLFW/glfw3.h"
 
@@ -17,11 +19,90 @@
 #include "lib/GLM.win32/GLM-lib/glm/gtc/matrix_transform.hpp"
 #include "lib/GLM.win32/GLM-lib/glm/gtc/type_ptr.hpp"
 
+// Mesh living in GPU buffers, ready to be drawn with glDrawElements
+struct GpuMesh {
+    GLuint VAO = 0;
+    GLuint VBO = 0;
+    GLuint EBO = 0;
+    GLsizei indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+
+    // Set when the vertex buffer holds PackedVertex data (see getPackedVertexShader)
+    bool packed = false;
+    glm::vec3 positionScale = glm::vec3(1.0f);
+    glm::vec3 positionOffset = glm::vec3(0.0f);
+
+    // Bytes allocated in VBO and EBO; a later model reuses them when it fits (see beginMeshUpload)
+    size_t vertexCapacity = 0;
+    size_t indexCapacity = 0;
+};
+
+// Vertex and index data of a mesh in GPU layout, prepared on any thread and uploaded in slices on the GL thread.
+// Only data that has to be converted is held here; the rest is read from the mesh itself while uploading.
+struct MeshUpload {
+    std::vector<PackedVertex> packedVertices;  // With packed; otherwise mesh.vertices goes up as it is
+    std::vector<uint16_t> shortIndices;        // With 16-bit indices; otherwise mesh.indices goes up as it is
+    size_t vertexBytes = 0;
+    size_t indexBytes = 0;
+    size_t indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    bool packed = false;
+    glm::vec3 positionScale = glm::vec3(1.0f);
+    glm::vec3 positionOffset = glm::vec3(0.0f);
+
+    size_t uploadedVertexBytes = 0;
+    size_t uploadedIndexBytes = 0;
+};
+
+// What drawMeshView drew and how it got there
+struct MeshDrawStats {
+    size_t lodLevel = 0;
+    size_t triangles = 0;
+    size_t drawCalls = 0;  // 0 when everything was culled
+    bool bvhCulled = false;
+    bool meshletsCulled = false;
+    bool occluded = false;  // The whole mesh was hidden behind occluders
+    bool frustumCulled = false;  // A level of detail (culled as a whole) was outside the view
+    BvhCullStats bvh;
+    MeshletCullStats meshlets;
+};
+
 GLFWwindow* initOpenGL();
+GLFWwindow* initHeadlessOpenGL(int width, int height);
 GLuint createShaderProgram();
 GLuint createShaderProgram(const std::string& vertexSource, const std::string& fragmentSource);
 void renderModel(GLFWwindow* window, const std::vector<Vertex>& vertices, GLuint shaderProgram);
 
+// Indexed mesh upload and drawing
+GpuMesh uploadMesh(const Mesh& mesh);
+GpuMesh uploadPackedMesh(const Mesh& mesh);
+
+// Uploading in slices: prepareMeshUpload needs no GL context, beginMeshUpload creates empty buffers and
+// continueMeshUpload copies up to maxBytes more per call (vertices first). It returns true once all is uploaded;
+// until then the first uploadedTriangleIndices(upload) indices can already be drawn. With a staging ring the
+// slices go through it and are copied on the GPU, so writing next to data in use never makes the driver wait.
+// If gpuMesh already has buffers, beginMeshUpload keeps its VAO and buffers and only grows them when needed.
+// continueMeshUpload reads the mesh the upload was prepared from (it may have been moved since, not changed).
+MeshUpload prepareMeshUpload(const Mesh& mesh, bool packed);
+void beginMeshUpload(const MeshUpload& upload, GpuMesh& gpuMesh);
+bool continueMeshUpload(MeshUpload& upload, const Mesh& mesh, const GpuMesh& gpuMesh, size_t maxBytes, StreamRing* staging = nullptr);
+size_t uploadedTriangleIndices(const MeshUpload& upload);
+
+void drawMesh(const GpuMesh& gpuMesh);
+void drawMeshRanges(const GpuMesh& gpuMesh, const std::vector<IndexRange>& ranges);
+
+// Draw a mesh the way the camera sees it: the level of detail its on-screen size needs, or the chunks and
+// meshlets that survive culling when it has them. Chunks and meshlets only exist for the full-detail level;
+// coarser levels are frustum culled as a whole. cameraInModel is the camera position in model space and
+// ranges is scratch space reused across frames. With an occlusion culler that is ready for this frame, the
+// mesh (and its chunks) are skipped when hidden behind its occluders. The program must be bound.
+MeshDrawStats drawMeshView(const Mesh& mesh, const GpuMesh& gpuMesh, const glm::mat4& modelViewProjection, const glm::vec3& cameraInModel,
+    float fovyDegrees, int viewportHeight, std::vector<IndexRange>& ranges, OcclusionCuller* occlusion = nullptr);
+void destroyMesh(GpuMesh& gpuMesh);
+
 // Shader source generators
 std::string getDefaultVertexShader();
+std::string getPackedVertexShader();
+std::string getInstancedVertexShader();
+std::string getPackedInstancedVertexShader();
 std::string getDefaultFragmentShader();
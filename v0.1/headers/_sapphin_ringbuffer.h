@@ -0,0 +1,61 @@
+// _sapphin_ringbuffer.h
+// This header file includes the streaming ring buffer used for data that changes every frame.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+#pragma once  // Prevents multiple inclusions
+
+// Headers
+#include <cstdint>
+#include <cstddef>
+#include "lib/GLEW.win32/GLEW-lib/include/GL/glew.h"
+
+// Frames the GPU may still be reading while the CPU writes the next one
+const size_t STREAM_RING_FRAMES = 3;
+
+// Uploads since the last takeStats()
+struct StreamStats {
+    size_t bytesUploaded = 0;
+    size_t frames = 0;
+    size_t stalls = 0;              // Frames that had to wait for the GPU before writing
+    double waitMilliseconds = 0.0;  // Time spent in those waits
+};
+
+// One buffer split into STREAM_RING_FRAMES parts, each written by one frame and fenced when the frame ends,
+// so the CPU never overwrites data the GPU hasn't read yet. With ARB_buffer_storage the buffer is mapped
+// once (persistent and coherent) and uploads are plain memcpy. Without it, every frame orphans the buffer
+// and uploads with glBufferSubData, which lets the driver hand out fresh storage instead of waiting.
+class StreamRing {
+public:
+    StreamRing() = default;
+    ~StreamRing() = default;  // Call destroy() while the context exists
+
+    // bytesPerFrame is only the starting size; a frame that needs more grows the ring
+    bool create(size_t bytesPerFrame);
+    void destroy();
+
+    // Copy data into this frame's part of the ring and return its offset in buffer(). The data stays
+    // valid for draws and copies issued before endFrame().
+    size_t upload(const void* data, size_t size, size_t alignment = 16);
+
+    // Call after the last draw or copy that reads this frame's uploads
+    void endFrame();
+
+    GLuint buffer() const { return ringBuffer; }
+    bool isPersistent() const { return mapped != nullptr; }
+
+    StreamStats takeStats();
+
+private:
+    void beginFrame();
+    void allocate(size_t newSegmentSize);
+    void releaseFences();
+
+    GLuint ringBuffer = 0;
+    uint8_t* mapped = nullptr;
+    bool persistent = false;
+    size_t segmentSize = 0;
+    size_t segment = 0;
+    size_t head = 0;
+    bool frameStarted = false;
+    GLsync fences[STREAM_RING_FRAMES] = {};
+    StreamStats stats;
+};
@@ -0,0 +1,78 @@
+// _sapphin_scene.h
+// This header file includes scenes of many placed model copies, drawn with instancing.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+#pragma once  // Prevents multiple inclusions
+
+// Headers
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "headers/_sapphin_types.h"
+#include "headers/_sapphin_render.h"
+#include "headers/_sapphin_culling.h"
+#include "headers/_sapphin_occlusion.h"
+#include "headers/_sapphin_ringbuffer.h"
+#include "lib/GLEW.win32/GLEW-lib/include/GL/glew.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+
+// One placed copy of a scene mesh: uniform scale, then rotation around Y, then translation
+struct SceneInstance {
+    uint32_t mesh;
+    glm::vec3 position;
+    float yaw;    // Degrees
+    float scale;
+};
+
+// Meshes, each loaded once, and the instances that place them
+struct Scene {
+    std::vector<Mesh> meshes;
+    std::vector<std::string> meshNames;
+    std::vector<SceneInstance> instances;
+    std::vector<uint32_t> occluderMeshes;  // Meshes whose instances hide others (every mesh when empty)
+};
+
+glm::mat4 instanceTransform(const SceneInstance& instance);
+
+// Load a scene description. Every line is one of:
+//   mesh <name> <file.obj>
+//   instance <name> <x> <y> <z> [yaw degrees] [scale]
+//   occluder <name>   (instances of this mesh are rasterized for occlusion culling)
+// Lines starting with '#' are comments. Returns false (and prints why) on errors.
+bool loadScene(const std::string& filename, Scene& scene, uint32_t processingFlags = 0);
+
+// Place count copies of a mesh on a square grid in the XZ plane, spaced by its size
+void addGridInstances(Scene& scene, uint32_t mesh, size_t count);
+
+// Scene meshes on the GPU plus a ring of per-instance transforms that is refilled every frame
+struct GpuScene {
+    std::vector<GpuMesh> meshes;
+    StreamRing instanceRing;
+    std::vector<glm::mat4> transforms;  // Visible instances of this frame, grouped by mesh and level of detail
+};
+
+struct SceneDrawStats {
+    size_t visibleInstances = 0;
+    size_t culledInstances = 0;
+    size_t occludedInstances = 0;  // Inside the frustum, but hidden behind occluders
+    size_t drawCalls = 0;
+    size_t triangles = 0;
+    size_t streamedBytes = 0;
+};
+
+GpuScene uploadScene(const Scene& scene, bool packed);
+
+// Start the frame's occlusion culling: rasterize occluderMesh (world space; may be empty) and the scene's
+// occluder instances inside the view, nearest first, then build the depth pyramid. Once the occluder budget
+// runs low, further occluders fall back to their coarser levels of detail, or are skipped (see OcclusionStats).
+void prepareOcclusion(OcclusionCuller& occlusion, const Scene& scene, const Mesh& occluderMesh, const glm::mat4& view,
+    const glm::mat4& projection, int framebufferWidth, int framebufferHeight);
+
+// Cull instances against the frustum (world space) and, when given, the occlusion pyramid, stream the transforms
+// of the visible ones and draw every mesh (and level of detail) with one glDrawElementsInstanced call.
+// The program must be bound.
+SceneDrawStats drawScene(GpuScene& gpuScene, const Scene& scene, const Frustum& frustum, const glm::vec3& cameraPosition,
+    float fovyDegrees, int viewportHeight, GLuint shaderProgram, OcclusionCuller* occlusion = nullptr);
+
+void destroyScene(GpuScene& gpuScene);
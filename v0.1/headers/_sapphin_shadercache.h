@@ -0,0 +1,38 @@
+// _sapphin_shadercache.h
+// This header file includes the on-disk cache of linked shader programs (.sapprog).
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+#pragma once  // Prevents multiple inclusions
+
+// Headers
+#include <string>
+#include <cstdint>
+#include "lib/GLEW.win32/GLEW-lib/include/GL/glew.h"
+
+// Bump whenever the layout of the cache file changes
+const uint32_t SHADER_CACHE_VERSION = 1;
+
+// Cached programs live here, relative to the working directory like the shaders folder
+const char* const SHADER_CACHE_DIRECTORY = "shaders/cache";
+
+// Fixed-size header at the start of every .sapprog file, followed by the program binary
+struct ShaderCacheHeader {
+    char magic[8];            // "SAPPROG"
+    uint32_t version;
+    uint32_t binaryFormat;    // As returned by glGetProgramBinary
+    uint64_t key;             // shaderProgramKey() the binary was built for
+    uint64_t binarySize;
+    uint64_t binaryHash;      // hashBytes() of the binary
+};
+
+// True when the context can hand out program binaries (ARB_get_program_binary with at least one format)
+bool shaderCacheSupported();
+
+// Hash of both sources and of the GL vendor, renderer and version: a driver update makes old binaries miss
+uint64_t shaderProgramKey(const std::string& vertexSource, const std::string& fragmentSource);
+
+// Linked program from the cache, or 0 if there is none or the driver rejects it (then compile as usual)
+GLuint loadCachedProgram(uint64_t key);
+
+// Store a linked program, which should have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+// Returns false if the binary could not be read back or written.
+bool saveCachedProgram(uint64_t key, GLuint program);
@@ -0,0 +1,128 @@
+// _sapphin_softraster.h
+// This header file includes the CPU rasterizer used to render without a GPU.
+// Sapphin 3D Renderer ((OpenGL, GLFW/GLEW))
+#pragma once  // Prevents multiple inclusions
+
+// Headers
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "headers/_sapphin_types.h"
+#include "headers/_sapphin_utils.h"
+
+// HPP files
+#include "lib/GLM.win32/GLM-lib/glm/glm.hpp"
+
+// Screen tiles are this many pixels wide and high; each one is shaded by one thread
+const int SOFTWARE_TILE_SIZE = 64;
+
+// Largest framebuffer side; keeps fixed-point edge functions inside 32 bits
+const int SOFTWARE_MAX_SIZE = 8192;
+
+// Counters since the last takeStats()
+struct SoftwareRasterStats {
+    size_t frames = 0;
+    size_t trianglesSubmitted = 0;
+    size_t trianglesBinned = 0;     // Left after clipping, backface and zero-coverage culling
+    size_t tileReferences = 0;      // Binned triangles summed over the tiles they touch
+    size_t pixelsShaded = 0;        // Fragments that passed the depth test
+    double geometryMilliseconds = 0.0;  // Vertex transform, clipping, setup and binning
+    double rasterMilliseconds = 0.0;    // Clearing and shading the tiles
+};
+
+// Renders indexed Vertex data with the same fixed state and shading as the GL path: depth test (less),
+// back faces (clockwise on screen) culled, and getDefaultFragmentShader()'s Lambert plus ambient.
+// draw() transforms and clips the triangles and sorts them into screen tiles; finish() then clears and
+// rasterizes all tiles in parallel, testing several pixels at once against the edge functions and depth.
+// Triangles land in each tile in submission order, so images don't depend on the thread count.
+// A depthOnly rasterizer has no color buffer and only writes depth (used for occlusion culling).
+class SoftwareRasterizer {
+public:
+    bool create(int width, int height, unsigned threadCount = 0, bool depthOnly = false);
+
+    int width() const { return framebufferWidth; }
+    int height() const { return framebufferHeight; }
+    unsigned threads() const { return threadCount; }
+
+    // Name of the edge and depth test kernel compiled in ("AVX2", "SSE2" or "scalar")
+    static const char* kernelName();
+
+    // Applied by the next finish(), before any triangle
+    void clear(const glm::vec4& color);
+
+    void setCamera(const glm::mat4& view, const glm::mat4& projection);
+
+    // Queue triangles for the next finish(). indices may be null for unindexed vertices (three per triangle).
+    // Returns the number of triangles submitted.
+    size_t draw(const Vertex* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount, const glm::mat4& model);
+    size_t draw(const Mesh& mesh, const glm::mat4& model);
+
+    // Rasterize everything drawn since the last finish()
+    void finish();
+
+    // RGBA8 pixels, bottom row first like glReadPixels (black for depthOnly rasterizers)
+    void readPixels(std::vector<uint8_t>& pixels) const;
+
+    // Window depth after the last finish(), bottom row first; rows are depthStride() floats apart
+    const float* depthData() const { return depth.data(); }
+    int depthStride() const { return stride; }
+
+    SoftwareRasterStats takeStats();
+
+private:
+    // Vertex after the vertex stage, in clip space
+    struct ShadedVertex {
+        glm::vec4 clip;
+        glm::vec3 normal;  // World space, not normalized
+        glm::vec4 color;
+    };
+
+    // Triangle after projection, counter-clockwise on screen
+    struct RasterTriangle {
+        int32_t x[3], y[3];        // Window coordinates with 4 fractional bits, y up
+        float invW[3];
+        glm::vec3 normal[3];
+        glm::vec4 color[3];
+        float depth0;              // Window depth at vertex 0 and its change per pixel
+        float depthDx, depthDy;
+        float inverseArea;         // 1 / (twice the area, in fixed-point units)
+        int minX, minY, maxX, maxY;  // Pixels whose centers may be covered, clamped to the framebuffer
+    };
+
+    // Triangles set up by one task, with their indices sorted into per-tile lists
+    struct BinBlock {
+        std::vector<RasterTriangle> triangles;
+        std::vector<std::vector<uint32_t>> bins;
+        size_t tileReferences = 0;
+    };
+
+    void setupTriangle(const ShadedVertex& a, const ShadedVertex& b, const ShadedVertex& c, BinBlock& block) const;
+    void clipTriangle(const ShadedVertex& a, const ShadedVertex& b, const ShadedVertex& c, BinBlock& block) const;
+    void rasterizeTile(size_t tile);
+
+    int framebufferWidth = 0;
+    int framebufferHeight = 0;
+    int stride = 0;  // Pixels per row, padded so SIMD loads never cross into another row
+    int tilesX = 0;
+    int tilesY = 0;
+    unsigned threadCount = 1;
+    WorkerPool workers;  // Kept across draws and frames, so no loop waits for threads to start
+    bool depthOnly = false;
+    float guardBand = 1.0f;  // Clip-space x and y limit (times w) that keeps screen coordinates in range
+
+    std::vector<uint8_t> color;  // RGBA8, bottom row first
+    std::vector<float> depth;
+    glm::vec4 clearColor = glm::vec4(0.0f);
+    bool clearPending = false;
+
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    std::vector<ShadedVertex> shadedVertices;
+    std::vector<BinBlock> blocks;  // Reused across frames; the first usedBlocks hold this frame's triangles
+    size_t usedBlocks = 0;
+
+    std::vector<size_t> tilePixels;  // Fragments written per tile in the last finish()
+    SoftwareRasterStats stats;
+};
+
+// Binary PPM (P6) of RGBA8 pixels stored bottom row first; alpha is dropped
+bool writeImagePPM(const std::string& filename, int width, int height, const std::vector<uint8_t>& pixels);
@@ -4,6 +4,10 @@
 
 #pragma once  // Prevents multiple inclusions
 
+// Headers
+#include <vector>
+#include <cstdint>
+
 // HPP files
 #include "lib/GLM.win32/GLM-lib/glm/glm.hpp" // Just because Vertex only uses GLM.
 
@@ -14,3 +18,53 @@ struct Vertex {
     float u, v;       // Texture coordinates
     float r, g, b, a;
 };
+
+// Compact vertex layout (20 bytes instead of 48), produced by packVertices() in _sapphin_packing.cpp.
+// Positions are snorm16 relative to the mesh bounds, normals snorm 10_10_10_2, UVs half floats and colors unorm8.
+struct PackedVertex {
+    int16_t x, y, z, w;  // Position (w is padding)
+    uint32_t normal;     // Normal, packed as GL_INT_2_10_10_10_REV
+    uint16_t u, v;       // Texture coordinates, half floats
+    uint8_t r, g, b, a;  // Color
+};
+
+// Cluster of consecutive triangles in a mesh's index buffer, with the data needed to cull it as a whole
+struct Meshlet {
+    uint32_t firstIndex;   // Offset into Mesh::indices
+    uint32_t indexCount;
+    glm::vec3 center;      // Bounding sphere
+    float radius;
+    glm::vec3 coneApex;    // Normal cone: every triangle faces away from cameras with
+    glm::vec3 coneAxis;    //   dot(normalize(coneApex - camera), coneAxis) >= coneCutoff
+    float coneCutoff;      //   (values above 1 mean the cluster can never be backface culled)
+};
+
+// Node of a bounding volume hierarchy over a mesh. Nodes are stored depth first: the left child
+// directly follows its parent. Every node covers one contiguous range of the index buffer.
+struct BvhNode {
+    glm::vec3 boundsMin;
+    uint32_t firstIndex;
+    glm::vec3 boundsMax;
+    uint32_t indexCount;
+    uint32_t rightChild;    // 0 for leaves
+    uint32_t firstMeshlet;  // Meshlets inside the node, when the mesh has them
+    uint32_t meshletCount;
+};
+
+// Simplified version of a mesh, stored as another range of the same index buffer
+struct MeshLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error;  // Largest distance from the original surface, in model units
+};
+
+// Indexed mesh: unique vertices plus three indices per triangle
+struct Mesh {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<Meshlet> meshlets;  // Optional, see buildMeshlets()
+    std::vector<BvhNode> bvh;       // Optional, see buildMeshBvh()
+    std::vector<MeshLod> lods;      // Optional, see buildMeshLods(). lods[0] is the full mesh.
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+};
@@ -6,6 +6,10 @@
 // Headers
 #include <string>
 #include <vector>
+#include <cstdint>
+#include <thread>
+#include <atomic>
+#include <memory>
 #include "headers/_sapphin_utils.h"
 #include "headers/_sapphin_modeling.h"
 #include "headers/_sapphin_types.h"
@@ -34,10 +38,146 @@ std::string getDefaultFragmentShader();
 #define BLUE    "\033[34m"
 #define CYAN    "\033[36m"
 
+// Options given on the command line
+struct EngineOptions {
+    bool packedVertices = false;  // --packed: upload 20-byte PackedVertex data instead of Vertex
+    bool optimizeMesh = false;    // --optimize: reorder triangles and vertices for the GPU caches after loading
+    bool meshlets = false;        // --meshlets: cull meshlets against the view every frame
+    bool bvh = false;             // --bvh: cull a hierarchy of mesh chunks against the view every frame
+    bool lods = false;            // --lod: generate simplified levels and draw the coarsest one that looks the same
+    std::string scenePath;        // --scene <file>: draw a scene of placed meshes instead of asking for a model
+    size_t instanceCount = 1;     // --instances <n>: draw n copies of the model on a grid
+    std::string recordPathFile;   // --record-path <file>: save the camera pose of every frame
+    std::string benchmarkModel;   // --benchmark <file.obj>: render offscreen along a camera path and exit
+    size_t benchmarkFrames = 300; // --frames <n>: timed benchmark frames
+    std::string cameraPathFile;   // --camera-path <file>: benchmark camera path (default: an orbit around the model)
+    std::string benchmarkOutput;  // --json <file>: benchmark, preprocessing or microbenchmark report (default: benchmark.json, preprocess.json, microbench.json)
+    std::string profilePath;      // --profile <file>: record CPU and GPU zones and write them as a Chrome trace
+    std::vector<std::string> preprocessPaths;  // --preprocess <path>: build the .sapmesh of every model found and exit
+    bool forcePreprocess = false;              // --force: rebuild .sapmesh files that are already current
+    unsigned threadCount = 0;                  // --threads <n>: worker threads for --preprocess, --software, --occlusion and --microbench (0 = one per hardware thread)
+    bool softwareRasterizer = false;           // --software: benchmark with the CPU rasterizer instead of OpenGL
+    std::string imagePath;                     // --image <file.ppm>: save the last benchmark frame
+    size_t pickCount = 0;                      // --picks <n>: time n cursor picks against the model's BVH in the benchmark
+    size_t memoryBudgetBytes = 0;              // --memory-budget <MB>: load .obj files with the bounded loader, within this budget
+    bool occlusion = false;                    // --occlusion: skip instances and chunks hidden behind occluders
+    std::string occluderPath;                  // --occluders <file.obj>: occluder geometry in world space (implies --occlusion)
+    size_t microbenchFaces = 0;                // --microbench <faces>: time the loader stages on synthetic files up to this size and exit
+    std::string baselinePath;                  // --baseline <file>: earlier --microbench report to compare with
+    bool onDemand = false;                     // --on-demand: draw only when something changed, wait for events otherwise
+    double fpsCap = 0.0;                       // --fps-cap <n>: most frames per second (0 = as fast as possible)
+    bool vsync = false;                        // --vsync: swap interval 1 (left to the driver otherwise)
+};
+
 // Function declaration
+bool parseCommandLine(int argc, char** argv, EngineOptions& options);
+uint32_t meshProcessingFlags(const EngineOptions& options);
 void typewriterEffect(const std::string& text, const std::string& color = "", int milliseconds_delay = 50);
 bool fileExists(const std::string& filename);
 void checkGLError(const std::string& message);
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
+
+// The window system asks for the contents to be drawn again (uncovered, restored, resized)
+void window_refresh_callback(GLFWwindow* window);
+
+// True once after window_refresh_callback was called
+bool takeRedrawRequest();
 void GetDefaultVertexShader();
 void GetDefaultFragmentShader();
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0);
+std::string jsonString(const std::string& text);
+
+// Number of worker threads to use; 0 means one per hardware thread
+inline unsigned resolveThreadCount(unsigned threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+    return threadCount > 0 ? threadCount : 1;
+}
+
+// Run work(index) for every index in [0, count) on up to threadCount threads (the caller is one of them)
+template <typename Work>
+void parallelFor(size_t count, unsigned threadCount, Work work) {
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            work(i);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < threadCount && i < count; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+// Threads that wait between parallel loops instead of being started for every one, for callers that run
+// many short loops (the software rasterizer runs a few per draw and one per frame). Used by one caller at a time.
+class WorkerPool {
+public:
+    WorkerPool();
+    ~WorkerPool();
+    WorkerPool(WorkerPool&&) noexcept;
+    WorkerPool& operator=(WorkerPool&&) noexcept;
+
+    // Keep threadCount - 1 threads waiting (the caller is the last one); 0 means one per hardware thread
+    void start(unsigned threadCount);
+    unsigned threads() const;
+
+    // Like parallelFor, on up to threadLimit of the pool's threads (the caller is one of them)
+    template <typename Work>
+    void parallelFor(size_t count, unsigned threadLimit, Work work) {
+        run(count, threadLimit, [](void* context, size_t i) { (*static_cast<Work*>(context))(i); }, &work);
+    }
+
+private:
+    struct State;
+    void run(size_t count, unsigned threadLimit, void (*call)(void*, size_t), void* context);
+    std::unique_ptr<State> state;
+};
+
+// Lines typed on the console, read on a thread of their own so the render loop never blocks on stdin.
+// The thread starts with the first start() and lives until the program exits (a read can't be interrupted).
+class ConsoleLineReader {
+public:
+    void start();
+    bool started() const { return state != nullptr; }
+
+    // The oldest line typed since the last call, if any
+    bool takeLine(std::string& line);
+
+private:
+    struct State;
+    std::shared_ptr<State> state;
+};
+
+// Read-only memory mapping of a whole file (used by the loaders to avoid copying file contents)
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& filename);
+    void close();
+
+    const char* data() const { return mappedData; }
+    size_t size() const { return mappedSize; }
+    bool isOpen() const { return opened; }
+
+private:
+    const char* mappedData = nullptr;
+    size_t mappedSize = 0;
+    bool opened = false;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fileDescriptor = -1;
+#endif
+};
@@ -8,8 +8,10 @@ out vec3 Normal;
 out vec4 Color;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout(std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+};
 
 void main() {
     gl_Position = projection * view * model * vec4(aPos, 1.0);